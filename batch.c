@@ -0,0 +1,299 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * batch.c - Columnar batches of data rows
+ *
+ * Copyright (C) 2025, Dave Beckett https://www.dajobe.org/
+ *
+ * This package is Free Software
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef SV_CONFIG
+#include <sv_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <sv.h>
+#include "sv_internal.h"
+
+
+/* Ensure room for @rows rows in the offsets and validity arrays of
+ * every allocated column
+ */
+static sv_status_t
+sv_batch_ensure_rows(sv* t, size_t rows)
+{
+  size_t nsize;
+  size_t i;
+
+  if(rows <= t->batch_rows_size)
+    return SV_STATUS_OK;
+
+  nsize = t->batch_rows_size ? t->batch_rows_size * 2 : 64;
+  while(nsize < rows)
+    nsize *= 2;
+
+  for(i = 0; i < t->batch_columns_size; i++) {
+    sv_batch_column* col = &t->batch.column[i];
+    size_t* noffsets;
+    unsigned char* nvalidity;
+
+    if(!col->offsets)
+      continue;
+
+    noffsets = (size_t*)realloc(col->offsets, sizeof(size_t) * (nsize + 1));
+    if(!noffsets)
+      return SV_STATUS_NO_MEMORY;
+    col->offsets = noffsets;
+
+    nvalidity = (unsigned char*)realloc(col->validity, (nsize + 7) / 8);
+    if(!nvalidity)
+      return SV_STATUS_NO_MEMORY;
+    col->validity = nvalidity;
+  }
+  t->batch_rows_size = nsize;
+
+  return SV_STATUS_OK;
+}
+
+
+/* Ensure the batch has @columns columns; new columns are NULL in the
+ * rows already in the batch
+ */
+static sv_status_t
+sv_batch_ensure_columns(sv* t, size_t columns)
+{
+  size_t rows = t->batch.rows;
+  size_t i;
+
+  if(columns <= t->batch.columns)
+    return SV_STATUS_OK;
+
+  if(columns > t->batch_columns_size) {
+    size_t nsize = t->batch_columns_size ? t->batch_columns_size * 2 : 8;
+    sv_batch_column* ncolumn;
+    size_t* ndata_sizes;
+
+    while(nsize < columns)
+      nsize *= 2;
+
+    ncolumn = (sv_batch_column*)realloc(t->batch.column,
+                                        sizeof(sv_batch_column) * nsize);
+    if(!ncolumn)
+      return SV_STATUS_NO_MEMORY;
+    t->batch.column = ncolumn;
+
+    ndata_sizes = (size_t*)realloc(t->batch_data_sizes,
+                                   sizeof(size_t) * nsize);
+    if(!ndata_sizes)
+      return SV_STATUS_NO_MEMORY;
+    t->batch_data_sizes = ndata_sizes;
+
+    memset(&t->batch.column[t->batch_columns_size], '\0',
+           sizeof(sv_batch_column) * (nsize - t->batch_columns_size));
+    memset(&t->batch_data_sizes[t->batch_columns_size], '\0',
+           sizeof(size_t) * (nsize - t->batch_columns_size));
+    t->batch_columns_size = nsize;
+  }
+
+  for(i = t->batch.columns; i < columns; i++) {
+    sv_batch_column* col = &t->batch.column[i];
+
+    if(!col->offsets || !col->validity) {
+      size_t* noffsets;
+      unsigned char* nvalidity;
+
+      noffsets = (size_t*)realloc(col->offsets, sizeof(size_t) *
+                                  (t->batch_rows_size + 1));
+      if(!noffsets)
+        return SV_STATUS_NO_MEMORY;
+      col->offsets = noffsets;
+
+      nvalidity = (unsigned char*)realloc(col->validity,
+                                          (t->batch_rows_size + 7) / 8);
+      if(!nvalidity)
+        return SV_STATUS_NO_MEMORY;
+      col->validity = nvalidity;
+    }
+
+    /* all NULL in earlier rows */
+    memset(col->offsets, '\0', sizeof(size_t) * (rows + 1));
+    memset(col->validity, '\0', (rows + 7) / 8);
+    col->null_count = rows;
+    t->batch.columns = i + 1;
+  }
+
+  return SV_STATUS_OK;
+}
+
+
+/**
+ * sv_internal_batch_add_row:
+ * @t: sv object
+ * @fields: row fields
+ * @widths: row field widths
+ * @count: number of fields
+ *
+ * INTERNAL - Add a data row to the current batch and return the batch
+ * to the batch callback if it is full
+ *
+ * A NULL field or a column the row does not have is NULL in the batch.
+ *
+ * Return value: non-0 on failure
+ */
+sv_status_t
+sv_internal_batch_add_row(sv* t, char** fields, size_t* widths,
+                          size_t count)
+{
+  sv_status_t status;
+  size_t row = t->batch.rows;
+  size_t byte = row >> 3;
+  unsigned char bit = (unsigned char)(1U << (row & 7));
+  size_t i;
+
+  status = sv_batch_ensure_rows(t, row + 1);
+  if(status)
+    return status;
+
+  /* every row has at least the header columns */
+  status = sv_batch_ensure_columns(t, count < t->headers_count ?
+                                   t->headers_count : count);
+  if(status)
+    return status;
+
+  for(i = 0; i < t->batch.columns; i++) {
+    sv_batch_column* col = &t->batch.column[i];
+    size_t offset = col->offsets[row];
+
+    if(!(row & 7))
+      col->validity[byte] = 0;
+
+    if(i < count && fields[i]) {
+      size_t width = widths[i];
+
+      if(offset + width > t->batch_data_sizes[i]) {
+        size_t nsize = t->batch_data_sizes[i] ?
+          t->batch_data_sizes[i] * 2 : 256;
+        char* ndata;
+
+        while(nsize < offset + width)
+          nsize *= 2;
+        ndata = (char*)realloc(col->data, nsize);
+        if(!ndata)
+          return SV_STATUS_NO_MEMORY;
+        col->data = ndata;
+        t->batch_data_sizes[i] = nsize;
+      }
+
+      if(width)
+        memcpy(col->data + offset, fields[i], width);
+      offset += width;
+      col->validity[byte] |= bit;
+    } else
+      col->null_count++;
+
+    col->offsets[row + 1] = offset;
+  }
+
+  t->batch.rows = row + 1;
+
+  if(t->batch.rows >= t->batch_size)
+    return sv_internal_batch_flush(t);
+
+  return SV_STATUS_OK;
+}
+
+
+/**
+ * sv_internal_batch_flush:
+ * @t: sv object
+ *
+ * INTERNAL - Return any rows in the current batch to the batch
+ * callback and start a new batch
+ *
+ * Return value: status of the batch callback
+ */
+sv_status_t
+sv_internal_batch_flush(sv* t)
+{
+  sv_status_t status = SV_STATUS_OK;
+
+  if(!t->batch.rows)
+    return SV_STATUS_OK;
+
+  if(t->batch_callback)
+    status = t->batch_callback(t, t->callback_user_data, &t->batch);
+
+  sv_internal_batch_reset(t);
+
+  return status;
+}
+
+
+/**
+ * sv_internal_batch_reset:
+ * @t: sv object
+ *
+ * INTERNAL - Discard the rows in the current batch keeping the arrays
+ * allocated
+ */
+void
+sv_internal_batch_reset(sv* t)
+{
+  t->batch.rows = 0;
+  t->batch.columns = 0;
+}
+
+
+/**
+ * sv_internal_batch_free:
+ * @t: sv object
+ *
+ * INTERNAL - Free the batch arrays
+ */
+void
+sv_internal_batch_free(sv* t)
+{
+  size_t i;
+
+  if(t->batch.column) {
+    for(i = 0; i < t->batch_columns_size; i++) {
+      sv_batch_column* col = &t->batch.column[i];
+
+      if(col->data)
+        free(col->data);
+      if(col->offsets)
+        free(col->offsets);
+      if(col->validity)
+        free(col->validity);
+    }
+    free(t->batch.column);
+    t->batch.column = NULL;
+  }
+
+  if(t->batch_data_sizes) {
+    free(t->batch_data_sizes);
+    t->batch_data_sizes = NULL;
+  }
+
+  t->batch.rows = 0;
+  t->batch.columns = 0;
+  t->batch_columns_size = 0;
+  t->batch_rows_size = 0;
+}
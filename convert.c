@@ -0,0 +1,960 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * convert.c - Convert field text to typed values
+ *
+ * Copyright (C) 2025, Dave Beckett https://www.dajobe.org/
+ *
+ * This package is Free Software
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef SV_CONFIG
+#include <sv_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <float.h>
+#include <locale.h>
+#include <math.h>
+
+#include <sv.h>
+#include "sv_internal.h"
+
+
+/* longest field copied for strtod() on the stack; longer fields are
+ * copied to the heap
+ */
+#define SV_CONVERT_MAX_DOUBLE_LEN 64
+
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && \
+  __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SV_CONVERT_SWAR 1
+#endif
+
+#ifdef SV_CONVERT_SWAR
+#define SV_CONVERT_ZEROS ((uint64_t)0x3030303030303030ULL)
+#define SV_CONVERT_HIGH_NIBBLES ((uint64_t)0xF0F0F0F0F0F0F0F0ULL)
+#define SV_CONVERT_SIXES ((uint64_t)0x0606060606060606ULL)
+
+/* Non-0 if all 8 bytes of little endian word @w are ASCII digits:
+ * the high nibble is 3 and adding 6 does not carry out of the low one
+ */
+#define SV_CONVERT_ALL_DIGITS(w) \
+  (((w) & SV_CONVERT_HIGH_NIBBLES) == SV_CONVERT_ZEROS && \
+   (((w) + SV_CONVERT_SIXES) & SV_CONVERT_HIGH_NIBBLES) == SV_CONVERT_ZEROS)
+
+/* Value of 8 ASCII digits in little endian word @w, most significant
+ * first in memory: combine pairs, then pairs of pairs, then halves with
+ * multiplies instead of a loop of 8
+ */
+static uint64_t
+sv_convert_eight_digits(uint64_t w)
+{
+  const uint64_t mask = 0x000000FF000000FFULL;
+  const uint64_t mul1 = 100 + (1000000ULL << 32);
+  const uint64_t mul2 = 1 + (10000ULL << 32);
+
+  w -= SV_CONVERT_ZEROS;
+  w = (w * 10) + (w >> 8);
+  w = (((w & mask) * mul1) + (((w >> 16) & mask) * mul2)) >> 32;
+
+  return w;
+}
+#endif
+
+
+/**
+ * sv_field_to_int64:
+ * @field: field text (need not be NUL terminated)
+ * @len: length of @field
+ * @value_p: pointer to store value
+ *
+ * Convert a field to a 64 bit signed integer
+ *
+ * The field must be an optional sign followed by only decimal digits;
+ * no whitespace.  Digits are converted 8 at a time where the platform
+ * allows, so this can be called on the fields and widths given to a
+ * #sv_fields_callback without copying them.
+ *
+ * Return value: non-0 if @field is not an integer or is out of range
+ */
+sv_status_t
+sv_field_to_int64(const char* field, size_t len, int64_t* value_p)
+{
+  uint64_t value = 0;
+  uint64_t limit = (uint64_t)INT64_MAX;
+  int negative = 0;
+  size_t i = 0;
+  size_t ndigits;
+
+  if(!field)
+    return SV_STATUS_FAILED;
+
+  if(len && (field[0] == '-' || field[0] == '+')) {
+    negative = (field[0] == '-');
+    if(negative)
+      limit++;
+    i++;
+  }
+  if(i == len)
+    return SV_STATUS_FAILED;
+
+  /* leading zeros do not count towards the 19 digits that fit */
+  while(i < len - 1 && field[i] == '0')
+    i++;
+
+  ndigits = len - i;
+  if(ndigits > 19)
+    return SV_STATUS_FAILED;
+
+#ifdef SV_CONVERT_SWAR
+  while(len - i >= 8) {
+    uint64_t w;
+
+    memcpy(&w, field + i, sizeof(w));
+    if(!SV_CONVERT_ALL_DIGITS(w))
+      return SV_STATUS_FAILED;
+    value = value * 100000000ULL + sv_convert_eight_digits(w);
+    i += 8;
+  }
+#endif
+
+  for(; i < len; i++) {
+    unsigned int d = (unsigned int)(unsigned char)field[i] - '0';
+
+    if(d > 9)
+      return SV_STATUS_FAILED;
+    value = value * 10 + d;
+  }
+
+  /* 19 digits are less than 2^64 so only the sign limit is checked */
+  if(value > limit)
+    return SV_STATUS_FAILED;
+
+  if(negative)
+    *value_p = (value == (uint64_t)INT64_MAX + 1) ? INT64_MIN :
+      -(int64_t)value;
+  else
+    *value_p = (int64_t)value;
+
+  return SV_STATUS_OK;
+}
+
+
+/**
+ * sv_fields_to_int64:
+ * @fields: array of fields
+ * @widths: array of field widths
+ * @count: size of @fields and @widths
+ * @values: array of @count values to set
+ * @ok: array of @count flags to set (or NULL)
+ *
+ * Convert an array of fields to 64 bit signed integers with
+ * sv_field_to_int64()
+ *
+ * A NULL field or one that is not an integer sets the value to 0 and
+ * the flag to 0; the flag is 1 for converted values.
+ *
+ * Return value: #SV_STATUS_OK if every field was converted
+ */
+sv_status_t
+sv_fields_to_int64(char** fields, size_t* widths, size_t count,
+                   int64_t* values, unsigned char* ok)
+{
+  sv_status_t status = SV_STATUS_OK;
+  size_t i;
+
+  for(i = 0; i < count; i++) {
+    int converted = !sv_field_to_int64(fields[i], widths[i], &values[i]);
+
+    if(!converted) {
+      values[i] = 0;
+      status = SV_STATUS_FAILED;
+    }
+    if(ok)
+      ok[i] = (unsigned char)converted;
+  }
+
+  return status;
+}
+
+
+/* Non-0 if @field is @word ignoring case */
+static int
+sv_convert_word(const char* field, size_t len, const char* word)
+{
+  size_t i;
+
+  if(len != strlen(word))
+    return 0;
+  for(i = 0; i < len; i++) {
+    if(tolower((unsigned char)field[i]) != word[i])
+      return 0;
+  }
+  return 1;
+}
+
+
+/* decimal exponents with 128 bit powers of 5 in sv_convert_pow5 */
+#define SV_CONVERT_MIN_POW10 -64
+#define SV_CONVERT_MAX_POW10 64
+
+/* Powers of 5 normalized so the top bit is set, truncated to 128 bits
+ * (rounded up for negative powers), high 64 bits first
+ */
+static const uint64_t sv_convert_pow5[SV_CONVERT_MAX_POW10 - SV_CONVERT_MIN_POW10 + 1][2] = {
+  { 0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL }, /* 5^-64 */
+  { 0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL }, /* 5^-63 */
+  { 0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL }, /* 5^-62 */
+  { 0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL }, /* 5^-61 */
+  { 0xcdb02555653131b6ULL, 0x3792f412cb06794dULL }, /* 5^-60 */
+  { 0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL }, /* 5^-59 */
+  { 0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL }, /* 5^-58 */
+  { 0xc8de047564d20a8bULL, 0xf245825a5a445275ULL }, /* 5^-57 */
+  { 0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL }, /* 5^-56 */
+  { 0x9ced737bb6c4183dULL, 0x55464dd69685606bULL }, /* 5^-55 */
+  { 0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL }, /* 5^-54 */
+  { 0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL }, /* 5^-53 */
+  { 0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL }, /* 5^-52 */
+  { 0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL }, /* 5^-51 */
+  { 0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL }, /* 5^-50 */
+  { 0x95a8637627989aadULL, 0xdde7001379a44aa8ULL }, /* 5^-49 */
+  { 0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL }, /* 5^-48 */
+  { 0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL }, /* 5^-47 */
+  { 0x9226712162ab070dULL, 0xcab3961304ca70e8ULL }, /* 5^-46 */
+  { 0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL }, /* 5^-45 */
+  { 0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL }, /* 5^-44 */
+  { 0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL }, /* 5^-43 */
+  { 0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL }, /* 5^-42 */
+  { 0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL }, /* 5^-41 */
+  { 0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL }, /* 5^-40 */
+  { 0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL }, /* 5^-39 */
+  { 0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL }, /* 5^-38 */
+  { 0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL }, /* 5^-37 */
+  { 0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL }, /* 5^-36 */
+  { 0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL }, /* 5^-35 */
+  { 0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL }, /* 5^-34 */
+  { 0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL }, /* 5^-33 */
+  { 0xcfb11ead453994baULL, 0x67de18eda5814af2ULL }, /* 5^-32 */
+  { 0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL }, /* 5^-31 */
+  { 0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL }, /* 5^-30 */
+  { 0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL }, /* 5^-29 */
+  { 0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL }, /* 5^-28 */
+  { 0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL }, /* 5^-27 */
+  { 0xc612062576589ddaULL, 0x95364afe032a819eULL }, /* 5^-26 */
+  { 0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL }, /* 5^-25 */
+  { 0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL }, /* 5^-24 */
+  { 0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL }, /* 5^-23 */
+  { 0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL }, /* 5^-22 */
+  { 0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL }, /* 5^-21 */
+  { 0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL }, /* 5^-20 */
+  { 0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL }, /* 5^-19 */
+  { 0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL }, /* 5^-18 */
+  { 0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL }, /* 5^-17 */
+  { 0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL }, /* 5^-16 */
+  { 0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL }, /* 5^-15 */
+  { 0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL }, /* 5^-14 */
+  { 0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL }, /* 5^-13 */
+  { 0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL }, /* 5^-12 */
+  { 0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL }, /* 5^-11 */
+  { 0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL }, /* 5^-10 */
+  { 0x89705f4136b4a597ULL, 0x31680a88f8953031ULL }, /* 5^-9 */
+  { 0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL }, /* 5^-8 */
+  { 0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL }, /* 5^-7 */
+  { 0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL }, /* 5^-6 */
+  { 0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL }, /* 5^-5 */
+  { 0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL }, /* 5^-4 */
+  { 0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL }, /* 5^-3 */
+  { 0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL }, /* 5^-2 */
+  { 0xccccccccccccccccULL, 0xcccccccccccccccdULL }, /* 5^-1 */
+  { 0x8000000000000000ULL, 0x0000000000000000ULL }, /* 5^0 */
+  { 0xa000000000000000ULL, 0x0000000000000000ULL }, /* 5^1 */
+  { 0xc800000000000000ULL, 0x0000000000000000ULL }, /* 5^2 */
+  { 0xfa00000000000000ULL, 0x0000000000000000ULL }, /* 5^3 */
+  { 0x9c40000000000000ULL, 0x0000000000000000ULL }, /* 5^4 */
+  { 0xc350000000000000ULL, 0x0000000000000000ULL }, /* 5^5 */
+  { 0xf424000000000000ULL, 0x0000000000000000ULL }, /* 5^6 */
+  { 0x9896800000000000ULL, 0x0000000000000000ULL }, /* 5^7 */
+  { 0xbebc200000000000ULL, 0x0000000000000000ULL }, /* 5^8 */
+  { 0xee6b280000000000ULL, 0x0000000000000000ULL }, /* 5^9 */
+  { 0x9502f90000000000ULL, 0x0000000000000000ULL }, /* 5^10 */
+  { 0xba43b74000000000ULL, 0x0000000000000000ULL }, /* 5^11 */
+  { 0xe8d4a51000000000ULL, 0x0000000000000000ULL }, /* 5^12 */
+  { 0x9184e72a00000000ULL, 0x0000000000000000ULL }, /* 5^13 */
+  { 0xb5e620f480000000ULL, 0x0000000000000000ULL }, /* 5^14 */
+  { 0xe35fa931a0000000ULL, 0x0000000000000000ULL }, /* 5^15 */
+  { 0x8e1bc9bf04000000ULL, 0x0000000000000000ULL }, /* 5^16 */
+  { 0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL }, /* 5^17 */
+  { 0xde0b6b3a76400000ULL, 0x0000000000000000ULL }, /* 5^18 */
+  { 0x8ac7230489e80000ULL, 0x0000000000000000ULL }, /* 5^19 */
+  { 0xad78ebc5ac620000ULL, 0x0000000000000000ULL }, /* 5^20 */
+  { 0xd8d726b7177a8000ULL, 0x0000000000000000ULL }, /* 5^21 */
+  { 0x878678326eac9000ULL, 0x0000000000000000ULL }, /* 5^22 */
+  { 0xa968163f0a57b400ULL, 0x0000000000000000ULL }, /* 5^23 */
+  { 0xd3c21bcecceda100ULL, 0x0000000000000000ULL }, /* 5^24 */
+  { 0x84595161401484a0ULL, 0x0000000000000000ULL }, /* 5^25 */
+  { 0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL }, /* 5^26 */
+  { 0xcecb8f27f4200f3aULL, 0x0000000000000000ULL }, /* 5^27 */
+  { 0x813f3978f8940984ULL, 0x4000000000000000ULL }, /* 5^28 */
+  { 0xa18f07d736b90be5ULL, 0x5000000000000000ULL }, /* 5^29 */
+  { 0xc9f2c9cd04674edeULL, 0xa400000000000000ULL }, /* 5^30 */
+  { 0xfc6f7c4045812296ULL, 0x4d00000000000000ULL }, /* 5^31 */
+  { 0x9dc5ada82b70b59dULL, 0xf020000000000000ULL }, /* 5^32 */
+  { 0xc5371912364ce305ULL, 0x6c28000000000000ULL }, /* 5^33 */
+  { 0xf684df56c3e01bc6ULL, 0xc732000000000000ULL }, /* 5^34 */
+  { 0x9a130b963a6c115cULL, 0x3c7f400000000000ULL }, /* 5^35 */
+  { 0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL }, /* 5^36 */
+  { 0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL }, /* 5^37 */
+  { 0x96769950b50d88f4ULL, 0x1314448000000000ULL }, /* 5^38 */
+  { 0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL }, /* 5^39 */
+  { 0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL }, /* 5^40 */
+  { 0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL }, /* 5^41 */
+  { 0xb7abc627050305adULL, 0xf14a3d9e40000000ULL }, /* 5^42 */
+  { 0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL }, /* 5^43 */
+  { 0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL }, /* 5^44 */
+  { 0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL }, /* 5^45 */
+  { 0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL }, /* 5^46 */
+  { 0x8c213d9da502de45ULL, 0x4526f422cc340000ULL }, /* 5^47 */
+  { 0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL }, /* 5^48 */
+  { 0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL }, /* 5^49 */
+  { 0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL }, /* 5^50 */
+  { 0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL }, /* 5^51 */
+  { 0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL }, /* 5^52 */
+  { 0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL }, /* 5^53 */
+  { 0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL }, /* 5^54 */
+  { 0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL }, /* 5^55 */
+  { 0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL }, /* 5^56 */
+  { 0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL }, /* 5^57 */
+  { 0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL }, /* 5^58 */
+  { 0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL }, /* 5^59 */
+  { 0x9f4f2726179a2245ULL, 0x01d762422c946590ULL }, /* 5^60 */
+  { 0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL }, /* 5^61 */
+  { 0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL }, /* 5^62 */
+  { 0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL }, /* 5^63 */
+  { 0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL }  /* 5^64 */
+};
+
+/* Exact powers of 10 as doubles */
+static const double sv_convert_exact_pow10[23] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+/* 64 x 64 bit multiply returning the high 64 bits and setting *@lo_p
+ * to the low 64 bits
+ */
+static uint64_t
+sv_convert_mul128(uint64_t a, uint64_t b, uint64_t* lo_p)
+{
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 p = (unsigned __int128)a * b;
+
+  *lo_p = (uint64_t)p;
+  return (uint64_t)(p >> 64);
+#else
+  uint64_t a_lo = a & 0xFFFFFFFFU, a_hi = a >> 32;
+  uint64_t b_lo = b & 0xFFFFFFFFU, b_hi = b >> 32;
+  uint64_t lo_lo = a_lo * b_lo;
+  uint64_t hi_lo = a_hi * b_lo;
+  uint64_t lo_hi = a_lo * b_hi;
+  uint64_t hi_hi = a_hi * b_hi;
+  uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFU) + lo_hi;
+
+  *lo_p = (cross << 32) | (lo_lo & 0xFFFFFFFFU);
+  return (hi_lo >> 32) + (cross >> 32) + hi_hi;
+#endif
+}
+
+
+/* Number of leading zero bits in non-0 @w */
+static int
+sv_convert_clz64(uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_clzll(w);
+#else
+  int n = 0;
+
+  while(!(w & ((uint64_t)1 << 63))) {
+    w <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+
+/*
+ * Eisel-Lemire: the double nearest to non-0 @w * 10^@q computed from
+ * the 128 bit product of @w and 5^@q.  Returns non-0 if @q is out of
+ * the table range, the result is subnormal or the product is too close
+ * to a rounding boundary to decide, so the caller must fall back.
+ */
+static int
+sv_convert_eisel_lemire(uint64_t w, int q, int negative, double* value_p)
+{
+  const uint64_t* pow5;
+  uint64_t lo, hi, lo2, mantissa, bits;
+  int lz, upperbit;
+  int power2;
+  int p;
+
+  if(q < SV_CONVERT_MIN_POW10 || q > SV_CONVERT_MAX_POW10)
+    return 1;
+
+  pow5 = sv_convert_pow5[q - SV_CONVERT_MIN_POW10];
+  lz = sv_convert_clz64(w);
+  w <<= lz;
+
+  hi = sv_convert_mul128(w, pow5[0], &lo);
+  /* the low 9 bits below the 55 kept are all 1s: the truncated power
+   * may matter so add the product with its low 64 bits
+   */
+  if((hi & 0x1FF) == 0x1FF && lo + w < lo) {
+    uint64_t hi2 = sv_convert_mul128(w, pow5[1], &lo2);
+
+    lo += hi2;
+    if(hi2 > lo)
+      hi++;
+    if((hi & 0x1FF) == 0x1FF && lo + 1 == 0 && lo2 + w < lo2)
+      return 1;
+  }
+
+  upperbit = (int)(hi >> 63);
+  mantissa = hi >> (upperbit + 9);
+
+  /* floor(q * log2(10)) + 63 without shifting a negative value */
+  p = 217706 * q;
+  p = (p >= 0) ? (p >> 16) : -((-p + 65535) >> 16);
+  power2 = p + 63 + upperbit - lz + 1023;
+  if(power2 <= 0)
+    return 1;
+
+  /* exactly half way: round to even */
+  if(lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 &&
+     (mantissa << (upperbit + 9)) == hi)
+    mantissa &= ~(uint64_t)1;
+
+  mantissa += (mantissa & 1);
+  mantissa >>= 1;
+  if(mantissa >= ((uint64_t)2 << 52)) {
+    mantissa = (uint64_t)1 << 52;
+    power2++;
+  }
+  mantissa &= ~((uint64_t)1 << 52);
+
+  if(power2 >= 0x7FF)
+    bits = (uint64_t)0x7FF << 52;
+  else
+    bits = mantissa | ((uint64_t)power2 << 52);
+  if(negative)
+    bits |= (uint64_t)1 << 63;
+
+  memcpy(value_p, &bits, sizeof(bits));
+  return 0;
+}
+
+
+/* Convert with strtod() using the locale decimal point */
+static sv_status_t
+sv_convert_strtod(const char* field, size_t len, double* value_p)
+{
+  char stack_buffer[SV_CONVERT_MAX_DOUBLE_LEN + 1];
+  char* buffer = stack_buffer;
+  const char* point = localeconv()->decimal_point;
+  char* end;
+  size_t i;
+  sv_status_t status = SV_STATUS_OK;
+
+  if(len > SV_CONVERT_MAX_DOUBLE_LEN) {
+    buffer = (char*)malloc(len + 1);
+    if(!buffer)
+      return SV_STATUS_NO_MEMORY;
+  }
+
+  memcpy(buffer, field, len);
+  buffer[len] = '\0';
+  if(point && point[0] && point[0] != '.' && !point[1]) {
+    for(i = 0; i < len; i++) {
+      if(buffer[i] == '.')
+        buffer[i] = point[0];
+    }
+  }
+
+  *value_p = strtod(buffer, &end);
+  if(end != buffer + len)
+    status = SV_STATUS_FAILED;
+
+  if(buffer != stack_buffer)
+    free(buffer);
+
+  return status;
+}
+
+
+/**
+ * sv_field_to_double:
+ * @field: field text (need not be NUL terminated)
+ * @len: length of @field
+ * @value_p: pointer to store value
+ *
+ * Convert a field to a double
+ *
+ * The field must be a decimal number with an optional sign, fraction
+ * and exponent, or inf, infinity or nan in any case; no whitespace or
+ * hex.  The decimal point is always '.' whatever the locale.  The
+ * result is correctly rounded: up to 19 significant digits are
+ * converted directly and only very long, very large or very small
+ * numbers go through strtod().  Numbers too large for a double are
+ * infinity.  This can be called on the fields and widths given to a
+ * #sv_fields_callback without copying them.
+ *
+ * Return value: non-0 if @field is not a number
+ */
+sv_status_t
+sv_field_to_double(const char* field, size_t len, double* value_p)
+{
+  const char* s = field;
+  size_t slen = len;
+  uint64_t w = 0;
+  int negative = 0;
+  int ndigits = 0;
+  int seen_digit = 0;
+  int truncated = 0;
+  long exp10 = 0;
+  size_t i = 0;
+
+  if(!field || !len)
+    return SV_STATUS_FAILED;
+
+  if(s[0] == '-' || s[0] == '+') {
+    negative = (s[0] == '-');
+    s++;
+    slen--;
+  }
+
+  if(sv_convert_word(s, slen, "inf") || sv_convert_word(s, slen, "infinity")) {
+    *value_p = negative ? -HUGE_VAL : HUGE_VAL;
+    return SV_STATUS_OK;
+  }
+  if(sv_convert_word(s, slen, "nan")) {
+    *value_p = negative ? -NAN : NAN;
+    return SV_STATUS_OK;
+  }
+
+  /* significand: at most 19 significant digits are kept in w */
+  for(; i < slen && s[i] >= '0' && s[i] <= '9'; i++) {
+    unsigned int d = (unsigned int)(s[i] - '0');
+
+    seen_digit = 1;
+    if(ndigits < 19) {
+      w = w * 10 + d;
+      if(w)
+        ndigits++;
+    } else {
+      exp10++;
+      if(d)
+        truncated = 1;
+    }
+  }
+  if(i < slen && s[i] == '.') {
+    for(i++; i < slen && s[i] >= '0' && s[i] <= '9'; i++) {
+      unsigned int d = (unsigned int)(s[i] - '0');
+
+      seen_digit = 1;
+      if(ndigits < 19) {
+        w = w * 10 + d;
+        if(w)
+          ndigits++;
+        exp10--;
+      } else if(d)
+        truncated = 1;
+    }
+  }
+  if(!seen_digit)
+    return SV_STATUS_FAILED;
+
+  if(i < slen && (s[i] == 'e' || s[i] == 'E')) {
+    int exp_negative = 0;
+    long e = 0;
+
+    i++;
+    if(i < slen && (s[i] == '-' || s[i] == '+')) {
+      exp_negative = (s[i] == '-');
+      i++;
+    }
+    if(i == slen)
+      return SV_STATUS_FAILED;
+    for(; i < slen && s[i] >= '0' && s[i] <= '9'; i++) {
+      /* any larger exponent is 0 or infinity */
+      if(e < 100000)
+        e = e * 10 + (s[i] - '0');
+    }
+    exp10 += exp_negative ? -e : e;
+  }
+  if(i != slen)
+    return SV_STATUS_FAILED;
+
+  if(!w) {
+    *value_p = negative ? -0.0 : 0.0;
+    return SV_STATUS_OK;
+  }
+
+  if(!truncated) {
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    /* Clinger: both w and 10^|exp10| are exact doubles so one IEEE
+     * multiply or divide rounds correctly
+     */
+    if(w <= ((uint64_t)1 << 53) && exp10 >= -22 && exp10 <= 22) {
+      double d = (double)w;
+
+      if(exp10 < 0)
+        d /= sv_convert_exact_pow10[-exp10];
+      else
+        d *= sv_convert_exact_pow10[exp10];
+      *value_p = negative ? -d : d;
+      return SV_STATUS_OK;
+    }
+#endif
+    if(!sv_convert_eisel_lemire(w, (int)exp10, negative, value_p))
+      return SV_STATUS_OK;
+  }
+
+  return sv_convert_strtod(field, len, value_p);
+}
+
+
+/**
+ * sv_fields_to_double:
+ * @fields: array of fields
+ * @widths: array of field widths
+ * @count: size of @fields and @widths
+ * @values: array of @count values to set
+ * @ok: array of @count flags to set (or NULL)
+ *
+ * Convert an array of fields to doubles with sv_field_to_double()
+ *
+ * A NULL field or one that is not a number sets the value to 0 and
+ * the flag to 0; the flag is 1 for converted values.
+ *
+ * Return value: #SV_STATUS_OK if every field was converted
+ */
+sv_status_t
+sv_fields_to_double(char** fields, size_t* widths, size_t count,
+                    double* values, unsigned char* ok)
+{
+  sv_status_t status = SV_STATUS_OK;
+  size_t i;
+
+  for(i = 0; i < count; i++) {
+    int converted = !sv_field_to_double(fields[i], widths[i], &values[i]);
+
+    if(!converted) {
+      values[i] = 0.0;
+      status = SV_STATUS_FAILED;
+    }
+    if(ok)
+      ok[i] = (unsigned char)converted;
+  }
+
+  return status;
+}
+
+
+/**
+ * sv_internal_field_to_bool:
+ * @field: field text (need not be NUL terminated)
+ * @len: length of @field
+ * @value_p: pointer to store value
+ *
+ * INTERNAL - Convert true or false in any case
+ *
+ * Return value: non-0 if @field is not a boolean
+ */
+sv_status_t
+sv_internal_field_to_bool(const char* field, size_t len, int* value_p)
+{
+  if(sv_convert_word(field, len, "true"))
+    *value_p = 1;
+  else if(sv_convert_word(field, len, "false"))
+    *value_p = 0;
+  else
+    return SV_STATUS_FAILED;
+
+  return SV_STATUS_OK;
+}
+
+
+/* Value of the @n ASCII digits at @s or -1 if any is not a digit */
+static int
+sv_convert_digits(const char* s, size_t n)
+{
+  int value = 0;
+  size_t i;
+
+  for(i = 0; i < n; i++) {
+    unsigned int d = (unsigned int)(unsigned char)s[i] - '0';
+
+    if(d > 9)
+      return -1;
+    value = value * 10 + (int)d;
+  }
+  return value;
+}
+
+
+/* Days from 1970-01-01 to @year-@month-@day in the proleptic
+ * Gregorian calendar
+ */
+static int64_t
+sv_convert_days_from_civil(int year, int month, int day)
+{
+  int64_t era;
+  int yoe, doy, doe;
+
+  if(month <= 2)
+    year--;
+  era = (year >= 0 ? year : year - 399) / 400;
+  yoe = (int)(year - era * 400);
+  doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+  return era * 146097 + doe - 719468;
+}
+
+
+/* Non-0 if @day is a day of @month in @year */
+static int
+sv_convert_valid_date(int year, int month, int day)
+{
+  static const unsigned char month_days[12] = {
+    31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+  };
+
+  if(month < 1 || month > 12 || day < 1 || day > month_days[month - 1])
+    return 0;
+  if(month == 2 && day == 29)
+    return !(year % 4) && ((year % 100) || !(year % 400));
+  return 1;
+}
+
+
+/*
+ * Parse the offset from UTC at @s of @len bytes: Z, +HH:MM, +HHMM or
+ * +HH (or -); sets *@offset_p to seconds east of UTC.  Returns non-0
+ * if it is not an offset.
+ */
+static int
+sv_convert_utc_offset(const char* s, size_t len, int* offset_p)
+{
+  int sign, hours, minutes = 0;
+
+  if(len == 1 && (s[0] == 'Z' || s[0] == 'z')) {
+    *offset_p = 0;
+    return 0;
+  }
+  if(len < 3 || (s[0] != '+' && s[0] != '-'))
+    return 1;
+  sign = (s[0] == '-') ? -1 : 1;
+
+  hours = sv_convert_digits(s + 1, 2);
+  if(len == 6 && s[3] == ':')
+    minutes = sv_convert_digits(s + 4, 2);
+  else if(len == 5)
+    minutes = sv_convert_digits(s + 3, 2);
+  else if(len != 3)
+    return 1;
+  if(hours < 0 || hours > 23 || minutes < 0 || minutes > 59)
+    return 1;
+
+  *offset_p = sign * (hours * 3600 + minutes * 60);
+  return 0;
+}
+
+
+/**
+ * sv_field_to_epoch_ns:
+ * @field: field text (need not be NUL terminated)
+ * @len: length of @field
+ * @value_p: pointer to store value
+ *
+ * Convert an ISO 8601 / RFC 3339 timestamp field to nanoseconds since
+ * 1970-01-01T00:00:00Z
+ *
+ * Accepts YYYY-MM-DD, optionally followed by 'T', 't' or a space and
+ * HH:MM:SS, an optional fraction of 1 to 9 digits after '.' or ','
+ * (further digits are ignored) and an optional offset: Z, +HH:MM,
+ * +HHMM or +HH (or -).  A timestamp without an offset is UTC.  Second
+ * 60 is accepted for leap seconds and is the following second.  The
+ * fixed width date and time are validated and converted a word at a
+ * time where the platform allows; this can be called on the fields
+ * and widths given to a #sv_fields_callback without copying them.
+ *
+ * Return value: non-0 if @field is not a valid timestamp or is
+ * outside the range of 64 bit nanoseconds (years 1677 to 2262)
+ */
+sv_status_t
+sv_field_to_epoch_ns(const char* field, size_t len, int64_t* value_p)
+{
+  int year, month, day;
+  int hour = 0, minute = 0, second = 0;
+  int64_t nanos = 0;
+  int offset = 0;
+  int64_t seconds;
+  size_t i;
+
+  if(!field || (len != 10 && len < 19))
+    return SV_STATUS_FAILED;
+
+#ifdef SV_CONVERT_SWAR
+  if(len >= 19) {
+    /* "YYYY-MM-" and "DDTHH:MM" with separators (the T may also be t
+     * or space) masked out of the digits
+     */
+    const uint64_t digits1 = 0x00FFFF00FFFFFFFFULL;
+    const uint64_t seps1 = 0x2D00002D00000000ULL;
+    const uint64_t digits2 = 0xFFFF00FFFF00FFFFULL;
+    const uint64_t seps2 = 0x00003A0000000000ULL;
+    uint64_t w1, w2;
+    unsigned char t = (unsigned char)field[10];
+
+    memcpy(&w1, field, sizeof(w1));
+    memcpy(&w2, field + 8, sizeof(w2));
+    if((w1 & ~digits1) != seps1 ||
+       (w2 & ~digits2 & ~((uint64_t)0xFF << 16)) != seps2 ||
+       (t != 'T' && t != 't' && t != ' ') || field[16] != ':')
+      return SV_STATUS_FAILED;
+
+    w1 = (w1 & digits1) | (~digits1 & SV_CONVERT_ZEROS);
+    w2 = (w2 & digits2) | (~digits2 & SV_CONVERT_ZEROS);
+    if(!SV_CONVERT_ALL_DIGITS(w1) || !SV_CONVERT_ALL_DIGITS(w2))
+      return SV_STATUS_FAILED;
+
+    /* byte i of each word becomes the 2 digit value at i, i+1 */
+    w1 -= SV_CONVERT_ZEROS;
+    w2 -= SV_CONVERT_ZEROS;
+    w1 = (w1 * 10) + (w1 >> 8);
+    w2 = (w2 * 10) + (w2 >> 8);
+    year = (int)(w1 & 0xFF) * 100 + (int)((w1 >> 16) & 0xFF);
+    month = (int)((w1 >> 40) & 0xFF);
+    day = (int)(w2 & 0xFF);
+    hour = (int)((w2 >> 24) & 0xFF);
+    minute = (int)((w2 >> 48) & 0xFF);
+    second = sv_convert_digits(field + 17, 2);
+  } else
+#endif
+  {
+    if(field[4] != '-' || field[7] != '-')
+      return SV_STATUS_FAILED;
+    year = sv_convert_digits(field, 4);
+    month = sv_convert_digits(field + 5, 2);
+    day = sv_convert_digits(field + 8, 2);
+    if(len >= 19) {
+      if((field[10] != 'T' && field[10] != 't' && field[10] != ' ') ||
+         field[13] != ':' || field[16] != ':')
+        return SV_STATUS_FAILED;
+      hour = sv_convert_digits(field + 11, 2);
+      minute = sv_convert_digits(field + 14, 2);
+      second = sv_convert_digits(field + 17, 2);
+    }
+  }
+
+  if(year < 0 || !sv_convert_valid_date(year, month, day) ||
+     hour < 0 || hour > 23 || minute < 0 || minute > 59 ||
+     second < 0 || second > 60)
+    return SV_STATUS_FAILED;
+
+  i = (len >= 19) ? 19 : 10;
+
+  if(i < len && (field[i] == '.' || field[i] == ',')) {
+    size_t start = ++i;
+    int64_t scale = 100000000;
+
+    for(; i < len && field[i] >= '0' && field[i] <= '9'; i++) {
+      nanos += (field[i] - '0') * scale;
+      scale /= 10;
+    }
+    if(i == start)
+      return SV_STATUS_FAILED;
+  }
+
+  if(i < len && sv_convert_utc_offset(field + i, len - i, &offset))
+    return SV_STATUS_FAILED;
+
+  seconds = sv_convert_days_from_civil(year, month, day) * 86400 +
+    hour * 3600 + minute * 60 + second - offset;
+
+  /* take the fraction from the following second when negative so
+   * INT64_MIN (1677-09-21T00:12:43.145224192Z) can be reached
+   */
+  if(seconds < 0 && nanos) {
+    seconds++;
+    nanos -= 1000000000;
+  }
+  if(seconds < INT64_MIN / 1000000000 || seconds > INT64_MAX / 1000000000)
+    return SV_STATUS_FAILED;
+  seconds *= 1000000000;
+  if((nanos < 0 && seconds < INT64_MIN - nanos) ||
+     (nanos > 0 && seconds > INT64_MAX - nanos))
+    return SV_STATUS_FAILED;
+
+  *value_p = seconds + nanos;
+  return SV_STATUS_OK;
+}
+
+
+/**
+ * sv_fields_to_epoch_ns:
+ * @fields: array of fields
+ * @widths: array of field widths
+ * @count: size of @fields and @widths
+ * @values: array of @count values to set
+ * @ok: array of @count flags to set (or NULL)
+ *
+ * Convert an array of timestamp fields to nanoseconds since the epoch
+ * with sv_field_to_epoch_ns()
+ *
+ * A NULL field or one that is not a timestamp sets the value to 0 and
+ * the flag to 0; the flag is 1 for converted values.
+ *
+ * Return value: #SV_STATUS_OK if every field was converted
+ */
+sv_status_t
+sv_fields_to_epoch_ns(char** fields, size_t* widths, size_t count,
+                      int64_t* values, unsigned char* ok)
+{
+  sv_status_t status = SV_STATUS_OK;
+  size_t i;
+
+  for(i = 0; i < count; i++) {
+    int converted = !sv_field_to_epoch_ns(fields[i], widths[i], &values[i]);
+
+    if(!converted) {
+      values[i] = 0;
+      status = SV_STATUS_FAILED;
+    }
+    if(ok)
+      ok[i] = (unsigned char)converted;
+  }
+
+  return status;
+}
@@ -0,0 +1,363 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * count.c - Count and validate records without parsing fields
+ *
+ * Copyright (C) 2025, Dave Beckett https://www.dajobe.org/
+ *
+ * This package is Free Software
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef SV_CONFIG
+#include <sv_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include <sv.h>
+#include "sv_internal.h"
+
+
+/* Record scanner states; these follow the sv_state_t parser states
+ * that change the record or field counts
+ */
+typedef enum {
+  /* at start of a row, skipping blank lines */
+  SV_COUNT_ROW,
+  /* at start of a cell */
+  SV_COUNT_CELL,
+  /* in an unquoted cell */
+  SV_COUNT_IN_CELL,
+  /* after an escape in an unquoted cell */
+  SV_COUNT_ESC_IN_CELL,
+  /* in an unquoted cell after an escaped end of line */
+  SV_COUNT_ESC_EOL,
+  /* in a quoted cell */
+  SV_COUNT_QUOTED,
+  /* after an escape in a quoted cell */
+  SV_COUNT_ESC_IN_QUOTED,
+  /* after a quote in a quoted cell */
+  SV_COUNT_QUOTE_IN_QUOTED,
+  /* after whitespace following the end of a quoted cell */
+  SV_COUNT_AFTER_QUOTED
+} sv_count_state;
+
+
+/* Scanner state while counting one buffer */
+typedef struct
+{
+  sv* t;
+  sv_record_counts* counts;
+  const char* data;
+  /* rows still to skip */
+  int skip_rows;
+  /* offset of the start of the current row */
+  size_t row_start;
+  /* fields in the current row */
+  size_t fields;
+  /* offset of the first malformed byte in the current row or
+   * #SV_COUNT_NO_OFFSET
+   */
+  size_t bad_offset;
+} sv_counter;
+
+
+/* Note the first malformed byte of the current row */
+static void
+sv_count_bad(sv_counter* c, size_t offset)
+{
+  if(c->bad_offset == SV_COUNT_NO_OFFSET)
+    c->bad_offset = offset;
+}
+
+
+/* Count the current row as malformed if a malformed byte was seen */
+static void
+sv_count_check_row(sv_counter* c)
+{
+  sv_record_counts* counts = c->counts;
+
+  if(c->bad_offset != SV_COUNT_NO_OFFSET) {
+    if(!counts->bad_records++)
+      counts->bad_offset = c->bad_offset;
+    c->bad_offset = SV_COUNT_NO_OFFSET;
+  }
+}
+
+
+/* Finish a row that ended at @end: count it unless it is skipped or
+ * a comment, the same as sv_parse_chunk() would
+ */
+static void
+sv_count_end_row(sv_counter* c, size_t end)
+{
+  sv* t = c->t;
+  sv_record_counts* counts = c->counts;
+
+  sv_count_check_row(c);
+
+  if(c->skip_rows > 0)
+    c->skip_rows--;
+  else if(t->comment_prefix && end - c->row_start >= t->comment_prefix_len &&
+          !memcmp(c->data + c->row_start, t->comment_prefix,
+                  t->comment_prefix_len))
+    ;
+  else {
+    if(!counts->records || c->fields < counts->min_fields)
+      counts->min_fields = c->fields;
+    if(c->fields > counts->max_fields)
+      counts->max_fields = c->fields;
+    counts->records++;
+  }
+
+  c->fields = 0;
+}
+
+
+/**
+ * sv_count_records:
+ * @t: sv object
+ * @data: complete input data
+ * @len: length of @data
+ * @counts: pointer to counts to return
+ *
+ * Count the records in @data and the fields in them and check the
+ * quoting, without parsing fields, calling callbacks or allocating
+ * memory.
+ *
+ * The separator, quote and escape characters and the
+ * #SV_OPTION_DOUBLE_QUOTE, #SV_OPTION_STRIP_WHITESPACE,
+ * #SV_OPTION_SKIP_ROWS and #SV_OPTION_COMMENT_PREFIX options of @t
+ * are used so the counts match what sv_parse_chunk() would return
+ * for @data followed by end of input.  Any header row is counted as
+ * a record.  @t is not otherwise used or changed.
+ *
+ * Quoting is malformed when a quote ending a quoted cell is followed
+ * by something other than a separator, end of line or whitespace
+ * that is stripped, or a quoted cell or escape is not finished at the
+ * end of @data.  The number of records with malformed quoting and the
+ * offset of the first malformed byte are returned in @counts; records
+ * not finished at the end of @data are not counted as records.
+ *
+ * Return value: #SV_STATUS_FAILED if @t or @counts is NULL or @data
+ * is NULL and @len is not 0
+ */
+sv_status_t
+sv_count_records(sv *t, const char *data, size_t len,
+                 sv_record_counts *counts)
+{
+  sv_counter c;
+  sv_count_state state = SV_COUNT_ROW;
+  /* offset of the start of the current quoted cell */
+  size_t quote_start = 0;
+  /* bytes that end an unquoted cell run */
+  char cell_stops[SV_SCAN_MAX_STOPS];
+  unsigned int cell_nstops = 0;
+  /* bytes that end a quoted cell run */
+  char quoted_stops[SV_SCAN_MAX_STOPS];
+  unsigned int quoted_nstops = 0;
+  size_t i = 0;
+
+  if(!t || !counts || (!data && len))
+    return SV_STATUS_FAILED;
+
+  memset(counts, '\0', sizeof(*counts));
+  counts->bad_offset = SV_COUNT_NO_OFFSET;
+
+  c.t = t;
+  c.counts = counts;
+  c.data = data;
+  c.skip_rows = t->skip_rows;
+  c.row_start = 0;
+  c.fields = 0;
+  c.bad_offset = SV_COUNT_NO_OFFSET;
+
+  cell_stops[cell_nstops++] = t->field_sep;
+  cell_stops[cell_nstops++] = '\n';
+  cell_stops[cell_nstops++] = '\r';
+  cell_stops[cell_nstops++] = '\0';
+  if(t->escape_char)
+    cell_stops[cell_nstops++] = t->escape_char;
+
+  quoted_stops[quoted_nstops++] = '\0';
+  if(t->quote_char)
+    quoted_stops[quoted_nstops++] = t->quote_char;
+  if(t->escape_char)
+    quoted_stops[quoted_nstops++] = t->escape_char;
+
+  while(i < len) {
+    char ch;
+    unsigned int cls;
+
+    /* Skip runs of bytes that cannot end a cell */
+    if(state == SV_COUNT_IN_CELL) {
+      i += sv_internal_scan_run(data + i, len - i, cell_stops, cell_nstops);
+      if(i == len)
+        break;
+    } else if(state == SV_COUNT_QUOTED) {
+      i += sv_internal_scan_run(data + i, len - i,
+                                quoted_stops, quoted_nstops);
+      if(i == len)
+        break;
+    }
+
+    ch = data[i];
+    /* NULs in data are ignored */
+    if(!ch) {
+      i++;
+      continue;
+    }
+    cls = t->char_class[(unsigned char)ch];
+
+    switch(state) {
+      case SV_COUNT_ROW:
+        if(ch == '\n' || ch == '\r')
+          break;
+        c.row_start = i;
+
+        /* FALLTHROUGH */
+      case SV_COUNT_CELL:
+        if(!cls)
+          state = SV_COUNT_IN_CELL;
+        else if(cls & SV_CLASS_EOL) {
+          c.fields++;
+          sv_count_end_row(&c, i);
+          state = SV_COUNT_ROW;
+        } else if(cls & SV_CLASS_QUOTE) {
+          quote_start = i;
+          state = SV_COUNT_QUOTED;
+        } else if(cls & SV_CLASS_ESCAPE)
+          state = SV_COUNT_ESC_IN_CELL;
+        else if(cls & SV_CLASS_SPACE)
+          state = SV_COUNT_CELL;
+        else {
+          /* separator: empty cell */
+          c.fields++;
+          state = SV_COUNT_CELL;
+        }
+        break;
+
+      case SV_COUNT_ESC_IN_CELL:
+        state = (ch == '\n' || ch == '\r') ? SV_COUNT_ESC_EOL :
+          SV_COUNT_IN_CELL;
+        break;
+
+      case SV_COUNT_ESC_EOL:
+      case SV_COUNT_IN_CELL:
+        if(cls & SV_CLASS_EOL) {
+          c.fields++;
+          sv_count_end_row(&c, i);
+          state = SV_COUNT_ROW;
+        } else if(cls & SV_CLASS_ESCAPE)
+          state = SV_COUNT_ESC_IN_CELL;
+        else if(cls & SV_CLASS_SEP) {
+          c.fields++;
+          state = SV_COUNT_CELL;
+        }
+        break;
+
+      case SV_COUNT_QUOTED:
+        if(cls & SV_CLASS_ESCAPE)
+          state = SV_COUNT_ESC_IN_QUOTED;
+        else if(cls & SV_CLASS_QUOTE)
+          state = (t->flags & SV_FLAGS_DOUBLE_QUOTE) ?
+            SV_COUNT_QUOTE_IN_QUOTED : SV_COUNT_IN_CELL;
+        break;
+
+      case SV_COUNT_ESC_IN_QUOTED:
+        state = SV_COUNT_QUOTED;
+        break;
+
+      case SV_COUNT_QUOTE_IN_QUOTED:
+        if(cls & SV_CLASS_QUOTE)
+          state = SV_COUNT_QUOTED;
+        else if(cls & SV_CLASS_SEP) {
+          c.fields++;
+          state = SV_COUNT_CELL;
+        } else if(cls & SV_CLASS_EOL) {
+          c.fields++;
+          sv_count_end_row(&c, i);
+          state = SV_COUNT_ROW;
+        } else if(cls & SV_CLASS_SPACE)
+          /* stripped whitespace after a quoted cell */
+          state = SV_COUNT_AFTER_QUOTED;
+        else {
+          /* <quote> not followed by <sep> or end of line */
+          sv_count_bad(&c, i);
+          state = SV_COUNT_IN_CELL;
+        }
+        break;
+
+      case SV_COUNT_AFTER_QUOTED:
+        if(cls & SV_CLASS_SEP) {
+          c.fields++;
+          state = SV_COUNT_CELL;
+        } else if(cls & SV_CLASS_EOL) {
+          c.fields++;
+          sv_count_end_row(&c, i);
+          state = SV_COUNT_ROW;
+        } else if(!(cls & SV_CLASS_SPACE)) {
+          sv_count_bad(&c, i);
+          state = (cls & SV_CLASS_ESCAPE) ? SV_COUNT_ESC_IN_CELL :
+            SV_COUNT_IN_CELL;
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    i++;
+  }
+
+  /* End of input */
+  switch(state) {
+    case SV_COUNT_CELL:
+    case SV_COUNT_IN_CELL:
+    case SV_COUNT_QUOTE_IN_QUOTED:
+    case SV_COUNT_AFTER_QUOTED:
+      c.fields++;
+      sv_count_end_row(&c, len);
+      break;
+
+    case SV_COUNT_ESC_IN_CELL:
+      /* the parser does not return a row ending in an escape */
+      sv_count_bad(&c, len - 1);
+      sv_count_check_row(&c);
+      break;
+
+    case SV_COUNT_ESC_EOL:
+      /* the parser does not return a row with an escaped end of line
+       * at the end of input
+       */
+      sv_count_check_row(&c);
+      break;
+
+    case SV_COUNT_QUOTED:
+    case SV_COUNT_ESC_IN_QUOTED:
+      /* unfinished quoted cell: the row is not returned */
+      sv_count_bad(&c, quote_start);
+      sv_count_check_row(&c);
+      break;
+
+    case SV_COUNT_ROW:
+    default:
+      break;
+  }
+
+  return SV_STATUS_OK;
+}
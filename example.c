@@ -176,7 +176,6 @@ main(int argc, char *argv[])
 {
   int rc = 0;
   const char* data_file = NULL;
-  FILE *fh = NULL;
   sv *t = NULL;
   myc c;
   size_t data_file_len;
@@ -216,14 +215,6 @@ main(int argc, char *argv[])
     goto tidy;
   }
 
-  fh = fopen(data_file, "r");
-  if(!fh) {
-    fprintf(stderr, "%s: Failed to read data file %s: %s\n",
-            program, data_file, strerror(errno));
-    rc = 1;
-    goto tidy;
-  }
-
   c.filename = data_file;
   c.count = 0;
   c.line = NULL;
@@ -251,18 +242,12 @@ main(int argc, char *argv[])
   sv_set_option(t, SV_OPTION_LINE_CALLBACK, my_sv_line_callback);
   sv_set_option(t, SV_OPTION_COMMENT_CALLBACK, my_sv_comment_callback);
 
-  while(!feof(fh)) {
-    char buffer[1024];
-    size_t len = fread(buffer, 1, sizeof(buffer), fh);
-
-    if(sv_parse_chunk(t, buffer, len))
-      break;
+  /* Parse the whole file and record EOF */
+  if(sv_parse_file(t, data_file)) {
+    fprintf(stderr, "%s: Failed to parse data file %s\n",
+            program, data_file);
+    rc = 1;
   }
-  fclose(fh);
-  fh = NULL;
-
-  /* Record EOF */
-  sv_parse_chunk(t, NULL, 0);
 
   fprintf(stderr, "%s: Saw %d records\n", program, c.count);
 
@@ -273,10 +258,5 @@ main(int argc, char *argv[])
   if(t)
     sv_free(t);
 
-  if(fh) {
-    fclose(fh);
-    fh = NULL;
-  }
-
   return rc;
 }
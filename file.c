@@ -0,0 +1,1233 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * file.c - Parse SV files
+ *
+ * Copyright (C) 2025, Dave Beckett https://www.dajobe.org/
+ *
+ * This package is Free Software
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef SV_CONFIG
+#include <sv_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include <sv.h>
+#include "sv_internal.h"
+
+
+/* File contents mapped or read into memory */
+typedef struct
+{
+  char* data;
+  size_t len;
+  /* non-0 if data was mmap()ed */
+  int mapped;
+} sv_file_data;
+
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_UNISTD_H)
+/* Unmap @len bytes at @data which may start part way into the first
+ * page of the mapping
+ */
+static void
+sv_file_data_unmap(char* data, size_t len)
+{
+  size_t skip = (size_t)((uintptr_t)data % (uintptr_t)sysconf(_SC_PAGESIZE));
+
+  munmap(data - skip, len + skip);
+}
+#endif
+
+
+static void
+sv_file_data_close(sv_file_data* fdata)
+{
+  if(fdata->data) {
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_UNISTD_H)
+    if(fdata->mapped)
+      sv_file_data_unmap(fdata->data, fdata->len);
+    else
+#endif
+      free(fdata->data);
+  }
+  fdata->data = NULL;
+  fdata->len = 0;
+  fdata->mapped = 0;
+}
+
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_STAT_H) && \
+  defined(HAVE_UNISTD_H)
+/* Map the rest of regular file @fd from its current offset into
+ * memory and move the offset to the end; returns non-0 if it was not
+ * mapped
+ */
+static int
+sv_file_data_map(sv_file_data* fdata, int fd)
+{
+  struct stat st;
+  off_t offset;
+  off_t start;
+  void* p;
+
+  if(fstat(fd, &st) || !S_ISREG(st.st_mode))
+    return 1;
+
+  offset = lseek(fd, 0, SEEK_CUR);
+  if(offset < 0 || offset >= st.st_size)
+    return 1;
+
+  /* the mapping must start on a page boundary */
+  start = offset - offset % (off_t)sysconf(_SC_PAGESIZE);
+  p = mmap(NULL, (size_t)(st.st_size - start), PROT_READ, MAP_PRIVATE, fd,
+           start);
+  if(p == MAP_FAILED)
+    return 1;
+
+  if(lseek(fd, 0, SEEK_END) < 0) {
+    munmap(p, (size_t)(st.st_size - start));
+    return 1;
+  }
+
+  fdata->data = (char*)p + (offset - start);
+  fdata->len = (size_t)(st.st_size - offset);
+  fdata->mapped = 1;
+
+  return 0;
+}
+#endif
+
+
+/**
+ * sv_internal_file_map:
+ * @fd: file descriptor
+ * @data_p: pointer to store the mapped data
+ * @len_p: pointer to store the mapped length
+ *
+ * INTERNAL - map the rest of regular file @fd from its current offset
+ * into memory for sequential reading.  The offset is moved to the end
+ * of the file.
+ *
+ * Return value: non-0 if the file was not mapped
+ */
+int
+sv_internal_file_map(int fd, char** data_p, size_t* len_p)
+{
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_STAT_H) && \
+  defined(HAVE_UNISTD_H)
+  sv_file_data fdata;
+
+  memset(&fdata, '\0', sizeof(fdata));
+  if(sv_file_data_map(&fdata, fd))
+    return 1;
+#ifdef MADV_SEQUENTIAL
+  madvise(fdata.data, fdata.len, MADV_SEQUENTIAL);
+#endif
+  *data_p = fdata.data;
+  *len_p = fdata.len;
+  return 0;
+#else
+  return 1;
+#endif
+}
+
+
+/**
+ * sv_internal_file_unmap:
+ * @data: data from sv_internal_file_map()
+ * @len: length from sv_internal_file_map()
+ *
+ * INTERNAL - unmap a file mapped with sv_internal_file_map()
+ */
+void
+sv_internal_file_unmap(char* data, size_t len)
+{
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_UNISTD_H)
+  sv_file_data_unmap(data, len);
+#endif
+}
+
+
+/* Map file @path into memory or if that fails, read it */
+static sv_status_t
+sv_file_data_open(sv_file_data* fdata, const char* path)
+{
+  FILE* fh;
+  size_t size = 0;
+
+  memset(fdata, '\0', sizeof(*fdata));
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_FCNTL_H) && \
+  defined(HAVE_SYS_STAT_H) && defined(HAVE_UNISTD_H)
+  if(1) {
+    int fd = open(path, O_RDONLY);
+    int failed;
+
+    if(fd < 0)
+      return SV_STATUS_FAILED;
+    failed = sv_file_data_map(fdata, fd);
+    close(fd);
+    if(!failed)
+      return SV_STATUS_OK;
+  }
+#endif
+
+  fh = fopen(path, "rb");
+  if(!fh)
+    return SV_STATUS_FAILED;
+
+  while(1) {
+    size_t n;
+
+    if(fdata->len == size) {
+      size_t new_size = size ? size * 2 : 64 * 1024;
+      char* new_data = (char*)realloc(fdata->data, new_size);
+
+      if(!new_data) {
+        fclose(fh);
+        sv_file_data_close(fdata);
+        return SV_STATUS_NO_MEMORY;
+      }
+      fdata->data = new_data;
+      size = new_size;
+    }
+
+    n = fread(fdata->data + fdata->len, 1, size - fdata->len, fh);
+    if(!n)
+      break;
+    fdata->len += n;
+  }
+
+  if(ferror(fh)) {
+    fclose(fh);
+    sv_file_data_close(fdata);
+    return SV_STATUS_FAILED;
+  }
+  fclose(fh);
+
+  return SV_STATUS_OK;
+}
+
+
+/* size of buffer used when reading input that cannot be mapped */
+#define SV_FILE_READ_BUFFER_SIZE (1024 * 1024)
+
+#ifdef HAVE_UNISTD_H
+/**
+ * sv_parse_fd:
+ * @t: sv object
+ * @fd: file descriptor open for reading
+ *
+ * Parse all the data that can be read from a file descriptor
+ *
+ * Parsing starts at the current offset of @fd.  The rest of a
+ * regular file is mapped into memory and parsed in one call to
+ * sv_parse_chunk(), telling the kernel it will be read sequentially,
+ * and the offset is left at the end of the file.  Other input such as
+ * pipes is read in large blocks.  The end of input
+ * is signalled after the data so the last row is returned.  @fd is
+ * not closed.  Reading stops as soon as parsing is stopped by a
+ * callback returning #SV_STATUS_STOP or #SV_OPTION_MAX_ROWS, which is
+ * not an error.
+ *
+ * Return value: #SV_STATUS_OK on success
+ */
+sv_status_t
+sv_parse_fd(sv *t, int fd)
+{
+  sv_status_t status = SV_STATUS_OK;
+  char* buffer;
+
+  if(!t || fd < 0)
+    return SV_STATUS_FAILED;
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_STAT_H)
+  /* parsing starts at the current offset and leaves it at the end */
+  if(1) {
+    sv_file_data fdata;
+
+    memset(&fdata, '\0', sizeof(fdata));
+    if(!sv_file_data_map(&fdata, fd)) {
+#ifdef MADV_SEQUENTIAL
+      madvise(fdata.data, fdata.len, MADV_SEQUENTIAL);
+#endif
+#ifdef POSIX_FADV_SEQUENTIAL
+      posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+      status = sv_parse_chunk(t, fdata.data, fdata.len);
+      if(!status)
+        status = sv_parse_chunk(t, NULL, 0);
+      sv_file_data_close(&fdata);
+      return (status == SV_STATUS_STOP) ? SV_STATUS_OK : status;
+    }
+  }
+#endif
+
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  buffer = (char*)malloc(SV_FILE_READ_BUFFER_SIZE);
+  if(!buffer)
+    return SV_STATUS_NO_MEMORY;
+
+  while(1) {
+    ssize_t n = read(fd, buffer, SV_FILE_READ_BUFFER_SIZE);
+
+    if(n < 0) {
+#ifdef EINTR
+      if(errno == EINTR)
+        continue;
+#endif
+      status = SV_STATUS_FAILED;
+      break;
+    }
+    if(!n)
+      break;
+
+    status = sv_parse_chunk(t, buffer, (size_t)n);
+    if(status)
+      break;
+  }
+  free(buffer);
+
+  if(!status)
+    status = sv_parse_chunk(t, NULL, 0);
+
+  /* stopped early: the rest is not read */
+  if(status == SV_STATUS_STOP)
+    status = SV_STATUS_OK;
+
+  return status;
+}
+#else
+sv_status_t
+sv_parse_fd(sv *t, int fd)
+{
+  /* file descriptors cannot be read without unistd.h */
+  return SV_STATUS_FAILED;
+}
+#endif
+
+
+/**
+ * sv_parse_file:
+ * @t: sv object
+ * @path: file to parse
+ *
+ * Parse a file
+ *
+ * Uses sv_parse_fd() when available, otherwise reads the file in
+ * large blocks.  The end of input is signalled after the data.
+ * Reading stops when parsing is stopped as for sv_parse_fd().
+ *
+ * Return value: #SV_STATUS_OK on success
+ */
+sv_status_t
+sv_parse_file(sv *t, const char *path)
+{
+  sv_status_t status = SV_STATUS_OK;
+
+  if(!t || !path)
+    return SV_STATUS_FAILED;
+
+#if defined(HAVE_UNISTD_H) && defined(HAVE_FCNTL_H)
+  if(1) {
+    int fd = open(path, O_RDONLY);
+
+    if(fd < 0)
+      return SV_STATUS_FAILED;
+    status = sv_parse_fd(t, fd);
+    close(fd);
+  }
+#else
+  if(1) {
+    FILE* fh = fopen(path, "rb");
+    char* buffer;
+
+    if(!fh)
+      return SV_STATUS_FAILED;
+
+    buffer = (char*)malloc(SV_FILE_READ_BUFFER_SIZE);
+    if(!buffer) {
+      fclose(fh);
+      return SV_STATUS_NO_MEMORY;
+    }
+
+    while(1) {
+      size_t n = fread(buffer, 1, SV_FILE_READ_BUFFER_SIZE, fh);
+
+      if(!n)
+        break;
+      status = sv_parse_chunk(t, buffer, n);
+      if(status)
+        break;
+    }
+    if(!status && ferror(fh))
+      status = SV_STATUS_FAILED;
+    free(buffer);
+    fclose(fh);
+
+    if(!status)
+      status = sv_parse_chunk(t, NULL, 0);
+    if(status == SV_STATUS_STOP)
+      status = SV_STATUS_OK;
+  }
+#endif
+
+  return status;
+}
+
+
+/*
+ * States of the record boundary scanner.  This follows the parser
+ * state machine closely enough to find where rows start, given the
+ * state at the start of a range.  Escapes are not handled.
+ */
+typedef enum {
+  /* at the start of a row */
+  SV_SPLIT_ROW,
+  /* at the start of a cell */
+  SV_SPLIT_CELL,
+  /* in an unquoted cell */
+  SV_SPLIT_IN_CELL,
+  /* in a quoted cell */
+  SV_SPLIT_QUOTED,
+  /* after a quote in a quoted cell */
+  SV_SPLIT_QUOTE_IN_QUOTED,
+  SV_SPLIT_LAST = SV_SPLIT_QUOTE_IN_QUOTED
+} sv_split_state;
+
+#define SV_SPLIT_COUNT (SV_SPLIT_LAST + 1)
+
+/* nominal size of a byte range scanned and parsed as one job */
+#define SV_PARALLEL_MIN_RANGE_SIZE (4 * 1024)
+#define SV_PARALLEL_MAX_RANGE_SIZE (16 * 1024 * 1024)
+
+/* Byte range and where rows start in it for each possible start state */
+typedef struct
+{
+  size_t start;
+  size_t end;
+  /* state at the end of the range */
+  unsigned char end_state[SV_SPLIT_COUNT];
+  /* offset of the first row start or SV_NO_OFFSET */
+  size_t first_row[SV_SPLIT_COUNT];
+} sv_split_range;
+
+/* Buffered callback event types for ordered delivery */
+typedef enum {
+  SV_EVENT_DATA,
+  SV_EVENT_LINE,
+  SV_EVENT_COMMENT
+} sv_parallel_event_type;
+
+typedef struct sv_parallel_s sv_parallel;
+
+typedef struct
+{
+  sv_parallel* par;
+  unsigned int index;
+  /* per worker parser */
+  sv* t;
+#ifdef HAVE_PTHREAD_H
+  pthread_t thread;
+#endif
+
+  /* ordered delivery: callback events for the current segment */
+  char* events;
+  size_t events_len;
+  size_t events_size;
+
+  /* fields and widths arrays for replaying events */
+  char** fields;
+  size_t* widths;
+  size_t fields_size;
+} sv_parallel_worker;
+
+typedef void (*sv_parallel_job)(sv_parallel_worker* w, unsigned int index);
+
+struct sv_parallel_s
+{
+  /* user's sv: options, callbacks and user data */
+  sv* t;
+  const char* data;
+  size_t len;
+  int ordered;
+
+  /* record boundary scanner transitions and run stops */
+  unsigned char split[SV_SPLIT_COUNT][SV_CLASS_COUNT];
+  char stops[SV_SCAN_MAX_STOPS];
+  unsigned int nstops;
+
+  sv_split_range* ranges;
+  unsigned int nranges;
+
+  /* segment i is bytes bounds[i] to bounds[i + 1] */
+  size_t* bounds;
+  unsigned int nsegments;
+
+  sv_parallel_worker* workers;
+  unsigned int nworkers;
+
+  /* current job function and count */
+  sv_parallel_job job;
+  unsigned int njobs;
+  /* next job index to run */
+  unsigned int next_job;
+  /* ordered delivery: next segment whose events can be delivered */
+  unsigned int next_deliver;
+
+  /* first error */
+  sv_status_t status;
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t lock;
+  pthread_cond_t delivered;
+#endif
+};
+
+
+#ifdef HAVE_PTHREAD_H
+#define SV_PARALLEL_LOCK(par) pthread_mutex_lock(&(par)->lock)
+#define SV_PARALLEL_UNLOCK(par) pthread_mutex_unlock(&(par)->lock)
+#else
+#define SV_PARALLEL_LOCK(par) do { } while(0)
+#define SV_PARALLEL_UNLOCK(par) do { } while(0)
+#endif
+
+
+/* Record the first error */
+static void
+sv_parallel_set_status(sv_parallel* par, sv_status_t status)
+{
+  if(!status)
+    return;
+
+  SV_PARALLEL_LOCK(par);
+  if(!par->status)
+    par->status = status;
+  SV_PARALLEL_UNLOCK(par);
+}
+
+
+/* Next state of the record boundary scanner for a char of class @cls */
+static sv_split_state
+sv_split_transition(sv* t, sv_split_state state, unsigned int cls)
+{
+  switch(state) {
+    case SV_SPLIT_ROW:
+      if(cls & SV_CLASS_EOL)
+        return SV_SPLIT_ROW;
+      /* FALLTHROUGH */
+
+    case SV_SPLIT_CELL:
+      if(cls & SV_CLASS_EOL)
+        return SV_SPLIT_ROW;
+      if(cls & SV_CLASS_QUOTE)
+        return SV_SPLIT_QUOTED;
+      if(cls & (SV_CLASS_SPACE | SV_CLASS_SEP))
+        return SV_SPLIT_CELL;
+      return SV_SPLIT_IN_CELL;
+
+    case SV_SPLIT_IN_CELL:
+      if(cls & SV_CLASS_EOL)
+        return SV_SPLIT_ROW;
+      if(cls & SV_CLASS_SEP)
+        return SV_SPLIT_CELL;
+      return SV_SPLIT_IN_CELL;
+
+    case SV_SPLIT_QUOTED:
+      if(cls & SV_CLASS_QUOTE)
+        return (t->flags & SV_FLAGS_DOUBLE_QUOTE) ?
+          SV_SPLIT_QUOTE_IN_QUOTED : SV_SPLIT_IN_CELL;
+      return SV_SPLIT_QUOTED;
+
+    case SV_SPLIT_QUOTE_IN_QUOTED:
+      if(cls & SV_CLASS_QUOTE)
+        return SV_SPLIT_QUOTED;
+      if(cls & SV_CLASS_SEP)
+        return SV_SPLIT_CELL;
+      if(cls & SV_CLASS_EOL)
+        return SV_SPLIT_ROW;
+      return SV_SPLIT_IN_CELL;
+
+    default:
+      break;
+  }
+
+  return state;
+}
+
+
+/*
+ * Scan a byte range once, following the boundary scanner from every
+ * start state at the same time, recording where each first reaches a
+ * row start and the state each ends in.
+ */
+static void
+sv_parallel_scan_range(sv_parallel_worker* w, unsigned int index)
+{
+  sv_parallel* par = w->par;
+  sv* t = par->t;
+  sv_split_range* r = &par->ranges[index];
+  unsigned char cur[SV_SPLIT_COUNT];
+  size_t i = r->start;
+  unsigned int s;
+
+  for(s = 0; s < SV_SPLIT_COUNT; s++) {
+    cur[s] = (unsigned char)s;
+    r->first_row[s] = SV_NO_OFFSET;
+  }
+  r->first_row[SV_SPLIT_ROW] = r->start;
+
+  while(i < r->end) {
+    unsigned int cls;
+
+    /* A run of plain bytes moves each state once */
+    if(!(t->flags & SV_FLAGS_STRIP_WHITESPACE)) {
+      size_t run = sv_internal_scan_run(par->data + i, r->end - i,
+                                        par->stops, par->nstops);
+      if(run) {
+        for(s = 0; s < SV_SPLIT_COUNT; s++)
+          cur[s] = par->split[cur[s]][0];
+        i += run;
+        continue;
+      }
+    }
+
+    cls = t->char_class[(unsigned char)par->data[i++]];
+    /* NULs in input are ignored */
+    if(cls & SV_CLASS_NUL)
+      continue;
+
+    for(s = 0; s < SV_SPLIT_COUNT; s++) {
+      cur[s] = par->split[cur[s]][cls];
+      if(cur[s] == SV_SPLIT_ROW && r->first_row[s] == SV_NO_OFFSET)
+        r->first_row[s] = i;
+    }
+  }
+
+  for(s = 0; s < SV_SPLIT_COUNT; s++)
+    r->end_state[s] = cur[s];
+}
+
+
+/* Append bytes to the worker's event buffer */
+static sv_status_t
+sv_parallel_event_add(sv_parallel_worker* w, const void* p, size_t len)
+{
+  if(w->events_len + len > w->events_size) {
+    size_t new_size = w->events_size ? w->events_size * 2 : 64 * 1024;
+    char* new_events;
+
+    while(new_size < w->events_len + len)
+      new_size *= 2;
+    new_events = (char*)realloc(w->events, new_size);
+    if(!new_events)
+      return SV_STATUS_NO_MEMORY;
+    w->events = new_events;
+    w->events_size = new_size;
+  }
+
+  if(len)
+    memcpy(w->events + w->events_len, p, len);
+  w->events_len += len;
+
+  return SV_STATUS_OK;
+}
+
+
+/* Append an event header */
+static sv_status_t
+sv_parallel_event_start(sv_parallel_worker* w, sv_parallel_event_type type,
+                        size_t count)
+{
+  int itype = (int)type;
+  sv_status_t status;
+
+  status = sv_parallel_event_add(w, &itype, sizeof(itype));
+  if(!status)
+    status = sv_parallel_event_add(w, &w->t->line, sizeof(w->t->line));
+  if(!status)
+    status = sv_parallel_event_add(w, &count, sizeof(count));
+
+  return status;
+}
+
+
+/* Data callback for worker parsers */
+static sv_status_t
+sv_parallel_data_callback(sv *t, void *user_data,
+                          char** fields, size_t *widths, size_t count)
+{
+  sv_parallel_worker* w = (sv_parallel_worker*)user_data;
+  sv* ut = w->par->t;
+  sv_status_t status;
+  size_t i;
+
+  if(!ut->data_callback)
+    return SV_STATUS_OK;
+
+  if(!w->par->ordered)
+    return ut->data_callback(t, ut->callback_user_data, fields, widths, count);
+
+  /* widths, then NULL flags, then NUL terminated field bytes */
+  status = sv_parallel_event_start(w, SV_EVENT_DATA, count);
+  if(!status && count)
+    status = sv_parallel_event_add(w, widths, sizeof(size_t) * count);
+  for(i = 0; !status && i < count; i++) {
+    char is_null = (fields[i] == NULL);
+    status = sv_parallel_event_add(w, &is_null, 1);
+  }
+  for(i = 0; !status && i < count; i++) {
+    if(fields[i]) {
+      status = sv_parallel_event_add(w, fields[i], widths[i]);
+      if(!status)
+        status = sv_parallel_event_add(w, "", 1);
+    }
+  }
+
+  return status;
+}
+
+
+/* Line and comment callbacks for worker parsers */
+static sv_status_t
+sv_parallel_line_event(sv_parallel_worker* w, sv_parallel_event_type type,
+                       sv_line_callback cb, const char* line, size_t length)
+{
+  sv_status_t status;
+
+  if(!cb)
+    return SV_STATUS_OK;
+
+  if(!w->par->ordered)
+    return cb(w->t, w->par->t->callback_user_data, line, length);
+
+  /* NUL terminated line bytes */
+  status = sv_parallel_event_start(w, type, length);
+  if(!status)
+    status = sv_parallel_event_add(w, line, length);
+  if(!status)
+    status = sv_parallel_event_add(w, "", 1);
+
+  return status;
+}
+
+
+static sv_status_t
+sv_parallel_line_callback(sv *t, void *user_data,
+                          const char* line, size_t length)
+{
+  sv_parallel_worker* w = (sv_parallel_worker*)user_data;
+
+  return sv_parallel_line_event(w, SV_EVENT_LINE, w->par->t->line_callback,
+                                line, length);
+}
+
+
+static sv_status_t
+sv_parallel_comment_callback(sv *t, void *user_data,
+                             const char* comment, size_t length)
+{
+  sv_parallel_worker* w = (sv_parallel_worker*)user_data;
+
+  return sv_parallel_line_event(w, SV_EVENT_COMMENT,
+                                w->par->t->comment_callback,
+                                comment, length);
+}
+
+
+/* Deliver the worker's buffered events to the user's callbacks */
+static sv_status_t
+sv_parallel_replay(sv_parallel_worker* w)
+{
+  sv* ut = w->par->t;
+  int saved_line = w->t->line;
+  size_t offset = 0;
+  sv_status_t status = SV_STATUS_OK;
+
+  while(!status && offset < w->events_len) {
+    int type;
+    size_t count;
+
+    memcpy(&type, w->events + offset, sizeof(type));
+    offset += sizeof(type);
+    memcpy(&w->t->line, w->events + offset, sizeof(w->t->line));
+    offset += sizeof(w->t->line);
+    memcpy(&count, w->events + offset, sizeof(count));
+    offset += sizeof(count);
+
+    if(type == SV_EVENT_DATA) {
+      const char* nulls;
+      size_t i;
+
+      if(count > w->fields_size) {
+        char** new_fields = (char**)realloc(w->fields,
+                                            sizeof(char*) * count);
+        size_t* new_widths;
+
+        if(!new_fields) {
+          status = SV_STATUS_NO_MEMORY;
+          break;
+        }
+        w->fields = new_fields;
+        new_widths = (size_t*)realloc(w->widths, sizeof(size_t) * count);
+        if(!new_widths) {
+          status = SV_STATUS_NO_MEMORY;
+          break;
+        }
+        w->widths = new_widths;
+        w->fields_size = count;
+      }
+
+      if(count)
+        memcpy(w->widths, w->events + offset, sizeof(size_t) * count);
+      offset += sizeof(size_t) * count;
+      nulls = w->events + offset;
+      offset += count;
+      for(i = 0; i < count; i++) {
+        if(nulls[i])
+          w->fields[i] = NULL;
+        else {
+          w->fields[i] = w->events + offset;
+          offset += w->widths[i] + 1;
+        }
+      }
+
+      status = ut->data_callback(w->t, ut->callback_user_data,
+                                 w->fields, w->widths, count);
+    } else {
+      sv_line_callback cb = (type == SV_EVENT_LINE) ? ut->line_callback :
+        ut->comment_callback;
+
+      status = cb(w->t, ut->callback_user_data, w->events + offset, count);
+      offset += count + 1;
+    }
+
+    /* rows are always all delivered */
+    if(status == SV_STATUS_PAUSE)
+      status = SV_STATUS_OK;
+  }
+
+  w->t->line = saved_line;
+  w->events_len = 0;
+
+  return status;
+}
+
+
+/* Parse one segment and in ordered mode deliver it in turn */
+static void
+sv_parallel_parse_segment(sv_parallel_worker* w, unsigned int index)
+{
+  sv_parallel* par = w->par;
+  size_t start = par->bounds[index];
+  size_t end = par->bounds[index + 1];
+  sv_status_t status = SV_STATUS_OK;
+
+  if(end > start)
+    status = sv_parse_chunk(w->t, (char*)par->data + start, end - start);
+  if(!status && index == par->nsegments - 1)
+    status = sv_parse_chunk(w->t, NULL, 0);
+
+  if(par->ordered) {
+    sv_status_t replay_status = SV_STATUS_OK;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&par->lock);
+    while(par->next_deliver != index)
+      pthread_cond_wait(&par->delivered, &par->lock);
+    pthread_mutex_unlock(&par->lock);
+#endif
+
+    if(!status && !par->status)
+      replay_status = sv_parallel_replay(w);
+    w->events_len = 0;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&par->lock);
+    par->next_deliver++;
+    pthread_cond_broadcast(&par->delivered);
+    pthread_mutex_unlock(&par->lock);
+#endif
+
+    if(!status)
+      status = replay_status;
+  }
+
+  sv_parallel_set_status(par, status);
+}
+
+
+/* Run jobs until there are none left or there was an error */
+static void*
+sv_parallel_worker_run(void* arg)
+{
+  sv_parallel_worker* w = (sv_parallel_worker*)arg;
+  sv_parallel* par = w->par;
+
+  while(1) {
+    unsigned int index;
+
+    SV_PARALLEL_LOCK(par);
+    index = par->next_job;
+    if(index < par->njobs && !par->status)
+      par->next_job++;
+    else
+      index = par->njobs;
+    SV_PARALLEL_UNLOCK(par);
+
+    if(index >= par->njobs)
+      break;
+    par->job(w, index);
+  }
+
+  return NULL;
+}
+
+
+/* Run @njobs calls of @job across the workers */
+static sv_status_t
+sv_parallel_run(sv_parallel* par, sv_parallel_job job, unsigned int njobs)
+{
+  unsigned int i;
+
+  par->job = job;
+  par->njobs = njobs;
+  par->next_job = 0;
+
+#ifdef HAVE_PTHREAD_H
+  for(i = 1; i < par->nworkers; i++) {
+    if(pthread_create(&par->workers[i].thread, NULL,
+                      sv_parallel_worker_run, &par->workers[i])) {
+      unsigned int j;
+
+      sv_parallel_set_status(par, SV_STATUS_FAILED);
+      for(j = 1; j < i; j++)
+        pthread_join(par->workers[j].thread, NULL);
+      return par->status;
+    }
+  }
+#endif
+
+  sv_parallel_worker_run(&par->workers[0]);
+
+#ifdef HAVE_PTHREAD_H
+  for(i = 1; i < par->nworkers; i++)
+    pthread_join(par->workers[i].thread, NULL);
+#else
+  (void)i;
+#endif
+
+  return par->status;
+}
+
+
+/* Create worker parsers with the user's dialect, headers and callbacks */
+static sv_status_t
+sv_parallel_init_workers(sv_parallel* par, unsigned int nworkers)
+{
+  sv* t = par->t;
+  unsigned int i;
+
+  par->workers = (sv_parallel_worker*)calloc(nworkers, sizeof(*par->workers));
+  if(!par->workers)
+    return SV_STATUS_NO_MEMORY;
+  par->nworkers = nworkers;
+
+  for(i = 0; i < nworkers; i++) {
+    sv_parallel_worker* w = &par->workers[i];
+    sv_status_t status;
+
+    w->par = par;
+    w->index = i;
+    w->t = sv_new(w, NULL, sv_parallel_data_callback, t->field_sep);
+    if(!w->t)
+      return SV_STATUS_NO_MEMORY;
+
+    status = sv_internal_copy_options(w->t, t);
+    if(!status)
+      status = sv_internal_copy_headers(w->t, t);
+    if(status)
+      return status;
+
+    w->t->flags &= ~SV_FLAGS_SAVE_HEADER;
+    w->t->skip_rows = 0;
+    w->t->thread_index = (int)i;
+    if(t->line_callback)
+      w->t->line_callback = sv_parallel_line_callback;
+    if(t->comment_callback)
+      w->t->comment_callback = sv_parallel_comment_callback;
+  }
+
+  return SV_STATUS_OK;
+}
+
+
+static void
+sv_parallel_free(sv_parallel* par)
+{
+  unsigned int i;
+
+  if(par->workers) {
+    for(i = 0; i < par->nworkers; i++) {
+      sv_parallel_worker* w = &par->workers[i];
+
+      if(w->t) {
+        par->t->bad_records += w->t->bad_records;
+        sv_free(w->t);
+      }
+      if(w->events)
+        free(w->events);
+      if(w->fields)
+        free(w->fields);
+      if(w->widths)
+        free(w->widths);
+    }
+    free(par->workers);
+  }
+
+  if(par->ranges)
+    free(par->ranges);
+  if(par->bounds)
+    free(par->bounds);
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_destroy(&par->lock);
+  pthread_cond_destroy(&par->delivered);
+#endif
+}
+
+
+/*
+ * Split data from @offset into segments that each start at a row.
+ *
+ * Pass 1 scans fixed size byte ranges in parallel from every start
+ * state; then the state at the start of each range is known by
+ * chaining the end states from the first range, which starts at a row.
+ */
+static sv_status_t
+sv_parallel_split(sv_parallel* par, size_t offset, size_t range_size)
+{
+  sv* t = par->t;
+  unsigned int i;
+  unsigned int s;
+  unsigned int cls;
+  sv_split_state state;
+  sv_status_t status;
+
+  for(s = 0; s < SV_SPLIT_COUNT; s++) {
+    for(cls = 0; cls < SV_CLASS_COUNT; cls++)
+      par->split[s][cls] = (unsigned char)sv_split_transition(t, (sv_split_state)s, cls);
+  }
+
+  par->nstops = 0;
+  par->stops[par->nstops++] = t->field_sep;
+  par->stops[par->nstops++] = '\n';
+  par->stops[par->nstops++] = '\r';
+  par->stops[par->nstops++] = '\0';
+  if(t->quote_char)
+    par->stops[par->nstops++] = t->quote_char;
+
+  par->nranges = (unsigned int)((par->len - offset + range_size - 1) / range_size);
+  par->ranges = (sv_split_range*)calloc(par->nranges, sizeof(*par->ranges));
+  par->bounds = (size_t*)malloc(sizeof(size_t) * (par->nranges + 1));
+  if(!par->ranges || !par->bounds)
+    return SV_STATUS_NO_MEMORY;
+
+  for(i = 0; i < par->nranges; i++) {
+    par->ranges[i].start = offset + (size_t)i * range_size;
+    par->ranges[i].end = par->ranges[i].start + range_size;
+    if(par->ranges[i].end > par->len)
+      par->ranges[i].end = par->len;
+  }
+
+  status = sv_parallel_run(par, sv_parallel_scan_range, par->nranges);
+  if(status)
+    return status;
+
+  /* A range with no row start in it joins the previous segment */
+  par->bounds[0] = offset;
+  par->nsegments = 1;
+  state = SV_SPLIT_ROW;
+  for(i = 0; i < par->nranges; i++) {
+    sv_split_range* r = &par->ranges[i];
+
+    if(i > 0) {
+      size_t row = r->first_row[state];
+
+      if(row != SV_NO_OFFSET && row < par->len)
+        par->bounds[par->nsegments++] = row;
+    }
+    state = (sv_split_state)r->end_state[state];
+  }
+  par->bounds[par->nsegments] = par->len;
+
+  return SV_STATUS_OK;
+}
+
+
+/* Default number of threads: the number of online CPUs */
+static unsigned int
+sv_parallel_default_threads(void)
+{
+#if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if(n > 0)
+    return (unsigned int)n;
+#endif
+  return 1;
+}
+
+
+/**
+ * sv_parse_file_parallel:
+ * @t: sv object
+ * @path: file to parse
+ * @nthreads: number of threads to use or <= 0 for one per CPU
+ * @ordered: non-0 to deliver rows in file order
+ *
+ * Parse a file using several threads.
+ *
+ * The header and rows to skip are parsed first with @t.  The rest of
+ * the file is split into byte ranges at row starts, found from the
+ * quote state at each range boundary, and the ranges are parsed
+ * concurrently by per-thread sv objects made with the options,
+ * headers and callbacks of @t.  Callbacks are passed the per-thread
+ * sv object; use sv_get_thread_index() to find the thread.
+ *
+ * If @ordered is non-0, each thread buffers the callbacks for its
+ * range and they are delivered one range at a time in file order.
+ * Otherwise callbacks are called directly from each thread as rows
+ * are parsed, in no particular order, so must be thread safe.
+ *
+ * Row splitting assumes quote chars only start and end quoted cells.
+ * If an escape char, #SV_OPTION_BATCH_CALLBACK,
+ * #SV_OPTION_STRUCT_CALLBACK or #SV_OPTION_MAX_ROWS is set or threads
+ * are not available, the file is parsed in one thread.  Line numbers
+ * from sv_get_line() in callbacks count from the start of each
+ * thread's ranges.
+ *
+ * Return value: #SV_STATUS_OK on success or the first error
+ */
+sv_status_t
+sv_parse_file_parallel(sv *t, const char *path, int nthreads, int ordered)
+{
+  sv_file_data fdata;
+  sv_parallel par;
+  size_t offset = 0;
+  size_t range_size;
+  unsigned int nworkers;
+  sv_status_t status;
+
+  if(!t || !path)
+    return SV_STATUS_FAILED;
+
+  status = sv_file_data_open(&fdata, path);
+  if(status)
+    return status;
+
+  t->thread_index = 0;
+
+  /* Skipped rows and the header are parsed in order by t in one call
+   * that pauses at the end of them
+   */
+  if(fdata.len && ((t->flags & SV_FLAGS_SAVE_HEADER) || t->skip_rows > 0)) {
+    t->pause_after_prefix = 1;
+    status = sv_internal_parse_chunk(t, fdata.data, fdata.len, &offset);
+    t->pause_after_prefix = 0;
+    if(status)
+      goto tidy;
+  }
+
+  nworkers = (nthreads > 0) ? (unsigned int)nthreads :
+    sv_parallel_default_threads();
+#ifndef HAVE_PTHREAD_H
+  nworkers = 1;
+#endif
+
+  range_size = (fdata.len - offset) / (nworkers * 4);
+  if(range_size < SV_PARALLEL_MIN_RANGE_SIZE)
+    range_size = SV_PARALLEL_MIN_RANGE_SIZE;
+  else if(range_size > SV_PARALLEL_MAX_RANGE_SIZE)
+    range_size = SV_PARALLEL_MAX_RANGE_SIZE;
+
+  if(nworkers < 2 || t->escape_char || t->batch_callback ||
+     t->struct_callback || t->max_rows ||
+     fdata.len - offset <= range_size) {
+    /* Parse the rest in this thread */
+    if(offset < fdata.len)
+      status = sv_parse_chunk(t, fdata.data + offset, fdata.len - offset);
+    if(!status)
+      status = sv_parse_chunk(t, NULL, 0);
+    goto tidy;
+  }
+
+  memset(&par, '\0', sizeof(par));
+  par.t = t;
+  par.data = fdata.data;
+  par.len = fdata.len;
+  par.ordered = ordered;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_init(&par.lock, NULL);
+  pthread_cond_init(&par.delivered, NULL);
+#endif
+
+  status = sv_parallel_init_workers(&par, nworkers);
+  if(!status)
+    status = sv_parallel_split(&par, offset, range_size);
+  if(!status)
+    status = sv_parallel_run(&par, sv_parallel_parse_segment, par.nsegments);
+
+  sv_parallel_free(&par);
+
+ tidy:
+  t->thread_index = -1;
+  sv_file_data_close(&fdata);
+
+  /* a callback stopped the parse: not an error */
+  if(status == SV_STATUS_STOP)
+    status = SV_STATUS_OK;
+
+  return status;
+}
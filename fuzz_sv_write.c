@@ -49,6 +49,12 @@ int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   FILE* fh = fopen("/dev/null", "w");
   if (fh) {
     (void)sv_write_fields(t, fh, fields, widths, i);
+    /* small buffer so fields span buffer flushes */
+    sv_writer* w = sv_writer_new(t, fh, 7);
+    if (w) {
+      (void)sv_writer_write_fields(w, fields, widths, i);
+      (void)sv_writer_close(w);
+    }
     fclose(fh);
   }
 
@@ -61,6 +61,7 @@ sv_set_option_vararg(sv* t, sv_option_t option, va_list arg)
       t->flags &= ~SV_FLAGS_STRIP_WHITESPACE;
       if(va_arg(arg, long))
         t->flags |= SV_FLAGS_STRIP_WHITESPACE;
+      sv_internal_update_char_classes(t);
       break;
 
     case SV_OPTION_QUOTE_CHAR:
@@ -82,12 +83,14 @@ sv_set_option_vararg(sv* t, sv_option_t option, va_list arg)
       t->flags &= ~SV_FLAGS_DOUBLE_QUOTE;
       if(va_arg(arg, long))
         t->flags |= SV_FLAGS_DOUBLE_QUOTE;
+      sv_internal_update_char_classes(t);
       break;
 
     case SV_OPTION_ESCAPE_CHAR:
       if(1) {
         int c = va_arg(arg, int);
         t->escape_char = c;
+        sv_internal_update_char_classes(t);
       }
       break;
 
@@ -201,6 +204,140 @@ sv_set_option_vararg(sv* t, sv_option_t option, va_list arg)
       }
       break;
 
+    case SV_OPTION_ZERO_COPY:
+      t->flags &= ~SV_FLAGS_ZERO_COPY;
+      if(va_arg(arg, long))
+        t->flags |= SV_FLAGS_ZERO_COPY;
+      break;
+
+    case SV_OPTION_SELECT_COLUMNS:
+      if(1) {
+        int* columns = va_arg(arg, int*);
+        int count = va_arg(arg, int);
+
+        sv_internal_free_select(t);
+        if(columns && count > 0)
+          status = sv_internal_select_columns(t, columns,
+                                              (unsigned int)count);
+      }
+      break;
+
+    case SV_OPTION_SELECT_COLUMN_NAMES:
+      if(1) {
+        char** names = va_arg(arg, char**);
+        int count = va_arg(arg, int);
+        unsigned int i;
+
+        sv_internal_free_select(t);
+        if(!names || count <= 0)
+          break;
+
+        /* no columns until the names are found in the header */
+        status = sv_internal_select_columns(t, NULL, (unsigned int)count);
+        if(status)
+          break;
+
+        t->select_names = (char**)calloc((size_t)count, sizeof(char*));
+        if(!t->select_names) {
+          sv_internal_free_select(t);
+          status = SV_STATUS_NO_MEMORY;
+          break;
+        }
+        for(i = 0; i < (unsigned int)count; i++) {
+          size_t len = names[i] ? strlen(names[i]) : 0;
+
+          t->select_names[i] = (char*)malloc(len + 1);
+          if(!t->select_names[i]) {
+            sv_internal_free_select(t);
+            status = SV_STATUS_NO_MEMORY;
+            break;
+          }
+          if(len)
+            memcpy(t->select_names[i], names[i], len);
+          t->select_names[i][len] = '\0';
+        }
+      }
+      break;
+
+    case SV_OPTION_BATCH_CALLBACK:
+      if(1) {
+        sv_batch_callback cb = (sv_batch_callback)va_arg(arg, void*);
+        t->batch_callback = cb;
+      }
+      break;
+
+    case SV_OPTION_BATCH_SIZE:
+      if(1) {
+        long n = va_arg(arg, long);
+        if(n > 0)
+          t->batch_size = (size_t)n;
+        else
+          status = SV_STATUS_FAILED;
+      }
+      break;
+
+    case SV_OPTION_STRUCT_SCHEMA:
+      if(1) {
+        const sv_struct_field* fields = va_arg(arg, const sv_struct_field*);
+        int count = va_arg(arg, int);
+        size_t record_size = va_arg(arg, size_t);
+
+        status = sv_internal_struct_set_schema(t, fields,
+                                               count > 0 ? (unsigned int)count : 0,
+                                               record_size);
+      }
+      break;
+
+    case SV_OPTION_STRUCT_CALLBACK:
+      if(1) {
+        sv_struct_callback cb = (sv_struct_callback)va_arg(arg, void*);
+        void* records = va_arg(arg, void*);
+        size_t capacity = va_arg(arg, size_t);
+
+        if(cb && (!records || !capacity)) {
+          status = SV_STATUS_FAILED;
+          break;
+        }
+        t->struct_callback = cb;
+        t->struct_records = cb ? records : NULL;
+        t->struct_capacity = cb ? capacity : 0;
+        sv_internal_struct_reset(t);
+
+        /* fields are only converted so need not be copied */
+        t->flags &= ~SV_FLAGS_STRUCT_SPANS;
+        if(cb)
+          t->flags |= SV_FLAGS_STRUCT_SPANS;
+      }
+      break;
+
+    case SV_OPTION_SOURCE_FD:
+    case SV_OPTION_SOURCE_BUFFER:
+    case SV_OPTION_SOURCE_CALLBACK:
+      /* only one source; input read from the last one is discarded */
+      sv_internal_pull_reset(t);
+      t->source_fd = -1;
+      t->source_data = NULL;
+      t->source_data_len = 0;
+      t->source_callback = NULL;
+      if(option == SV_OPTION_SOURCE_FD)
+        t->source_fd = va_arg(arg, int);
+      else if(option == SV_OPTION_SOURCE_BUFFER) {
+        t->source_data = va_arg(arg, char*);
+        t->source_data_len = va_arg(arg, size_t);
+      } else
+        t->source_callback = (sv_read_callback)va_arg(arg, void*);
+      break;
+
+    case SV_OPTION_MAX_ROWS:
+      if(1) {
+        long n = va_arg(arg, long);
+        if(n >= 0)
+          t->max_rows = (size_t)n;
+        else
+          status = SV_STATUS_FAILED;
+      }
+      break;
+
     default:
     case SV_OPTION_NONE:
       status = SV_STATUS_FAILED;
@@ -233,3 +370,163 @@ sv_set_option(sv *t, sv_option_t option, ...)
 
   return status;
 }
+
+
+/**
+ * sv_internal_copy_options:
+ * @dest: sv object to set
+ * @src: sv object to copy from
+ *
+ * INTERNAL - copy the parsing options of @src to @dest but not the
+ * callbacks or user data
+ *
+ * Return value: non-0 on failure
+ */
+sv_status_t
+sv_internal_copy_options(sv *dest, sv *src)
+{
+  sv_status_t status = SV_STATUS_OK;
+
+  dest->flags = src->flags & ~SV_FLAGS_STRUCT_SPANS;
+  dest->quote_char = src->quote_char;
+  dest->escape_char = src->escape_char;
+  dest->skip_rows = src->skip_rows;
+  dest->field_size_limit = src->field_size_limit;
+  dest->batch_size = src->batch_size;
+  sv_internal_update_char_classes(dest);
+
+  if(src->comment_prefix)
+    status = sv_set_option(dest, SV_OPTION_COMMENT_PREFIX,
+                           src->comment_prefix);
+
+  if(!status && src->null_values)
+    status = sv_set_option(dest, SV_OPTION_NULL_VALUES, src->null_values,
+                           (int)src->null_values_count);
+
+  /* copies the selected columns as resolved so far */
+  sv_internal_free_select(dest);
+  if(!status && src->select_columns)
+    status = sv_internal_select_columns(dest, src->select_columns,
+                                        src->select_count);
+
+  return status;
+}
+
+
+/**
+ * sv_internal_free_select:
+ * @t: sv object
+ *
+ * INTERNAL - free column selection; all columns are returned
+ */
+void
+sv_internal_free_select(sv *t)
+{
+  if(t->select_names) {
+    unsigned int i;
+
+    for(i = 0; i < t->select_count; i++) {
+      if(t->select_names[i])
+        free(t->select_names[i]);
+    }
+    free(t->select_names);
+    t->select_names = NULL;
+  }
+
+  if(t->select_columns) {
+    free(t->select_columns);
+    t->select_columns = NULL;
+  }
+  if(t->select_map) {
+    free(t->select_map);
+    t->select_map = NULL;
+  }
+  if(t->select_stored) {
+    free(t->select_stored);
+    t->select_stored = NULL;
+  }
+  if(t->select_fields) {
+    free(t->select_fields);
+    t->select_fields = NULL;
+  }
+  if(t->select_widths) {
+    free(t->select_widths);
+    t->select_widths = NULL;
+  }
+
+  t->select_count = 0;
+  t->select_map_size = 0;
+  t->skip_columns = 0;
+  t->skip_cell = 0;
+}
+
+
+/**
+ * sv_internal_select_columns:
+ * @t: sv object
+ * @columns: source column for each output field or <0 for a missing
+ * field; or NULL to set all missing
+ * @count: number of output fields
+ *
+ * INTERNAL - set the selected columns and build the map of selected
+ * source columns.  Any existing selected columns must have been freed
+ * but names may be set.
+ *
+ * Return value: non-0 on failure
+ */
+sv_status_t
+sv_internal_select_columns(sv *t, const int* columns, unsigned int count)
+{
+  unsigned int map_size = 0;
+  unsigned int i;
+
+  if(!t->select_columns) {
+    t->select_columns = (int*)malloc(sizeof(int) * count);
+    t->select_fields = (char**)malloc(sizeof(char*) * count);
+    t->select_widths = (size_t*)malloc(sizeof(size_t) * count);
+    if(!t->select_columns || !t->select_fields || !t->select_widths) {
+      sv_internal_free_select(t);
+      return SV_STATUS_NO_MEMORY;
+    }
+    t->select_count = count;
+  }
+
+  for(i = 0; i < count; i++) {
+    int c = columns ? columns[i] : -1;
+
+    t->select_columns[i] = c;
+    if(c >= 0 && (unsigned int)c + 1 > map_size)
+      map_size = (unsigned int)c + 1;
+  }
+
+  if(t->select_map) {
+    free(t->select_map);
+    t->select_map = NULL;
+  }
+  if(t->select_stored) {
+    free(t->select_stored);
+    t->select_stored = NULL;
+  }
+  t->select_map_size = 0;
+
+  if(!columns)
+    return SV_STATUS_OK;
+
+  /* a map of at least 1 so that a resolved selection is non-NULL */
+  if(!map_size)
+    map_size = 1;
+  t->select_map = (unsigned char*)calloc(map_size, 1);
+  t->select_stored = (unsigned int*)calloc(map_size, sizeof(unsigned int));
+  if(!t->select_map || !t->select_stored) {
+    sv_internal_free_select(t);
+    return SV_STATUS_NO_MEMORY;
+  }
+  t->select_map_size = map_size;
+
+  for(i = 0; i < count; i++) {
+    if(t->select_columns[i] >= 0)
+      t->select_map[t->select_columns[i]] = 1;
+  }
+
+  return SV_STATUS_OK;
+}
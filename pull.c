@@ -0,0 +1,249 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * pull.c - Pull data rows one at a time from an input source
+ *
+ * Copyright (C) 2025, Dave Beckett https://www.dajobe.org/
+ *
+ * This package is Free Software
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef SV_CONFIG
+#include <sv_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+#include <sv.h>
+#include "sv_internal.h"
+
+
+/**
+ * sv_internal_pull_reset:
+ * @t: sv object
+ *
+ * INTERNAL - discard any input read from the source.  The next
+ * sv_next_row() reads from the start of a buffer source or the
+ * current position of a file descriptor.
+ */
+void
+sv_internal_pull_reset(sv* t)
+{
+  if(t->pull_mapped)
+    sv_internal_file_unmap(t->pull_data, t->pull_len);
+  t->pull_mapped = 0;
+  t->pull_data = NULL;
+  t->pull_len = 0;
+  t->pull_offset = 0;
+  t->pull_eof = 0;
+  t->pull_ended = 0;
+  t->pulling = 0;
+  t->pull_fields = NULL;
+  t->pull_widths = NULL;
+  t->pull_count = 0;
+}
+
+
+/**
+ * sv_internal_pull_free:
+ * @t: sv object
+ *
+ * INTERNAL - free pull mode input
+ */
+void
+sv_internal_pull_free(sv* t)
+{
+  sv_internal_pull_reset(t);
+
+  if(t->pull_buffer) {
+    free(t->pull_buffer);
+    t->pull_buffer = NULL;
+  }
+}
+
+
+/* Get more input from the source into pull_data; sets pull_eof when
+ * there is no more
+ */
+static sv_status_t
+sv_pull_fill(sv* t)
+{
+  sv_status_t status = SV_STATUS_OK;
+  size_t n = 0;
+
+  if(t->source_data) {
+    t->pull_data = t->source_data;
+    t->pull_len = t->source_data_len;
+    t->pull_offset = 0;
+    t->pull_eof = 1;
+    return SV_STATUS_OK;
+  }
+
+  /* first fill from a regular file: map all of it */
+  if(t->source_fd >= 0 && !t->pull_data &&
+     !sv_internal_file_map(t->source_fd, &t->pull_data, &t->pull_len)) {
+    t->pull_mapped = 1;
+    t->pull_offset = 0;
+    t->pull_eof = 1;
+    return SV_STATUS_OK;
+  }
+
+  if(!t->pull_buffer) {
+    t->pull_buffer = (char*)malloc(SV_PULL_BUFFER_SIZE);
+    if(!t->pull_buffer)
+      return SV_STATUS_NO_MEMORY;
+  }
+
+  /* the last row returned may point into the buffer; it is no longer
+   * valid so the whole buffer is reused
+   */
+  if(t->source_callback) {
+    status = t->source_callback(t, t->callback_user_data, t->pull_buffer,
+                                SV_PULL_BUFFER_SIZE, &n);
+    if(status)
+      return status;
+    if(n > SV_PULL_BUFFER_SIZE)
+      return SV_STATUS_FAILED;
+  }
+#ifdef HAVE_UNISTD_H
+  else if(t->source_fd >= 0) {
+    while(1) {
+      ssize_t r = read(t->source_fd, t->pull_buffer, SV_PULL_BUFFER_SIZE);
+
+      if(r < 0) {
+#ifdef EINTR
+        if(errno == EINTR)
+          continue;
+#endif
+        return SV_STATUS_FAILED;
+      }
+      n = (size_t)r;
+      break;
+    }
+  }
+#endif
+  else
+    return SV_STATUS_FAILED;
+
+  t->pull_data = t->pull_buffer;
+  t->pull_len = n;
+  t->pull_offset = 0;
+  if(!n)
+    t->pull_eof = 1;
+
+  return SV_STATUS_OK;
+}
+
+
+/**
+ * sv_next_row:
+ * @t: sv object
+ * @fields_p: pointer to store the array of fields
+ * @widths_p: pointer to store the array of field widths
+ * @count_p: pointer to store the size of the arrays
+ *
+ * Get the next data row from the source
+ *
+ * The source is set with sv_set_option() and one of
+ * #SV_OPTION_SOURCE_FD, #SV_OPTION_SOURCE_BUFFER or
+ * #SV_OPTION_SOURCE_CALLBACK.  Parsing resumes where the last call
+ * stopped and stops again after the next data row, reading more input
+ * from the source when needed.  Headers, lines and comments are still
+ * returned to their callbacks but data rows are returned here instead
+ * of to the data, batch or struct callbacks.
+ *
+ * The fields are the same as those given to a data callback.  They
+ * point into internal buffers, or with #SV_OPTION_ZERO_COPY into the
+ * input, and are only valid until the next call, sv_reset() or
+ * sv_free().  Do not mix with sv_parse_chunk() on the same object.
+ *
+ * Return value: #SV_STATUS_OK with a row, #SV_STATUS_END when there are
+ * no more rows or an error code
+ */
+sv_status_t
+sv_next_row(sv *t, char*** fields_p, size_t** widths_p, size_t* count_p)
+{
+  sv_status_t status = SV_STATUS_OK;
+
+  if(!t || !fields_p || !widths_p || !count_p)
+    return SV_STATUS_FAILED;
+
+  if(t->source_fd < 0 && !t->source_data && !t->source_callback)
+    return SV_STATUS_FAILED;
+
+  t->pulling = 1;
+  t->pull_fields = NULL;
+
+  /* a callback may also pause the parse so continue until a row */
+  while(!t->pull_fields) {
+    if(t->pull_offset < t->pull_len) {
+      size_t consumed = 0;
+
+      status = sv_internal_parse_chunk(t, t->pull_data + t->pull_offset,
+                                       t->pull_len - t->pull_offset,
+                                       &consumed);
+      t->pull_offset += consumed;
+      if(status)
+        break;
+      continue;
+    }
+
+    if(t->pull_ended) {
+      status = SV_STATUS_END;
+      break;
+    }
+
+    if(t->pull_eof) {
+      /* returns the last row if it has no EOL */
+      t->pull_ended = 1;
+      status = sv_internal_parse_chunk(t, NULL, 0, NULL);
+      break;
+    }
+
+    status = sv_pull_fill(t);
+    if(status)
+      break;
+  }
+
+  t->pulling = 0;
+
+  /* a row that reached the maximum is returned before the end */
+  if(status == SV_STATUS_STOP)
+    status = t->pull_fields ? SV_STATUS_OK : SV_STATUS_END;
+
+  if(status || !t->pull_fields) {
+    if(!status)
+      status = SV_STATUS_END;
+    *fields_p = NULL;
+    *widths_p = NULL;
+    *count_p = 0;
+    return status;
+  }
+
+  *fields_p = t->pull_fields;
+  *widths_p = t->pull_widths;
+  *count_p = t->pull_count;
+
+  return SV_STATUS_OK;
+}
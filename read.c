@@ -35,19 +35,11 @@
 #include "sv_internal.h"
 
 
-/* Free fields, field_widths, headers and header_widths all based on
- * number of fields
- */
+/* Free fields, field_widths and field_offsets arrays */
 static void
 sv_free_fields(sv *t)
 {
   if(t->fields) {
-    unsigned int i;
-
-    for(i = 0; i < t->fields_count; i++)
-      if(t->fields[i])  /* Safe to free only non-NULL pointers */
-        free(t->fields[i]);
-
     free(t->fields);
     t->fields = NULL;
   }
@@ -57,7 +49,13 @@ sv_free_fields(sv *t)
     t->fields_widths = NULL;
   }
 
+  if(t->fields_offsets) {
+    free(t->fields_offsets);
+    t->fields_offsets = NULL;
+  }
+
   t->fields_count = 0;
+  t->fields_size = 0;
 }
 
 static void
@@ -78,6 +76,51 @@ sv_free_headers(sv *t)
   }
 }
 
+/**
+ * sv_internal_copy_headers:
+ * @dest: sv object to set
+ * @src: sv object to copy from
+ *
+ * INTERNAL - replace the headers of @dest with a copy of those of @src
+ *
+ * Return value: non-0 on failure
+ */
+sv_status_t
+sv_internal_copy_headers(sv *dest, sv *src)
+{
+  unsigned int i;
+
+  sv_free_headers(dest);
+  dest->headers_count = 0;
+  if(!src->headers)
+    return SV_STATUS_OK;
+
+  dest->headers = (char**)calloc(src->headers_count + 1, sizeof(char*));
+  dest->headers_widths = (size_t*)calloc(src->headers_count + 1,
+                                         sizeof(size_t));
+  if(!dest->headers || !dest->headers_widths) {
+    sv_free_headers(dest);
+    return SV_STATUS_NO_MEMORY;
+  }
+
+  for(i = 0; i < src->headers_count; i++) {
+    size_t width = src->headers_widths[i];
+
+    dest->headers[i] = (char*)malloc(width + 1);
+    if(!dest->headers[i]) {
+      dest->headers_count = i;
+      sv_free_headers(dest);
+      dest->headers_count = 0;
+      return SV_STATUS_NO_MEMORY;
+    }
+    memcpy(dest->headers[i], src->headers[i], width + 1);
+    dest->headers_widths[i] = width;
+  }
+  dest->headers_count = src->headers_count;
+
+  return SV_STATUS_OK;
+}
+
 static void
 sv_free_null_values(sv *t)
 {
@@ -99,9 +142,19 @@ sv_free_null_values(sv *t)
   t->null_values_count = 0;
 }
 
-/* Check if a field matches any configured null values */
-static int
-sv_is_null_value(sv *t, const char* field, size_t field_len)
+/**
+ * sv_internal_is_null_value:
+ * @t: sv object
+ * @field: field
+ * @field_len: length of @field
+ *
+ * INTERNAL - Check if a field is empty, a common null marker or any
+ * configured null value
+ *
+ * Return value: non-0 if @field is a null value
+ */
+int
+sv_internal_is_null_value(sv *t, const char* field, size_t field_len)
 {
   /* Safety check */
   if(!field || !t)
@@ -138,7 +191,11 @@ sv_is_null_value(sv *t, const char* field, size_t field_len)
   return 0;
 }
 
-/* Create or expand fields,widths,headers arrays to at least size nfields
+/* Create or expand fields,widths,offsets arrays to at least size nfields
+ *
+ * The arrays are kept across rows and resets; they are only
+ * reallocated when a row is wider than any seen before.  The size at
+ * least doubles each time so a row of N fields costs O(N) copying.
  */
 static sv_status_t
 sv_init_fields(sv *t, unsigned int nfields)
@@ -150,6 +207,11 @@ sv_init_fields(sv *t, unsigned int nfields)
   if(t->fields_count >= nfields)
     return SV_STATUS_OK;
 
+  if(nfields < t->fields_size) {
+    t->fields_count = nfields;
+    return SV_STATUS_OK;
+  }
+
   /* Calculate number of elements needed, checking for overflow if
    * nfields is UINT_MAX and unsigned int is the same size as size_t.
    */
@@ -164,6 +226,13 @@ sv_init_fields(sv *t, unsigned int nfields)
       return SV_STATUS_NO_MEMORY;
   }
 
+  /* Grow geometrically; start at a size that fits most rows */
+  if(num_elements < 16)
+    num_elements = 16;
+  if(num_elements < t->fields_size * 2 &&
+     t->fields_size <= SIZE_MAX / (2 * sizeof(char*)))
+    num_elements = t->fields_size * 2;
+
   /* Check for upcoming multiplication overflow for cp allocation */
   if (num_elements > SIZE_MAX / sizeof(char*)) {
     return SV_STATUS_NO_MEMORY;
@@ -171,7 +240,7 @@ sv_init_fields(sv *t, unsigned int nfields)
   cp = (char**)malloc(sizeof(char*) * num_elements);
   if(!cp)
     goto failed;
-  if(t->fields_count > 0) {
+  if(t->fields) {
     memcpy(cp, t->fields, sizeof(char*) * t->fields_count);
     free(t->fields);
   }
@@ -184,12 +253,22 @@ sv_init_fields(sv *t, unsigned int nfields)
   sp = (size_t*)malloc(sizeof(size_t) * num_elements);
   if(!sp)
     goto failed;
-  if(t->fields_count > 0) {
+  if(t->fields_widths) {
     memcpy(sp, t->fields_widths, sizeof(size_t) * t->fields_count);
     free(t->fields_widths);
   }
   t->fields_widths = sp;
 
+  sp = (size_t*)malloc(sizeof(size_t) * num_elements);
+  if(!sp)
+    goto failed;
+  if(t->fields_offsets) {
+    memcpy(sp, t->fields_offsets, sizeof(size_t) * t->fields_count);
+    free(t->fields_offsets);
+  }
+  t->fields_offsets = sp;
+
+  t->fields_size = num_elements;
   t->fields_count = nfields;
   return SV_STATUS_OK;
 
@@ -204,6 +283,8 @@ static void
 sv_reset_line_buffer(sv *t)
 {
   t->len = 0;
+  t->line_span = NULL;
+  t->line_span_len = 0;
 }
 
 
@@ -218,11 +299,9 @@ sv_internal_free_line_buffer(sv *t)
 
 
 void
-sv_internal_parse_reset(sv* t)
+sv_internal_free_fields(sv *t)
 {
   sv_free_fields(t);
-  sv_free_headers(t);
-  sv_free_null_values(t);
 
   if(t->fields_buffer) {
     free(t->fields_buffer);
@@ -230,17 +309,48 @@ sv_internal_parse_reset(sv* t)
   }
   t->fields_buffer_size = 0;
   t->fields_buffer_len = 0;
+  t->cell_start = 0;
+}
+
+
+void
+sv_internal_parse_reset(sv* t)
+{
+  sv_free_headers(t);
+  sv_free_null_values(t);
+
+  /* Keep the fields arrays and buffer allocated for the next parse */
+  t->fields_count = 0;
+  t->fields_buffer_len = 0;
+  t->cell_start = 0;
+  t->cell_span = NULL;
 
   sv_reset_line_buffer(t);
 
+  /* Selected column names are found again in the next header */
+  if(t->select_names)
+    sv_internal_select_columns(t, NULL, t->select_count);
+  t->column = 0;
+  t->skip_columns = 0;
+  t->skip_cell = 0;
+
+  sv_internal_batch_reset(t);
+
+  /* Struct field names are found again in the next header */
+  sv_internal_struct_reset(t);
+  t->struct_resolved = 0;
+
+  sv_internal_pull_reset(t);
+
   /* Set initial state */
   t->status = SV_STATUS_OK;
+  t->stopped = 0;
 
   t->state = SV_STATE_START_PARSE;
 }
 
 
-/* Ensure fields buffer is big enough for len bytes total */
+/* Ensure fields buffer is big enough for len more bytes */
 static sv_status_t
 sv_ensure_fields_buffer_size(sv *t, size_t len)
 {
@@ -352,32 +462,177 @@ sv_dump_buffer(FILE* fh, const char* buffer, size_t len)
 #endif
 
 /**
- * sv_line_buffer_add_char:
+ * sv_line_buffer_add_chars:
  * @t: sv object
- * @c: char
+ * @s: chars
+ * @len: number of chars in @s
  *
- * INTERNAL - Add char c to line buffer
+ * INTERNAL - Add a run of chars to line buffer
  *
  * Return value: non-0 on failure
  */
 static sv_status_t
-sv_line_buffer_add_char(sv* t, char c)
+sv_line_buffer_add_chars(sv* t, const char* s, size_t len)
 {
   sv_status_t status;
-  size_t llen = t->len;
 
-  status = sv_ensure_line_buffer_size(t, t->len + 1);
+  status = sv_ensure_line_buffer_size(t, len);
   if(status)
     return status;
 
-  t->buffer[llen++] = c;
-  t->buffer[llen] = '\0';
-  t->len = llen;
+  memcpy(t->buffer + t->len, s, len);
+  t->len += len;
+  t->buffer[t->len] = '\0';
 
   return SV_STATUS_OK;
 }
 
 
+/**
+ * sv_line_buffer_flush_span:
+ * @t: sv object
+ *
+ * INTERNAL - Copy the raw line span in the input chunk to the line buffer
+ *
+ * Called when the span can no longer be extended: the chunk ends
+ * or a skipped NUL breaks it up.
+ *
+ * Return value: non-0 on failure
+ */
+static sv_status_t
+sv_line_buffer_flush_span(sv* t)
+{
+  const char* span = t->line_span;
+
+  if(!span)
+    return SV_STATUS_OK;
+
+  t->line_span = NULL;
+  return sv_line_buffer_add_chars(t, span, t->line_span_len);
+}
+
+
+/**
+ * sv_line_buffer_record:
+ * @t: sv object
+ * @p: chars in the current input chunk
+ * @len: number of chars at @p
+ *
+ * INTERNAL - Record raw line chars if the line is needed
+ *
+ * The raw line is only used by the line callback and comment prefix
+ * check so nothing is recorded without them.  A line inside one
+ * input chunk is recorded as a span of the chunk, not copied.
+ *
+ * Return value: non-0 on failure
+ */
+static sv_status_t
+sv_line_buffer_record(sv* t, const char* p, size_t len)
+{
+  sv_status_t status;
+
+  if(!t->line_callback && !t->comment_prefix)
+    return SV_STATUS_OK;
+
+  if(t->line_span) {
+    if(p == t->line_span + t->line_span_len) {
+      t->line_span_len += len;
+      return SV_STATUS_OK;
+    }
+
+    status = sv_line_buffer_flush_span(t);
+    if(status)
+      return status;
+  } else if(!t->len) {
+    t->line_span = p;
+    t->line_span_len = len;
+    return SV_STATUS_OK;
+  }
+
+  return sv_line_buffer_add_chars(t, p, len);
+}
+
+
+/**
+ * sv_line_buffer_get:
+ * @t: sv object
+ * @len_p: pointer to store line length
+ *
+ * INTERNAL - Get the raw line recorded so far
+ *
+ * Return value: line (not NUL terminated) or NULL if none
+ */
+static const char*
+sv_line_buffer_get(sv* t, size_t* len_p)
+{
+  if(t->line_span) {
+    *len_p = t->line_span_len;
+    return t->line_span;
+  }
+
+  *len_p = t->len;
+  return t->buffer;
+}
+
+
+/**
+ * sv_line_buffer_get_copy:
+ * @t: sv object
+ * @len_p: pointer to store line length
+ *
+ * INTERNAL - Get the raw line recorded so far as a NUL terminated copy
+ *
+ * Return value: line or NULL on failure
+ */
+static const char*
+sv_line_buffer_get_copy(sv* t, size_t* len_p)
+{
+  if(sv_line_buffer_flush_span(t))
+    return NULL;
+
+  *len_p = t->len;
+  if(!t->buffer)
+    return "";
+
+  t->buffer[t->len] = '\0';
+  return t->buffer;
+}
+
+
+/**
+ * sv_parse_start_column:
+ * @t: sv object
+ * @column: source column index
+ *
+ * INTERNAL - Start a cell in source column @column and decide if it
+ * is skipped because it is not selected
+ */
+static void
+sv_parse_start_column(sv* t, unsigned int column)
+{
+  t->column = column;
+  t->skip_cell = t->skip_columns &&
+    (column >= t->select_map_size || !t->select_map[column]);
+}
+
+
+/**
+ * sv_parse_start_row_columns:
+ * @t: sv object
+ *
+ * INTERNAL - Start the columns of a row.  Unselected cells are
+ * skipped except in a header row, which is needed to find selected
+ * column names.
+ */
+static void
+sv_parse_start_row_columns(sv* t)
+{
+  t->skip_columns = (t->select_map != NULL) &&
+    !(t->line == 1 && (t->flags & SV_FLAGS_SAVE_HEADER));
+  sv_parse_start_column(t, 0);
+}
+
+
 /**
  * sv_parse_save_cell:
  * @t: sv object
@@ -392,36 +647,57 @@ sv_parse_save_cell(sv* t)
   sv_status_t status;
   char* s;
   unsigned int cell_ix = t->fields_count;
-  size_t cell_len = t->fields_buffer_len;
+  size_t cell_offset = t->cell_start;
+  size_t cell_len = t->fields_buffer_len - t->cell_start;
+  /* zero copy cell still in the input chunk */
+  int is_span = (t->cell_span != NULL);
+
+  if(t->skip_cell) {
+    /* unselected: nothing was stored */
+    sv_parse_start_column(t, t->column + 1);
+    return SV_STATUS_OK;
+  }
 
   status = sv_init_fields(t, cell_ix + 1);
   if(status)
     return status;
 
-  s = (char*)malloc(cell_len + 1);
-  if(!s)
-    return SV_STATUS_NO_MEMORY;
+  if(is_span) {
+    s = (char*)t->cell_span;
+    cell_len = t->cell_span_len;
+    cell_offset = SV_NO_OFFSET;
+    t->cell_span = NULL;
+  } else {
+    /* Terminate the cell in the row buffer; the next cell starts after */
+    status = sv_ensure_fields_buffer_size(t, 1);
+    if(status)
+      return status;
+    t->fields_buffer[t->fields_buffer_len++] = '\0';
+    t->cell_start = t->fields_buffer_len;
+
+    s = t->fields_buffer + cell_offset;
+  }
 
   if(t->flags & SV_FLAGS_STRIP_WHITESPACE) {
-    char *f = t->fields_buffer;
     /* Remove whitespace around a field */
-    while(cell_len > 0 && isspace(*f)) {
-      f++;
+    while(cell_len > 0 && isspace(*s)) {
+      s++;
+      if(!is_span)
+        cell_offset++;
       cell_len--;
     }
 
-    while(cell_len > 0 && isspace(f[cell_len - 1]))
+    while(cell_len > 0 && isspace(s[cell_len - 1]))
       cell_len--;
-    if(cell_len > 0)
-      memcpy(s, f, cell_len);
-  } else {
-    if(cell_len > 0 && t->fields_buffer)
-      memcpy(s, t->fields_buffer, cell_len);
+    if(!is_span)
+      s[cell_len] = '\0';
   }
-  s[cell_len] = '\0';
+
+  t->fields[cell_ix] = is_span ? s : NULL;
+  t->fields_offsets[cell_ix] = cell_offset;
 
   /* Check if this field is a null value */
-  if(sv_is_null_value(t, s, cell_len)) {
+  if(sv_internal_is_null_value(t, s, cell_len)) {
     /* Null value handling is configurable:
      * - Default mode: Return empty string "" (preserves backward compatibility)
      * - Enhanced mode: Return NULL pointer (when SV_OPTION_NULL_HANDLING is enabled)
@@ -429,22 +705,26 @@ sv_parse_save_cell(sv* t)
      * This allows callers to distinguish between empty strings and missing data
      * while maintaining compatibility with existing code.
      */
-    free(s);
     if(t->flags & SV_FLAGS_NULL_HANDLING) {
       /* Return NULL pointer for missing data */
-      s = NULL;
-      cell_len = 0;
+      t->fields[cell_ix] = NULL;
+      t->fields_offsets[cell_ix] = SV_NO_OFFSET;
+    } else if(is_span) {
+      /* Return empty string stored in the row buffer */
+      status = sv_ensure_fields_buffer_size(t, 1);
+      if(status)
+        return status;
+      t->fields[cell_ix] = NULL;
+      t->fields_offsets[cell_ix] = t->fields_buffer_len;
+      t->fields_buffer[t->fields_buffer_len++] = '\0';
+      t->cell_start = t->fields_buffer_len;
     } else {
       /* Return empty string (backward compatibility) */
-      s = (char*)malloc(1);
-      if(!s)
-        return SV_STATUS_NO_MEMORY;
       s[0] = '\0';
-      cell_len = 0;
     }
+    cell_len = 0;
   }
 
-  t->fields[cell_ix] = s;
   t->fields_widths[cell_ix] = cell_len;
 
 #if defined(SV_DEBUG) && SV_DEBUG > 2
@@ -452,121 +732,466 @@ sv_parse_save_cell(sv* t)
   sv_dump_buffer(stderr, s, cell_len);
 #endif
 
-  t->fields_buffer_len = 0;
+  if(t->skip_columns)
+    t->select_stored[t->column] = cell_ix;
+  sv_parse_start_column(t, t->column + 1);
 
   return SV_STATUS_OK;
 }
 
 
 /**
- * sv_parse_cell_add_char:
+ * sv_parse_resolve_select_names:
  * @t: sv object
- * @c: char
  *
- * INTERNAL - Add char c to current cell
+ * INTERNAL - Find selected column names in the header row fields
+ *
+ * Names not in the header select a missing column.
  *
  * Return value: non-0 on failure
  */
 static sv_status_t
-sv_parse_cell_add_char(sv* t, char c)
+sv_parse_resolve_select_names(sv* t)
 {
   sv_status_t status;
-  size_t len = t->fields_buffer_len;
+  unsigned int i;
+  unsigned int j;
+
+  for(i = 0; i < t->select_count; i++) {
+    const char* name = t->select_names[i];
+    size_t len = strlen(name);
+
+    t->select_columns[i] = -1;
+    for(j = 0; j < t->fields_count; j++) {
+      if(t->fields[j] && t->fields_widths[j] == len &&
+         !memcmp(t->fields[j], name, len)) {
+        t->select_columns[i] = (int)j;
+        break;
+      }
+    }
+  }
 
-  if(t->field_size_limit > 0 && len >= t->field_size_limit)
-    return SV_STATUS_FIELD_TOO_LARGE;
+  status = sv_internal_select_columns(t, t->select_columns, t->select_count);
+  return status;
+}
 
-  status = sv_ensure_fields_buffer_size(t, len + 1);
-  if(status)
-    return status;
 
-  t->fields_buffer[len++] = c;
-  t->fields_buffer_len = len;
+/**
+ * sv_parse_select_fields:
+ * @t: sv object
+ *
+ * INTERNAL - Fill the select fields and widths arrays with the
+ * selected columns of the row in the requested order
+ *
+ * Columns that are missing from the row are returned as an empty
+ * string or with #SV_OPTION_NULL_HANDLING as NULL.
+ */
+static void
+sv_parse_select_fields(sv* t)
+{
+  unsigned int i;
 
-  return SV_STATUS_OK;
+  for(i = 0; i < t->select_count; i++) {
+    int c = t->select_columns[i];
+
+    if(c >= 0 && (unsigned int)c < t->column) {
+      /* without skipping, every cell is stored in column order */
+      unsigned int ix = t->skip_columns ? t->select_stored[c] :
+        (unsigned int)c;
+
+      t->select_fields[i] = t->fields[ix];
+      t->select_widths[i] = t->fields_widths[ix];
+    } else {
+      t->select_fields[i] = (t->flags & SV_FLAGS_NULL_HANDLING) ?
+        NULL : (char*)"";
+      t->select_widths[i] = 0;
+    }
+  }
 }
 
 
 /**
- * sv_parse_generate_row:
+ * sv_parse_resolve_fields:
  * @t: sv object
  *
- * INTERNAL - generate a row from parse state
+ * INTERNAL - Point fields into the row buffer
+ *
+ * Cells are stored as offsets while the row is built since the row
+ * buffer may move as it grows.
+ */
+static void
+sv_parse_resolve_fields(sv* t)
+{
+  unsigned int i;
+
+  for(i = 0; i < t->fields_count; i++) {
+    if(t->fields_offsets[i] != SV_NO_OFFSET)
+      t->fields[i] = t->fields_buffer + t->fields_offsets[i];
+  }
+}
+
+
+/**
+ * sv_parse_cell_copy_chars:
+ * @t: sv object
+ * @s: chars
+ * @len: number of chars in @s
+ *
+ * INTERNAL - Copy chars to the current cell in the row buffer
  *
  * Return value: non-0 on failure
  */
 static sv_status_t
-sv_parse_generate_row(sv *t)
+sv_parse_cell_copy_chars(sv* t, const char* s, size_t len)
 {
-  sv_status_t status = SV_STATUS_OK;
-  int i = 0;
-
-  if(t->skip_rows_remaining > 0) {
-    t->skip_rows_remaining--;
-#if defined(SV_DEBUG) && SV_DEBUG > 2
-    fprintf(stderr, "Skipping row (%d remaining to skip) ",
-            t->skip_rows_remaining);
-    sv_dump_buffer(stderr, t->buffer, t->len);
-#endif
-    return status;
+  sv_status_t status;
+  sv_status_t limit_status = SV_STATUS_OK;
+  size_t buffer_len = t->fields_buffer_len;
+  size_t cell_len = buffer_len - t->cell_start;
+
+  if(t->field_size_limit > 0 && cell_len + len > t->field_size_limit) {
+    /* add what fits then fail, as adding char by char would */
+    len = (cell_len < t->field_size_limit) ?
+      t->field_size_limit - cell_len : 0;
+    limit_status = SV_STATUS_FIELD_TOO_LARGE;
   }
 
-  if(t->comment_prefix && !strncmp(t->buffer, t->comment_prefix,
-                                   t->comment_prefix_len)) {
-    char* comment = t->buffer + t->comment_prefix_len;
-    size_t comment_len = t->len - t->comment_prefix_len;
-#if defined(SV_DEBUG) && SV_DEBUG > 2
-    fprintf(stderr, "Skipping comment row %d ", t->line);
-    sv_dump_buffer(stderr, comment, comment_len);
-#endif
-    if(t->comment_callback)
-      status = t->comment_callback(t, t->callback_user_data,
-                                   comment, comment_len);
+  status = sv_ensure_fields_buffer_size(t, len);
+  if(status)
     return status;
-  }
 
-#if defined(SV_DEBUG) && SV_DEBUG > 2
-  fprintf(stderr, "Generating row %d\n", t->line);
-#endif
+  memcpy(t->fields_buffer + buffer_len, s, len);
+  t->fields_buffer_len = buffer_len + len;
 
-  if(t->line == 1 && (t->flags & SV_FLAGS_SAVE_HEADER)) {
-    int nheaders = t->fields_count;
-    char** cp;
-    size_t* sp;
+  return limit_status;
+}
 
-    /* first line and header: turn fields into headers */
-    cp = (char**)malloc(sizeof(char*) * (nheaders + 1));
-    if(!cp)
-      return SV_STATUS_NO_MEMORY;
-    t->headers = cp;
 
-    sp = (size_t*)malloc(sizeof(size_t) * (nheaders + 1));
-    if(!sp) {
-      free(t->headers); /* or free(cp) */
-      t->headers = NULL;
-      return SV_STATUS_NO_MEMORY;
-    }
-    t->headers_widths = sp;
+/**
+ * sv_parse_cell_flush_span:
+ * @t: sv object
+ *
+ * INTERNAL - Copy a zero copy cell span to the row buffer
+ *
+ * Return value: non-0 on failure
+ */
+static sv_status_t
+sv_parse_cell_flush_span(sv* t)
+{
+  const char* span = t->cell_span;
 
-    for(i = 0; i < nheaders; i++) {
-      size_t header_width = t->fields_widths[i];
-      t->headers[i] = (char*)malloc(header_width + 1);
-      if(!t->headers[i])
-        goto header_alloc_failed; /* Jump to cleanup block */
+  if(!span)
+    return SV_STATUS_OK;
 
-      if(header_width > 0 && t->fields[i])
-        memcpy(t->headers[i], t->fields[i], header_width + 1);
-      else
-        t->headers[i][0] = '\0';
-      t->headers_widths[i] = header_width;
-    }
-    t->headers_count = nheaders;
-  }
+  t->cell_span = NULL;
+  return sv_parse_cell_copy_chars(t, span, t->cell_span_len);
+}
 
-  if(t->line_callback) {
-    status = t->line_callback(t, t->callback_user_data,
-                              t->buffer, t->len);
-    if(status != SV_STATUS_OK)
+
+/**
+ * sv_parse_cell_add_span:
+ * @t: sv object
+ * @p: chars in the current input chunk
+ * @len: number of chars at @p
+ *
+ * INTERNAL - Add input chars to the current cell in zero copy mode
+ *
+ * A cell whose chars are contiguous in one input chunk is kept as a
+ * span of the chunk.  Anything else, such as an unescaped char after
+ * a gap, turns the cell into a copy in the row buffer.
+ *
+ * Return value: non-0 on failure
+ */
+static sv_status_t
+sv_parse_cell_add_span(sv* t, const char* p, size_t len)
+{
+  sv_status_t status;
+
+  if(t->cell_span && p == t->cell_span + t->cell_span_len) {
+    /* extend span */
+  } else if(t->cell_span) {
+    status = sv_parse_cell_flush_span(t);
+    if(status)
+      return status;
+    return sv_parse_cell_copy_chars(t, p, len);
+  } else if(t->fields_buffer_len == t->cell_start) {
+    /* start span in an empty cell */
+    t->cell_span = p;
+    t->cell_span_len = 0;
+  } else
+    return sv_parse_cell_copy_chars(t, p, len);
+
+  if(t->field_size_limit > 0 &&
+     t->cell_span_len + len > t->field_size_limit) {
+    t->cell_span_len = t->field_size_limit;
+    return SV_STATUS_FIELD_TOO_LARGE;
+  }
+  t->cell_span_len += len;
+
+  return SV_STATUS_OK;
+}
+
+
+/**
+ * sv_parse_cell_add_char:
+ * @t: sv object
+ * @c: char
+ * @p: pointer to @c in the input chunk or NULL if @c is not from the input
+ *
+ * INTERNAL - Add char c to current cell
+ *
+ * Return value: non-0 on failure
+ */
+static sv_status_t
+sv_parse_cell_add_char(sv* t, char c, const char* p)
+{
+  sv_status_t status;
+
+  if(t->skip_cell)
+    return SV_STATUS_OK;
+
+  if(t->flags & SV_FLAGS_SPANS) {
+    if(p)
+      return sv_parse_cell_add_span(t, p, 1);
+
+    status = sv_parse_cell_flush_span(t);
+    if(status)
+      return status;
+  }
+
+  return sv_parse_cell_copy_chars(t, &c, 1);
+}
+
+
+/**
+ * sv_parse_cell_add_chars:
+ * @t: sv object
+ * @s: chars in the current input chunk
+ * @len: number of chars in @s
+ *
+ * INTERNAL - Add a run of plain chars to current cell and line buffer
+ *
+ * Return value: non-0 on failure
+ */
+static sv_status_t
+sv_parse_cell_add_chars(sv* t, const char* s, size_t len)
+{
+  sv_status_t status;
+  sv_status_t cell_status;
+  size_t cell_len = t->cell_span ? t->cell_span_len :
+    t->fields_buffer_len - t->cell_start;
+
+  if(t->skip_cell)
+    return sv_line_buffer_record(t, s, len);
+
+  if(t->flags & SV_FLAGS_SPANS)
+    cell_status = sv_parse_cell_add_span(t, s, len);
+  else
+    cell_status = sv_parse_cell_copy_chars(t, s, len);
+  if(cell_status && cell_status != SV_STATUS_FIELD_TOO_LARGE)
+    return cell_status;
+
+  /* only record the chars that were added */
+  if(cell_status)
+    len = (t->cell_span ? t->cell_span_len :
+           t->fields_buffer_len - t->cell_start) - cell_len;
+
+  status = sv_line_buffer_record(t, s, len);
+  return status ? status : cell_status;
+}
+
+
+/**
+ * sv_parse_flush_spans:
+ * @t: sv object
+ *
+ * INTERNAL - Copy zero copy fields of a partial row to the row buffer
+ *
+ * Called at the end of an input chunk since the chunk is only valid
+ * during sv_parse_chunk().  The saved fields are copied before the
+ * current cell which is moved to the end of the row buffer.
+ *
+ * Return value: non-0 on failure
+ */
+static sv_status_t
+sv_parse_flush_spans(sv* t)
+{
+  sv_status_t status;
+  unsigned int i;
+  int copied = 0;
+  size_t cell_start = t->cell_start;
+  size_t cell_len = t->fields_buffer_len - t->cell_start;
+
+  for(i = 0; i < t->fields_count; i++) {
+    size_t width = t->fields_widths[i];
+
+    if(t->fields_offsets[i] != SV_NO_OFFSET || !t->fields[i])
+      continue;
+
+    copied = 1;
+
+    status = sv_ensure_fields_buffer_size(t, width + 1);
+    if(status)
+      return status;
+    memcpy(t->fields_buffer + t->fields_buffer_len, t->fields[i], width);
+    t->fields_offsets[i] = t->fields_buffer_len;
+    t->fields[i] = NULL;
+    t->fields_buffer_len += width;
+    t->fields_buffer[t->fields_buffer_len++] = '\0';
+  }
+
+  if(copied) {
+    /* saved fields were copied: move the current cell after them */
+    status = sv_ensure_fields_buffer_size(t, cell_len);
+    if(status)
+      return status;
+    memmove(t->fields_buffer + t->fields_buffer_len,
+            t->fields_buffer + cell_start, cell_len);
+    t->cell_start = t->fields_buffer_len;
+    t->fields_buffer_len += cell_len;
+  }
+
+  return sv_parse_cell_flush_span(t);
+}
+
+
+/* A callback returning SV_STATUS_PAUSE asks for the parse to stop
+ * after this row; the row is otherwise handled as for SV_STATUS_OK.
+ * SV_STATUS_STOP ends parsing at once.
+ */
+static sv_status_t
+sv_parse_callback_status(sv* t, sv_status_t status)
+{
+  if(status == SV_STATUS_PAUSE) {
+    t->pause = 1;
+    status = SV_STATUS_OK;
+  } else if(status == SV_STATUS_STOP)
+    t->stopped = 1;
+  return status;
+}
+
+
+/**
+ * sv_parse_generate_row:
+ * @t: sv object
+ *
+ * INTERNAL - generate a row from parse state
+ *
+ * Return value: non-0 on failure
+ */
+static sv_status_t
+sv_parse_generate_row(sv *t)
+{
+  sv_status_t status = SV_STATUS_OK;
+  int i = 0;
+  const char* line;
+  size_t line_len;
+  /* fields returned to the user */
+  char** fields;
+  size_t* widths;
+  size_t count;
+
+  line = sv_line_buffer_get(t, &line_len);
+
+  if(t->skip_rows_remaining > 0) {
+    t->skip_rows_remaining--;
+#if defined(SV_DEBUG) && SV_DEBUG > 2
+    fprintf(stderr, "Skipping row (%d remaining to skip) ",
+            t->skip_rows_remaining);
+    sv_dump_buffer(stderr, line, line_len);
+#endif
+    return status;
+  }
+
+  if(t->comment_prefix && line_len >= t->comment_prefix_len &&
+     !memcmp(line, t->comment_prefix, t->comment_prefix_len)) {
+    const char* comment;
+    size_t comment_len;
+
+    if(t->comment_callback && !(t->flags & SV_FLAGS_ZERO_COPY)) {
+      line = sv_line_buffer_get_copy(t, &line_len);
+      if(!line)
+        return SV_STATUS_NO_MEMORY;
+    }
+    comment = line + t->comment_prefix_len;
+    comment_len = line_len - t->comment_prefix_len;
+#if defined(SV_DEBUG) && SV_DEBUG > 2
+    fprintf(stderr, "Skipping comment row %d ", t->line);
+    sv_dump_buffer(stderr, comment, comment_len);
+#endif
+    if(t->comment_callback)
+      status = t->comment_callback(t, t->callback_user_data,
+                                   comment, comment_len);
+    return sv_parse_callback_status(t, status);
+  }
+
+#if defined(SV_DEBUG) && SV_DEBUG > 2
+  fprintf(stderr, "Generating row %d\n", t->line);
+#endif
+
+  sv_parse_resolve_fields(t);
+
+  fields = t->fields;
+  widths = t->fields_widths;
+  count = t->fields_count;
+  if(t->select_columns) {
+    if(t->select_names && t->line == 1 &&
+       (t->flags & SV_FLAGS_SAVE_HEADER)) {
+      status = sv_parse_resolve_select_names(t);
+      if(status)
+        return status;
+    }
+
+    sv_parse_select_fields(t);
+    fields = t->select_fields;
+    widths = t->select_widths;
+    count = t->select_count;
+  }
+
+  if(t->line == 1 && (t->flags & SV_FLAGS_SAVE_HEADER)) {
+    int nheaders = (int)count;
+    char** cp;
+    size_t* sp;
+
+    /* first line and header: turn fields into headers */
+    cp = (char**)malloc(sizeof(char*) * (nheaders + 1));
+    if(!cp)
+      return SV_STATUS_NO_MEMORY;
+    t->headers = cp;
+
+    sp = (size_t*)malloc(sizeof(size_t) * (nheaders + 1));
+    if(!sp) {
+      free(t->headers); /* or free(cp) */
+      t->headers = NULL;
+      return SV_STATUS_NO_MEMORY;
+    }
+    t->headers_widths = sp;
+
+    for(i = 0; i < nheaders; i++) {
+      size_t header_width = widths[i];
+      t->headers[i] = (char*)malloc(header_width + 1);
+      if(!t->headers[i])
+        goto header_alloc_failed; /* Jump to cleanup block */
+
+      if(header_width > 0 && fields[i])
+        memcpy(t->headers[i], fields[i], header_width);
+      t->headers[i][header_width] = '\0';
+      t->headers_widths[i] = header_width;
+    }
+    t->headers_count = nheaders;
+  }
+
+  if(t->line_callback) {
+    /* the chunk span is only passed on in zero copy mode */
+    if(!(t->flags & SV_FLAGS_ZERO_COPY)) {
+      line = sv_line_buffer_get_copy(t, &line_len);
+      if(!line)
+        return SV_STATUS_NO_MEMORY;
+    }
+    status = t->line_callback(t, t->callback_user_data,
+                              line, line_len);
+    status = sv_parse_callback_status(t, status);
+    if(status != SV_STATUS_OK)
       return status;
   }
 
@@ -575,23 +1200,52 @@ sv_parse_generate_row(sv *t)
       /* got header fields - return them to user */
       status = t->header_callback(t, t->callback_user_data, t->headers,
                                   t->headers_widths, t->headers_count);
+      status = sv_parse_callback_status(t, status);
       if(status != SV_STATUS_OK)
         return status;
     }
+    if(t->pause_after_prefix)
+      t->pause = 1;
   } else {
     /* data */
 
-    if(t->data_callback) {
+    if(t->pulling) {
+      /* keep for sv_next_row() and stop parsing after this row */
+      t->pull_fields = fields;
+      t->pull_widths = widths;
+      t->pull_count = count;
+      t->pause = 1;
+    } else if(t->struct_callback) {
+      /* convert into the next struct; returned to the user when full */
+      status = sv_internal_struct_add_row(t, fields, widths, count);
+      status = sv_parse_callback_status(t, status);
+      if(status != SV_STATUS_OK)
+        return status;
+    } else if(t->batch_callback) {
+      /* add to batch; returned to the user when full */
+      status = sv_internal_batch_add_row(t, fields, widths, count);
+      status = sv_parse_callback_status(t, status);
+      if(status != SV_STATUS_OK)
+        return status;
+    } else if(t->data_callback) {
       /* got data fields - return them to user */
-      status = t->data_callback(t, t->callback_user_data, t->fields,
-                                t->fields_widths, t->fields_count);
+      status = t->data_callback(t, t->callback_user_data, fields,
+                                widths, count);
+      status = sv_parse_callback_status(t, status);
       if(status != SV_STATUS_OK)
         return status;
     }
+
+    t->data_rows++;
   }
 
   t->line++;
 
+  if(t->max_rows && t->data_rows >= t->max_rows) {
+    t->stopped = 1;
+    return SV_STATUS_STOP;
+  }
+
   return status;
 
 header_alloc_failed:
@@ -630,8 +1284,12 @@ header_alloc_failed:
 static void
 sv_parse_prepare_for_new_row(sv *t)
 {
-  sv_free_fields(t);
+  t->fields_count = 0;
+  t->fields_buffer_len = 0;
+  t->cell_start = 0;
+  t->cell_span = NULL;
   sv_reset_line_buffer(t);
+  sv_parse_start_row_columns(t);
 }
 
 
@@ -659,10 +1317,259 @@ sv_get_state_label(sv_parse_state state) {
 
 #endif
 
+
+/* Once-only per parse initialising; may be altered by options */
+static void
+sv_parse_start(sv *t)
+{
+  t->line = 1;
+  t->skip_rows_remaining = t->skip_rows;
+  t->bad_records = 0;
+  t->data_rows = 0;
+  sv_parse_start_row_columns(t);
+}
+
+
+#ifdef SV_DFA
+/* DFA table entry: action in the high 4 bits, next state in the low 4 */
+#define SV_DFA_ENTRY(action, next) ((unsigned char)(((action) << 4) | (next)))
+#define SV_DFA_ACTION(entry) ((entry) >> 4)
+#define SV_DFA_NEXT(entry) ((sv_parse_state)((entry) & 0xF))
+
+typedef enum {
+  /* only change state */
+  SV_ACTION_NONE,
+  /* add char to cell */
+  SV_ACTION_ADD,
+  /* end of input after an escape char: add a newline to cell */
+  SV_ACTION_ADD_NL,
+  /* save cell */
+  SV_ACTION_SAVE,
+  /* save cell and return row */
+  SV_ACTION_ROW,
+  /* end of input after an EOL */
+  SV_ACTION_BAD_EOL
+} sv_dfa_action;
+
+
+/*
+ * Find the action and next state for a char with class bits @cls in
+ * @state.  This follows the order of the checks in the switch based
+ * sv_internal_parse_process_char() including its fall throughs.
+ */
+static unsigned char
+sv_dfa_transition(sv *t, sv_parse_state state, unsigned int cls)
+{
+  /* end of row: next state depends on whether there is more input */
+  const sv_parse_state after_row = (cls & SV_CLASS_NUL) ?
+    SV_STATE_START_ROW : SV_STATE_EOL;
+
+  switch(state) {
+    case SV_STATE_START_PARSE:
+    case SV_STATE_START_FILE:
+    case SV_STATE_START_ROW:
+      if(cls & SV_CLASS_NUL)
+        return SV_DFA_ENTRY(SV_ACTION_NONE, SV_STATE_START_ROW);
+      if(cls & SV_CLASS_EOL)
+        return SV_DFA_ENTRY(SV_ACTION_NONE, SV_STATE_EOL);
+      return sv_dfa_transition(t, SV_STATE_START_CELL, cls);
+
+    case SV_STATE_START_CELL:
+      if(cls & SV_CLASS_EOL)
+        return SV_DFA_ENTRY(SV_ACTION_ROW, after_row);
+      if(cls & SV_CLASS_QUOTE)
+        return SV_DFA_ENTRY(SV_ACTION_NONE, SV_STATE_IN_QUOTED_CELL);
+      if(cls & SV_CLASS_ESCAPE)
+        return SV_DFA_ENTRY(SV_ACTION_NONE, SV_STATE_ESC_IN_CELL);
+      if(cls & SV_CLASS_SPACE)
+        return SV_DFA_ENTRY(SV_ACTION_NONE, SV_STATE_START_CELL);
+      if(cls & SV_CLASS_SEP)
+        return SV_DFA_ENTRY(SV_ACTION_SAVE, SV_STATE_START_CELL);
+      return SV_DFA_ENTRY(SV_ACTION_ADD, SV_STATE_IN_CELL);
+
+    case SV_STATE_ESC_IN_CELL:
+      if(cls & SV_CLASS_NUL)
+        return SV_DFA_ENTRY(SV_ACTION_ADD_NL, SV_STATE_IN_CELL);
+      if(cls & SV_CLASS_EOL)
+        return SV_DFA_ENTRY(SV_ACTION_ADD, SV_STATE_ESC_EOL);
+      return SV_DFA_ENTRY(SV_ACTION_ADD, SV_STATE_IN_CELL);
+
+    case SV_STATE_ESC_EOL:
+      if(cls & SV_CLASS_NUL)
+        return SV_DFA_ENTRY(SV_ACTION_NONE, SV_STATE_ESC_EOL);
+      if(1) {
+        /* handled as in a cell but the switch leaves the state as is
+         * when a char is added */
+        unsigned char entry = sv_dfa_transition(t, SV_STATE_IN_CELL, cls);
+
+        if(SV_DFA_NEXT(entry) == SV_STATE_IN_CELL)
+          entry = SV_DFA_ENTRY(SV_DFA_ACTION(entry), SV_STATE_ESC_EOL);
+        return entry;
+      }
+
+    case SV_STATE_IN_CELL:
+      if(cls & SV_CLASS_EOL)
+        return SV_DFA_ENTRY(SV_ACTION_ROW, after_row);
+      if(cls & SV_CLASS_ESCAPE)
+        return SV_DFA_ENTRY(SV_ACTION_NONE, SV_STATE_ESC_IN_CELL);
+      if(cls & SV_CLASS_SEP)
+        return SV_DFA_ENTRY(SV_ACTION_SAVE, SV_STATE_START_CELL);
+      return SV_DFA_ENTRY(SV_ACTION_ADD, SV_STATE_IN_CELL);
+
+    case SV_STATE_IN_QUOTED_CELL:
+      if(cls & SV_CLASS_NUL)
+        return SV_DFA_ENTRY(SV_ACTION_NONE, SV_STATE_IN_QUOTED_CELL);
+      if(cls & SV_CLASS_ESCAPE)
+        return SV_DFA_ENTRY(SV_ACTION_NONE, SV_STATE_ESC_IN_QUOTED_CELL);
+      if(cls & SV_CLASS_QUOTE)
+        return SV_DFA_ENTRY(SV_ACTION_NONE,
+                            (t->flags & SV_FLAGS_DOUBLE_QUOTE) ?
+                            SV_STATE_QUOTE_IN_QUOTED_CELL : SV_STATE_IN_CELL);
+      return SV_DFA_ENTRY(SV_ACTION_ADD, SV_STATE_IN_QUOTED_CELL);
+
+    case SV_STATE_ESC_IN_QUOTED_CELL:
+      if(cls & SV_CLASS_NUL)
+        return SV_DFA_ENTRY(SV_ACTION_ADD_NL, SV_STATE_IN_QUOTED_CELL);
+      return SV_DFA_ENTRY(SV_ACTION_ADD, SV_STATE_IN_QUOTED_CELL);
+
+    case SV_STATE_QUOTE_IN_QUOTED_CELL:
+      if(cls & SV_CLASS_QUOTE)
+        return SV_DFA_ENTRY(SV_ACTION_ADD, SV_STATE_IN_QUOTED_CELL);
+      if(cls & SV_CLASS_SEP)
+        return SV_DFA_ENTRY(SV_ACTION_SAVE, SV_STATE_START_CELL);
+      if(cls & SV_CLASS_EOL)
+        return SV_DFA_ENTRY(SV_ACTION_ROW, after_row);
+      return SV_DFA_ENTRY(SV_ACTION_ADD, SV_STATE_IN_CELL);
+
+    case SV_STATE_EOL:
+      if(cls & SV_CLASS_NUL)
+        return SV_DFA_ENTRY(SV_ACTION_BAD_EOL, SV_STATE_EOL);
+      if(cls & SV_CLASS_EOL)
+        return SV_DFA_ENTRY(SV_ACTION_NONE, SV_STATE_EOL);
+      return sv_dfa_transition(t, SV_STATE_START_ROW, cls);
+
+    case SV_STATE_COMMENT:
+      if((cls & SV_CLASS_EOL) && !(cls & SV_CLASS_NUL))
+        return SV_DFA_ENTRY(SV_ACTION_NONE, SV_STATE_EOL);
+      return SV_DFA_ENTRY(SV_ACTION_NONE, SV_STATE_COMMENT);
+
+    case SV_STATE_UNKNOWN:
+    default:
+      break;
+  }
+
+  return SV_DFA_ENTRY(SV_ACTION_NONE, state);
+}
+
+
+/**
+ * sv_internal_parse_update_dfa:
+ * @t: sv object
+ *
+ * INTERNAL - rebuild the DFA transition table for the current dialect
+ */
+void
+sv_internal_parse_update_dfa(sv *t)
+{
+  unsigned int state;
+  unsigned int cls;
+
+  for(state = 0; state <= SV_STATE_LAST; state++) {
+    for(cls = 0; cls < SV_CLASS_COUNT; cls++)
+      t->dfa[state][cls] = sv_dfa_transition(t, (sv_parse_state)state, cls);
+  }
+}
+#endif
+
+
+#ifdef SV_DFA
 /**
  * sv_internal_parse_process_char:
  * @t: sv object
  * @c: char
+ * @p: pointer to @c in the input chunk or NULL at end of input
+ *
+ * INTERNAL - process one character; NUL indicates end of input
+ *
+ * Table driven version: looks up the action and next state for the
+ * current state and the class of @c in the DFA table.
+ *
+ * Return value: non-0 on failure
+ */
+static sv_status_t
+sv_internal_parse_process_char(sv *t, char c, const char* p)
+{
+  sv_status_t status = SV_STATUS_OK;
+  unsigned char entry;
+
+  if(t->state == SV_STATE_START_PARSE) {
+    sv_parse_start(t);
+    t->state = SV_STATE_START_FILE;
+  }
+
+  entry = t->dfa[t->state][t->char_class[(unsigned char)c]];
+
+  switch(SV_DFA_ACTION(entry)) {
+    case SV_ACTION_ADD_NL:
+      c = '\n';
+      /* FALLTHROUGH */
+    case SV_ACTION_ADD:
+      status = sv_parse_cell_add_char(t, c, p);
+      break;
+
+    case SV_ACTION_SAVE:
+      status = sv_parse_save_cell(t);
+      break;
+
+    case SV_ACTION_ROW:
+      status = sv_parse_save_cell(t);
+      if(status)
+        break;
+
+      status = sv_parse_generate_row(t);
+      sv_parse_prepare_for_new_row(t);
+      /* the row is done even if a callback failed, as in the switch */
+      t->state = SV_DFA_NEXT(entry);
+      break;
+
+    case SV_ACTION_BAD_EOL:
+      t->bad_records++;
+      if(t->flags & SV_FLAGS_BAD_DATA_ERROR) {
+#if defined(SV_DEBUG) && SV_DEBUG > 1
+        fprintf(stderr, "Error in line %d: newline seen in unquoted cell\n",
+                t->line);
+#endif
+        return SV_STATUS_FAILED;
+      }
+      break;
+
+    case SV_ACTION_NONE:
+    default:
+      break;
+  }
+  if(status)
+    return status;
+
+  t->state = SV_DFA_NEXT(entry);
+
+  if(c && t->state != SV_STATE_EOL) {
+    /* at end of input c may be an added EOL that is not in a chunk */
+    if(p)
+      return sv_line_buffer_record(t, p, 1);
+    else if(t->line_callback || t->comment_prefix)
+      return sv_line_buffer_add_chars(t, &c, 1);
+  }
+
+  return SV_STATUS_OK;
+}
+
+#else
+
+/**
+ * sv_internal_parse_process_char:
+ * @t: sv object
+ * @c: char
+ * @p: pointer to @c in the input chunk or NULL at end of input
  *
  * INTERNAL - process one character; NUL indicates end of input
  *
@@ -670,9 +1577,11 @@ sv_get_state_label(sv_parse_state state) {
  */
 
 static sv_status_t
-sv_internal_parse_process_char(sv *t, char c)
+sv_internal_parse_process_char(sv *t, char c, const char* p)
 {
   sv_status_t status;
+  /* SV_CLASS_* bits of c */
+  const unsigned int cls = t->char_class[(unsigned char)c];
 
 #if defined(SV_DEBUG) && SV_DEBUG > 2
   if(isprint(c))
@@ -687,10 +1596,7 @@ sv_internal_parse_process_char(sv *t, char c)
   redo:
   switch(t->state) {
     case SV_STATE_START_PARSE:
-      /* once-only per parse initialising; may be altered by options */
-      t->line = 1;
-      t->skip_rows_remaining = t->skip_rows;
-      t->bad_records = 0;
+      sv_parse_start(t);
 
       t->state = SV_STATE_START_FILE;
       /* FALLTHROUGH */
@@ -712,41 +1618,42 @@ sv_internal_parse_process_char(sv *t, char c)
       /* FALLTHROUGH */
 
     case SV_STATE_START_CELL:
-      if(c == '\n' || c == '\r' || !c) {
+      if(!cls) {
+        /* begin new unquoted cell */
+        status = sv_parse_cell_add_char(t, c, p);
+        if(status)
+          return status;
+
+        t->state = SV_STATE_IN_CELL;
+      } else if(cls & SV_CLASS_EOL) {
         /* empty cell and end of row */
         status = sv_parse_save_cell(t);
         if(status)
           return status;
 
-        sv_parse_generate_row(t);
+        status = sv_parse_generate_row(t);
         sv_parse_prepare_for_new_row(t);
         t->state = (!c ? SV_STATE_START_ROW : SV_STATE_EOL);
-      } else if(t->quote_char && c == t->quote_char) {
+        if(status)
+          return status;
+      } else if(cls & SV_CLASS_QUOTE) {
         t->state = SV_STATE_IN_QUOTED_CELL;
-      } else if(t->escape_char && c == t->escape_char) {
+      } else if(cls & SV_CLASS_ESCAPE) {
         t->state = SV_STATE_ESC_IN_CELL;
-      } else if((c == ' ' || c == '\t') &&
-                (t->flags & SV_FLAGS_STRIP_WHITESPACE))
+      } else if(cls & SV_CLASS_SPACE)
         /* ignore whitespace at start of cell */
         ;
-      else if(c == t->field_sep) {
-        /* empty cell */
+      else {
+        /* separator: empty cell */
         status = sv_parse_save_cell(t);
         if(status)
           return status;
-      } else {
-        /* begin new unquoted cell */
-        status = sv_parse_cell_add_char(t, c);
-        if(status)
-          return status;
-
-        t->state = SV_STATE_IN_CELL;
       }
       break;
 
     case SV_STATE_ESC_IN_CELL:
       if(c == '\n' || c=='\r') {
-        status = sv_parse_cell_add_char(t, c);
+        status = sv_parse_cell_add_char(t, c, p);
         if(status)
           return status;
 
@@ -757,7 +1664,7 @@ sv_internal_parse_process_char(sv *t, char c)
       /* At end of input, add the missing EOL */
       if(!c)
         c = '\n';
-      status = sv_parse_cell_add_char(t, c);
+      status = sv_parse_cell_add_char(t, c, p);
       if(status)
         return status;
 
@@ -772,45 +1679,49 @@ sv_internal_parse_process_char(sv *t, char c)
 
     case SV_STATE_IN_CELL:
       /* regular unquoted cell */
-      if(c == '\n' || c == '\r' || !c) {
+      if(!(cls & (SV_CLASS_EOL | SV_CLASS_ESCAPE | SV_CLASS_SEP))) {
+        status = sv_parse_cell_add_char(t, c, p);
+        if(status)
+          return status;
+      } else if(cls & SV_CLASS_EOL) {
         /* end of line - return row */
         status = sv_parse_save_cell(t);
         if(status)
           return status;
 
-        sv_parse_generate_row(t);
+        status = sv_parse_generate_row(t);
         sv_parse_prepare_for_new_row(t);
         t->state = (!c ? SV_STATE_START_ROW : SV_STATE_EOL);
-      } else if(t->escape_char && c == t->escape_char) {
+        if(status)
+          return status;
+      } else if(cls & SV_CLASS_ESCAPE) {
         t->state = SV_STATE_ESC_IN_CELL;
-      } else if(c == t->field_sep) {
+      } else {
+        /* separator */
         status = sv_parse_save_cell(t);
         if(status)
           return status;
 
         t->state = SV_STATE_START_CELL;
-      } else {
-        status = sv_parse_cell_add_char(t, c);
-        if(status)
-          return status;
       }
       break;
 
     case SV_STATE_IN_QUOTED_CELL:
-      if(!c)
+      if(!(cls & (SV_CLASS_NUL | SV_CLASS_ESCAPE | SV_CLASS_QUOTE))) {
+        status = sv_parse_cell_add_char(t, c, p);
+        if(status)
+          return status;
+      } else if(cls & SV_CLASS_NUL)
         /* end of input */
         ;
-      else if(t->escape_char && c == t->escape_char) {
+      else if(cls & SV_CLASS_ESCAPE) {
         t->state = SV_STATE_ESC_IN_QUOTED_CELL;
-      } else if(t->quote_char && c == t->quote_char) {
+      } else {
+        /* quote */
         if(t->flags & SV_FLAGS_DOUBLE_QUOTE)
           t->state = SV_STATE_QUOTE_IN_QUOTED_CELL;
         else
           t->state = SV_STATE_IN_CELL;
-      } else {
-        status = sv_parse_cell_add_char(t, c);
-        if(status)
-          return status;
       }
       break;
 
@@ -818,7 +1729,7 @@ sv_internal_parse_process_char(sv *t, char c)
       if(!c)
         /* end of input - add newline */
         c = '\n';
-      status = sv_parse_cell_add_char(t, c);
+      status = sv_parse_cell_add_char(t, c, p);
       if(status)
         return status;
 
@@ -827,32 +1738,34 @@ sv_internal_parse_process_char(sv *t, char c)
 
     case SV_STATE_QUOTE_IN_QUOTED_CELL:
       /* after a quote char in an quoted cell */
-      if(t->quote_char && c == t->quote_char) {
+      if(cls & SV_CLASS_QUOTE) {
         /* <quote><quote> so write just 1 */
-        status = sv_parse_cell_add_char(t, c);
+        status = sv_parse_cell_add_char(t, c, p);
         if(status)
           return status;
 
         t->state = SV_STATE_IN_QUOTED_CELL;
-      } else if(c == t->field_sep) {
+      } else if(cls & SV_CLASS_SEP) {
         /* had <quote><sep> so cell has ended - save it and start new one */
         status = sv_parse_save_cell(t);
         if(status)
           return status;
 
         t->state = SV_STATE_START_CELL;
-      } else if(c == '\n' || c == '\r' || !c) {
+      } else if(cls & SV_CLASS_EOL) {
         /* <quote><cr/nl> ends row */
         status = sv_parse_save_cell(t);
         if(status)
           return status;
 
-        sv_parse_generate_row(t);
+        status = sv_parse_generate_row(t);
         sv_parse_prepare_for_new_row(t);
         t->state = (!c ? SV_STATE_START_ROW : SV_STATE_EOL);
+        if(status)
+          return status;
       } else {
         /* FIXME: could check that <quote> is followed by <sep> */
-        status = sv_parse_cell_add_char(t, c);
+        status = sv_parse_cell_add_char(t, c, p);
         if(status)
           return status;
 
@@ -888,11 +1801,139 @@ sv_internal_parse_process_char(sv *t, char c)
       break;
   }
 
-  if(c && t->state != SV_STATE_EOL)
-    sv_line_buffer_add_char(t, c);
+  if(c && t->state != SV_STATE_EOL) {
+    /* at end of input c may be an added EOL that is not in a chunk */
+    if(p)
+      return sv_line_buffer_record(t, p, 1);
+    else if(t->line_callback || t->comment_prefix)
+      return sv_line_buffer_add_chars(t, &c, 1);
+  }
 
   return SV_STATUS_OK;
 }
+#endif
+
+
+/*
+ * Skip the rows still to skip from the start of @buffer without
+ * saving cells, lines or calling callbacks.  This follows the parser
+ * states so it ends rows where sv_internal_parse_process_char() would,
+ * honouring quotes and escapes, and skips runs of bytes that cannot
+ * end a cell with sv_internal_scan_run().  Stops after the byte that
+ * ended the last row to skip.
+ *
+ * Return value: number of bytes of @buffer used
+ */
+static size_t
+sv_parse_skip_rows(sv* t, const char* buffer, size_t len,
+                   const char* cell_stops, unsigned int cell_nstops,
+                   const char* quoted_stops, unsigned int quoted_nstops)
+{
+  size_t i = 0;
+
+  while(i < len && t->skip_rows_remaining > 0) {
+    char c;
+    unsigned int cls;
+
+    if(t->state == SV_STATE_IN_CELL || t->state == SV_STATE_ESC_EOL) {
+      i += sv_internal_scan_run(buffer + i, len - i, cell_stops, cell_nstops);
+      if(i == len)
+        break;
+    } else if(t->state == SV_STATE_IN_QUOTED_CELL) {
+      i += sv_internal_scan_run(buffer + i, len - i,
+                                quoted_stops, quoted_nstops);
+      if(i == len)
+        break;
+    }
+
+    c = buffer[i++];
+    /* NULs in input are ignored */
+    if(!c)
+      continue;
+    cls = t->char_class[(unsigned char)c];
+
+    switch(t->state) {
+      case SV_STATE_EOL:
+      case SV_STATE_START_PARSE:
+      case SV_STATE_START_FILE:
+      case SV_STATE_START_ROW:
+        if(c == '\n' || c == '\r') {
+          t->state = SV_STATE_EOL;
+          break;
+        }
+        /* FALLTHROUGH */
+
+      case SV_STATE_START_CELL:
+        if(!cls)
+          t->state = SV_STATE_IN_CELL;
+        else if(cls & SV_CLASS_EOL)
+          goto end_row;
+        else if(cls & SV_CLASS_QUOTE)
+          t->state = SV_STATE_IN_QUOTED_CELL;
+        else if(cls & SV_CLASS_ESCAPE)
+          t->state = SV_STATE_ESC_IN_CELL;
+        else
+          /* whitespace or separator */
+          t->state = SV_STATE_START_CELL;
+        break;
+
+      case SV_STATE_ESC_IN_CELL:
+        t->state = (c == '\n' || c == '\r') ? SV_STATE_ESC_EOL :
+          SV_STATE_IN_CELL;
+        break;
+
+      case SV_STATE_ESC_EOL:
+      case SV_STATE_IN_CELL:
+        if(cls & SV_CLASS_EOL)
+          goto end_row;
+        else if(cls & SV_CLASS_ESCAPE)
+          t->state = SV_STATE_ESC_IN_CELL;
+        else if(cls & SV_CLASS_SEP)
+          t->state = SV_STATE_START_CELL;
+        break;
+
+      case SV_STATE_IN_QUOTED_CELL:
+        if(cls & SV_CLASS_ESCAPE)
+          t->state = SV_STATE_ESC_IN_QUOTED_CELL;
+        else if(cls & SV_CLASS_QUOTE)
+          t->state = (t->flags & SV_FLAGS_DOUBLE_QUOTE) ?
+            SV_STATE_QUOTE_IN_QUOTED_CELL : SV_STATE_IN_CELL;
+        break;
+
+      case SV_STATE_ESC_IN_QUOTED_CELL:
+        t->state = SV_STATE_IN_QUOTED_CELL;
+        break;
+
+      case SV_STATE_QUOTE_IN_QUOTED_CELL:
+        if(cls & SV_CLASS_QUOTE)
+          t->state = SV_STATE_IN_QUOTED_CELL;
+        else if(cls & SV_CLASS_SEP)
+          t->state = SV_STATE_START_CELL;
+        else if(cls & SV_CLASS_EOL)
+          goto end_row;
+        else
+          t->state = SV_STATE_IN_CELL;
+        break;
+
+      case SV_STATE_COMMENT:
+      case SV_STATE_UNKNOWN:
+      default:
+        break;
+    }
+    continue;
+
+  end_row:
+#if defined(SV_DEBUG) && SV_DEBUG > 2
+    fprintf(stderr, "Skipped row (%d remaining to skip)\n",
+            t->skip_rows_remaining - 1);
+#endif
+    t->skip_rows_remaining--;
+    sv_parse_prepare_for_new_row(t);
+    t->state = SV_STATE_EOL;
+  }
+
+  return i;
+}
 
 
 /**
@@ -900,34 +1941,159 @@ sv_internal_parse_process_char(sv *t, char c)
  * @t: sv object
  * @buffer: buffer to parse (or NULL)
  * @len: length of @buffer (or 0)
+ * @consumed_p: pointer to store the number of bytes parsed (or NULL)
  *
  * Internal - parse a chunk of data.  NULs in data are ignored.
  *
  * The input data is finished (EOF) if either @buffer is NULL or @len is 0
  *
+ * Parsing stops early, after the byte that ended a row, if the row
+ * set the sv 'pause' flag such as when a callback returned
+ * #SV_STATUS_PAUSE.  It stops at once with #SV_STATUS_STOP when a
+ * callback returns that or after #SV_OPTION_MAX_ROWS data rows.
+ *
  * Return value: #SV_STATUS_OK on success
  */
 sv_status_t
-sv_internal_parse_chunk(sv *t, char *buffer, size_t len)
+sv_internal_parse_chunk(sv *t, char *buffer, size_t len, size_t* consumed_p)
 {
   sv_status_t status = SV_STATUS_OK;
   /* End of input if either of these is NULL */
   int is_end = (!buffer || !len);
+  const char* start = buffer;
+
+  t->pause = 0;
+
+  if(t->stopped) {
+    if(consumed_p)
+      *consumed_p = 0;
+    return SV_STATUS_STOP;
+  }
 
   if(is_end) {
-    status = sv_internal_parse_process_char(t, 0);
+    status = sv_internal_parse_process_char(t, 0, NULL);
+    if(status)
+      goto done;
+
+    /* return the last partial batch; there is no more input so a
+     * pause has no effect
+     */
+    status = sv_parse_callback_status(t, sv_internal_batch_flush(t));
+    if(status)
+      goto done;
+
+    /* and the last filled structs */
+    status = sv_parse_callback_status(t, sv_internal_struct_flush(t));
     if(status)
       goto done;
   } else {
-    while(len--) {
-      char c = *buffer++;
+    /* bytes that end an unquoted cell run; NUL is skipped below */
+    char cell_stops[SV_SCAN_MAX_STOPS];
+    unsigned int cell_nstops = 0;
+
+    /* bytes that end a quoted cell run */
+    char quoted_stops[SV_SCAN_MAX_STOPS];
+    unsigned int quoted_nstops = 0;
+
+    cell_stops[cell_nstops++] = t->field_sep;
+    cell_stops[cell_nstops++] = '\n';
+    cell_stops[cell_nstops++] = '\r';
+    cell_stops[cell_nstops++] = '\0';
+    if(t->escape_char)
+      cell_stops[cell_nstops++] = t->escape_char;
+
+    quoted_stops[quoted_nstops++] = '\0';
+    if(t->quote_char)
+      quoted_stops[quoted_nstops++] = t->quote_char;
+    if(t->escape_char)
+      quoted_stops[quoted_nstops++] = t->escape_char;
+
+    if(t->state == SV_STATE_START_PARSE) {
+      sv_parse_start(t);
+      t->state = SV_STATE_START_FILE;
+    }
+
+    while(len) {
+      char c;
+
+      /* Rows to skip are scanned without being parsed into cells */
+      if(t->skip_rows_remaining > 0) {
+        size_t n = sv_parse_skip_rows(t, buffer, len,
+                                      cell_stops, cell_nstops,
+                                      quoted_stops, quoted_nstops);
+        buffer += n;
+        len -= n;
+        /* the header, if any, is the next row */
+        if(!t->skip_rows_remaining && t->pause_after_prefix &&
+           !(t->flags & SV_FLAGS_SAVE_HEADER))
+          break;
+        continue;
+      }
+
+      /* Fast path: copy a run of plain bytes in an unquoted cell or
+       * of anything but quote, escape or NUL in a quoted cell
+       */
+      if(t->state == SV_STATE_IN_CELL ||
+         t->state == SV_STATE_IN_QUOTED_CELL) {
+        size_t run;
+
+        if(t->state == SV_STATE_IN_CELL)
+          run = sv_internal_scan_run(buffer, len, cell_stops, cell_nstops);
+        else
+          run = sv_internal_scan_run(buffer, len,
+                                     quoted_stops, quoted_nstops);
+        if(run) {
+          status = sv_parse_cell_add_chars(t, buffer, run);
+          if(status)
+            goto done;
+
+          buffer += run;
+          len -= run;
+          continue;
+        }
+      }
+
+      c = *buffer;
       /* Ignore NULs in buffer */
-      if(c && (status = sv_internal_parse_process_char(t, c))) {
+      if(c && (status = sv_internal_parse_process_char(t, c, buffer))) {
         goto done;
       }
+      buffer++;
+      len--;
+
+      if(t->pause)
+        break;
     }
   }
 
 done:
+  if(consumed_p)
+    *consumed_p = is_end ? 0 : (size_t)(buffer - start);
+
+  if(status == SV_STATUS_STOP) {
+    /* return the rows before the stop in any partial batch or structs */
+    sv_status_t flush_status = sv_internal_batch_flush(t);
+
+    if(!flush_status)
+      flush_status = sv_internal_struct_flush(t);
+    if(flush_status && flush_status != SV_STATUS_PAUSE &&
+       flush_status != SV_STATUS_STOP)
+      status = flush_status;
+  }
+
+  /* The chunk is only valid during this call so keep a copy of any
+   * partial row and line
+   */
+  if(t->flags & SV_FLAGS_SPANS) {
+    sv_status_t span_status = sv_parse_flush_spans(t);
+    if(!status)
+      status = span_status;
+  }
+  if(t->line_span) {
+    sv_status_t span_status = sv_line_buffer_flush_span(t);
+    if(!status)
+      status = span_status;
+  }
+
   return status;
 }
@@ -0,0 +1,173 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * scan.c - Scan runs of plain bytes in SV input
+ *
+ * Copyright (C) 2025, Dave Beckett https://www.dajobe.org/
+ *
+ * This package is Free Software
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef SV_CONFIG
+#include <sv_config.h>
+#endif
+
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SV_SCAN_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SV_SCAN_SSE2 1
+#endif
+
+#include <sv.h>
+#include "sv_internal.h"
+
+
+#if defined(SV_SCAN_SSE2) || defined(SV_SCAN_AVX2)
+/* Index of lowest set bit; mask must be non-0 */
+static unsigned int
+sv_scan_first_bit(unsigned int mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned int)__builtin_ctz(mask);
+#else
+  unsigned int i = 0;
+
+  while(!(mask & 1)) {
+    mask >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
+#endif
+
+
+#if !defined(SV_SCAN_SSE2)
+#define SV_SCAN_ONES  ((uint64_t)0x0101010101010101ULL)
+#define SV_SCAN_HIGHS ((uint64_t)0x8080808080808080ULL)
+
+/* Non-0 if any byte of w is 0 */
+#define SV_SCAN_HAS_ZERO(w) (((w) - SV_SCAN_ONES) & ~(w) & SV_SCAN_HIGHS)
+#endif
+
+
+/**
+ * sv_internal_scan_run:
+ * @buffer: bytes to scan
+ * @len: length of @buffer
+ * @stops: bytes that end the run
+ * @nstops: number of @stops (1..#SV_SCAN_MAX_STOPS)
+ *
+ * INTERNAL - Find the length of the run of bytes at the start of
+ * @buffer that contains none of the @stops bytes.
+ *
+ * Uses AVX2 (32 bytes) or SSE2 (16 bytes) compares when the compiler
+ * targets them, otherwise 8 bytes at a time in a 64 bit word.
+ *
+ * Return value: offset of the first stop byte or @len if there is none
+ */
+size_t
+sv_internal_scan_run(const char* buffer, size_t len,
+                     const char* stops, unsigned int nstops)
+{
+  size_t i = 0;
+  unsigned int k;
+
+#ifdef SV_SCAN_AVX2
+  if(len >= 32) {
+    __m256i needles[SV_SCAN_MAX_STOPS];
+
+    for(k = 0; k < nstops; k++)
+      needles[k] = _mm256_set1_epi8(stops[k]);
+
+    for(; i + 32 <= len; i += 32) {
+      __m256i bytes = _mm256_loadu_si256((const __m256i*)(buffer + i));
+      __m256i hits = _mm256_cmpeq_epi8(bytes, needles[0]);
+      unsigned int mask;
+
+      for(k = 1; k < nstops; k++)
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(bytes, needles[k]));
+
+      mask = (unsigned int)_mm256_movemask_epi8(hits);
+      if(mask)
+        return i + sv_scan_first_bit(mask);
+    }
+  }
+#endif
+
+#ifdef SV_SCAN_SSE2
+  if(len - i >= 16) {
+    __m128i needles[SV_SCAN_MAX_STOPS];
+
+    for(k = 0; k < nstops; k++)
+      needles[k] = _mm_set1_epi8(stops[k]);
+
+    for(; i + 16 <= len; i += 16) {
+      __m128i bytes = _mm_loadu_si128((const __m128i*)(buffer + i));
+      __m128i hits = _mm_cmpeq_epi8(bytes, needles[0]);
+      unsigned int mask;
+
+      for(k = 1; k < nstops; k++)
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, needles[k]));
+
+      mask = (unsigned int)_mm_movemask_epi8(hits);
+      if(mask)
+        return i + sv_scan_first_bit(mask);
+    }
+  }
+#else
+  if(len - i >= 8) {
+    uint64_t needles[SV_SCAN_MAX_STOPS];
+
+    for(k = 0; k < nstops; k++)
+      needles[k] = SV_SCAN_ONES * (unsigned char)stops[k];
+
+    for(; i + 8 <= len; i += 8) {
+      uint64_t word;
+      uint64_t hit = 0;
+
+      memcpy(&word, buffer + i, sizeof(word));
+      for(k = 0; k < nstops; k++) {
+        uint64_t x = word ^ needles[k];
+        hit |= SV_SCAN_HAS_ZERO(x);
+      }
+      if(hit)
+        break;
+    }
+  }
+#endif
+
+  /* Tail and (without SIMD) the word that had a hit */
+  for(; i < len; i++) {
+    const char c = buffer[i];
+
+    for(k = 0; k < nstops; k++) {
+      if(c == stops[k])
+        return i;
+    }
+  }
+
+  return len;
+}
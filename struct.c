@@ -0,0 +1,491 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * struct.c - Decode data rows into caller structs
+ *
+ * Copyright (C) 2025, Dave Beckett https://www.dajobe.org/
+ *
+ * This package is Free Software
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef SV_CONFIG
+#include <sv_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <sv.h>
+#include "sv_internal.h"
+
+
+/* Non-0 if @size is the size of a signed integer member */
+static int
+sv_struct_int_size(size_t size)
+{
+  return size == 1 || size == 2 || size == 4 || size == 8;
+}
+
+
+/* Free the copied schema */
+static void
+sv_struct_free_schema(sv* t)
+{
+  unsigned int i;
+
+  if(t->struct_fields) {
+    for(i = 0; i < t->struct_fields_count; i++) {
+      if(t->struct_fields[i].name)
+        free((char*)t->struct_fields[i].name);
+    }
+    free(t->struct_fields);
+    t->struct_fields = NULL;
+  }
+  if(t->struct_columns) {
+    free(t->struct_columns);
+    t->struct_columns = NULL;
+  }
+  t->struct_fields_count = 0;
+  t->struct_string_count = 0;
+  t->struct_record_size = 0;
+  t->struct_resolved = 0;
+}
+
+
+/**
+ * sv_internal_struct_set_schema:
+ * @t: sv object
+ * @fields: array of struct fields (or NULL)
+ * @count: number of @fields
+ * @record_size: size of one struct
+ *
+ * INTERNAL - Set the struct schema, copying @fields
+ *
+ * Return value: non-0 on failure or if a field does not fit its type
+ * or the struct
+ */
+sv_status_t
+sv_internal_struct_set_schema(sv* t, const sv_struct_field* fields,
+                              unsigned int count, size_t record_size)
+{
+  unsigned int i;
+
+  sv_struct_free_schema(t);
+  if(!fields || !count)
+    return SV_STATUS_OK;
+
+  for(i = 0; i < count; i++) {
+    const sv_struct_field* f = &fields[i];
+    int valid;
+
+    switch(f->type) {
+      case SV_STRUCT_TYPE_INT:
+      case SV_STRUCT_TYPE_BOOL:
+        valid = sv_struct_int_size(f->size);
+        break;
+      case SV_STRUCT_TYPE_FLOAT:
+        valid = (f->size == sizeof(float) || f->size == sizeof(double));
+        break;
+      case SV_STRUCT_TYPE_EPOCH_NS:
+        valid = (f->size == sizeof(int64_t));
+        break;
+      case SV_STRUCT_TYPE_CHARS:
+        valid = (f->size > 0);
+        break;
+      case SV_STRUCT_TYPE_STRING:
+        valid = (f->size == sizeof(sv_string_view));
+        break;
+      default:
+        valid = 0;
+        break;
+    }
+    if(!valid || (!f->name && f->column < 0) || f->offset > record_size ||
+       f->size > record_size - f->offset)
+      return SV_STATUS_FAILED;
+  }
+
+  t->struct_fields = (sv_struct_field*)calloc(count, sizeof(sv_struct_field));
+  t->struct_columns = (int*)malloc(sizeof(int) * count);
+  if(!t->struct_fields || !t->struct_columns) {
+    sv_struct_free_schema(t);
+    return SV_STATUS_NO_MEMORY;
+  }
+  t->struct_fields_count = count;
+
+  for(i = 0; i < count; i++) {
+    t->struct_fields[i] = fields[i];
+    if(fields[i].name) {
+      size_t len = strlen(fields[i].name);
+      char* name = (char*)malloc(len + 1);
+
+      if(!name) {
+        t->struct_fields[i].name = NULL;
+        sv_struct_free_schema(t);
+        return SV_STATUS_NO_MEMORY;
+      }
+      memcpy(name, fields[i].name, len + 1);
+      t->struct_fields[i].name = name;
+    }
+    if(fields[i].type == SV_STRUCT_TYPE_STRING)
+      t->struct_string_count++;
+  }
+  t->struct_record_size = record_size;
+
+  return SV_STATUS_OK;
+}
+
+
+/* Find the source column of each schema field from its index or its
+ * name in the saved header
+ */
+static void
+sv_struct_resolve(sv* t)
+{
+  unsigned int i, h;
+
+  for(i = 0; i < t->struct_fields_count; i++) {
+    const sv_struct_field* f = &t->struct_fields[i];
+
+    t->struct_columns[i] = f->name ? -1 : f->column;
+    if(!f->name)
+      continue;
+
+    for(h = 0; h < t->headers_count; h++) {
+      if(!strcmp(t->headers[h], f->name)) {
+        t->struct_columns[i] = (int)h;
+        break;
+      }
+    }
+  }
+  t->struct_resolved = 1;
+}
+
+
+/* Store integer @value in the @size byte member at @p; non-0 if it
+ * does not fit
+ */
+static int
+sv_struct_store_int(char* p, size_t size, int64_t value)
+{
+  int8_t v8;
+  int16_t v16;
+  int32_t v32;
+
+  switch(size) {
+    case 1:
+      if(value < INT8_MIN || value > INT8_MAX)
+        return 1;
+      v8 = (int8_t)value;
+      memcpy(p, &v8, sizeof(v8));
+      break;
+    case 2:
+      if(value < INT16_MIN || value > INT16_MAX)
+        return 1;
+      v16 = (int16_t)value;
+      memcpy(p, &v16, sizeof(v16));
+      break;
+    case 4:
+      if(value < INT32_MIN || value > INT32_MAX)
+        return 1;
+      v32 = (int32_t)value;
+      memcpy(p, &v32, sizeof(v32));
+      break;
+    default:
+      memcpy(p, &value, sizeof(value));
+      break;
+  }
+  return 0;
+}
+
+
+/* Append @len bytes of @s to the string view bytes; sets *@offset_p to
+ * where they start
+ */
+static sv_status_t
+sv_struct_add_string(sv* t, const char* s, size_t len, size_t* offset_p)
+{
+  /* allocated even for empty strings so that they are not NULL */
+  if(!t->struct_strings ||
+     t->struct_strings_len + len > t->struct_strings_size) {
+    size_t nsize = t->struct_strings_size ? t->struct_strings_size * 2 : 1024;
+    char* nstrings;
+
+    while(nsize < t->struct_strings_len + len)
+      nsize *= 2;
+    nstrings = (char*)realloc(t->struct_strings, nsize);
+    if(!nstrings)
+      return SV_STATUS_NO_MEMORY;
+    t->struct_strings = nstrings;
+    t->struct_strings_size = nsize;
+  }
+
+  *offset_p = t->struct_strings_len;
+  if(len)
+    memcpy(t->struct_strings + t->struct_strings_len, s, len);
+  t->struct_strings_len += len;
+
+  return SV_STATUS_OK;
+}
+
+
+/**
+ * sv_internal_struct_add_row:
+ * @t: sv object
+ * @fields: row fields
+ * @widths: row field widths
+ * @count: number of fields
+ *
+ * INTERNAL - Convert a data row into the next record and return the
+ * records to the struct callback if they are full
+ *
+ * A NULL field or a column the row does not have sets the member to 0,
+ * an empty string or a NULL string view.  So does a field that cannot
+ * be converted, which is an error with #SV_OPTION_BAD_DATA_ERROR.
+ *
+ * Return value: non-0 on failure
+ */
+sv_status_t
+sv_internal_struct_add_row(sv* t, char** fields, size_t* widths,
+                           size_t count)
+{
+  char* record;
+  size_t* string_offsets = NULL;
+  size_t strings_len = t->struct_strings_len;
+  int bad = 0;
+  unsigned int i;
+
+  if(!t->struct_resolved)
+    sv_struct_resolve(t);
+
+  if(t->struct_string_count) {
+    size_t n = t->struct_capacity * t->struct_string_count;
+
+    if(n > t->struct_string_offsets_size) {
+      size_t* noffsets;
+
+      noffsets = (size_t*)realloc(t->struct_string_offsets,
+                                  sizeof(size_t) * n);
+      if(!noffsets)
+        return SV_STATUS_NO_MEMORY;
+      t->struct_string_offsets = noffsets;
+      t->struct_string_offsets_size = n;
+    }
+    string_offsets = t->struct_string_offsets +
+      t->struct_rows * t->struct_string_count;
+  }
+
+  record = (char*)t->struct_records + t->struct_rows * t->struct_record_size;
+
+  for(i = 0; i < t->struct_fields_count; i++) {
+    const sv_struct_field* f = &t->struct_fields[i];
+    char* p = record + f->offset;
+    int column = t->struct_columns[i];
+    const char* field = NULL;
+    size_t width = 0;
+    int failed = 0;
+
+    if(column >= 0 && (size_t)column < count && fields[column]) {
+      field = fields[column];
+      width = widths[column];
+    }
+
+    switch(f->type) {
+      case SV_STRUCT_TYPE_INT:
+      case SV_STRUCT_TYPE_EPOCH_NS:
+      case SV_STRUCT_TYPE_BOOL:
+        if(1) {
+          int64_t value = 0;
+
+          if(field) {
+            if(f->type == SV_STRUCT_TYPE_INT)
+              failed = (int)sv_field_to_int64(field, width, &value);
+            else if(f->type == SV_STRUCT_TYPE_EPOCH_NS)
+              failed = (int)sv_field_to_epoch_ns(field, width, &value);
+            else {
+              int b = 0;
+
+              failed = (int)sv_internal_field_to_bool(field, width, &b);
+              value = b;
+            }
+          }
+          if(failed || sv_struct_store_int(p, f->size, value)) {
+            failed = 1;
+            sv_struct_store_int(p, f->size, 0);
+          }
+        }
+        break;
+
+      case SV_STRUCT_TYPE_FLOAT:
+        if(1) {
+          double value = 0.0;
+
+          if(field && sv_field_to_double(field, width, &value)) {
+            failed = 1;
+            value = 0.0;
+          }
+          if(f->size == sizeof(float)) {
+            float fvalue = (float)value;
+
+            memcpy(p, &fvalue, sizeof(fvalue));
+          } else
+            memcpy(p, &value, sizeof(double));
+        }
+        break;
+
+      case SV_STRUCT_TYPE_CHARS:
+        if(width > f->size - 1)
+          width = f->size - 1;
+        if(width)
+          memcpy(p, field, width);
+        p[width] = '\0';
+        break;
+
+      case SV_STRUCT_TYPE_STRING:
+        if(1) {
+          sv_string_view view;
+          size_t offset = SV_NO_OFFSET;
+
+          /* data is set when the records are returned since the
+           * string bytes may move until then
+           */
+          if(field) {
+            sv_status_t status = sv_struct_add_string(t, field, width,
+                                                      &offset);
+            if(status)
+              return status;
+          }
+          *string_offsets++ = offset;
+          view.data = NULL;
+          view.len = width;
+          memcpy(p, &view, sizeof(view));
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    if(failed)
+      bad = 1;
+  }
+
+  if(bad && (t->flags & SV_FLAGS_BAD_DATA_ERROR)) {
+    /* drop the record so its slot and strings are reused */
+    t->struct_strings_len = strings_len;
+    return SV_STATUS_FAILED;
+  }
+
+  t->struct_rows++;
+
+  if(t->struct_rows >= t->struct_capacity)
+    return sv_internal_struct_flush(t);
+
+  return SV_STATUS_OK;
+}
+
+
+/**
+ * sv_internal_struct_flush:
+ * @t: sv object
+ *
+ * INTERNAL - Return any filled records to the struct callback and
+ * start filling from the first record again
+ *
+ * Return value: status of the struct callback
+ */
+sv_status_t
+sv_internal_struct_flush(sv* t)
+{
+  sv_status_t status = SV_STATUS_OK;
+
+  if(!t->struct_rows)
+    return SV_STATUS_OK;
+
+  if(t->struct_string_count) {
+    const size_t* offset = t->struct_string_offsets;
+    size_t r;
+    unsigned int i;
+
+    for(r = 0; r < t->struct_rows; r++) {
+      char* record = (char*)t->struct_records + r * t->struct_record_size;
+
+      for(i = 0; i < t->struct_fields_count; i++) {
+        const sv_struct_field* f = &t->struct_fields[i];
+        sv_string_view view;
+
+        if(f->type != SV_STRUCT_TYPE_STRING)
+          continue;
+        memcpy(&view, record + f->offset, sizeof(view));
+        view.data = (*offset == SV_NO_OFFSET) ? NULL :
+          t->struct_strings + *offset;
+        memcpy(record + f->offset, &view, sizeof(view));
+        offset++;
+      }
+    }
+  }
+
+  if(t->struct_callback)
+    status = t->struct_callback(t, t->callback_user_data, t->struct_records,
+                                t->struct_rows);
+
+  sv_internal_struct_reset(t);
+
+  return status;
+}
+
+
+/**
+ * sv_internal_struct_reset:
+ * @t: sv object
+ *
+ * INTERNAL - Discard the filled records keeping the string buffer
+ * allocated
+ */
+void
+sv_internal_struct_reset(sv* t)
+{
+  t->struct_rows = 0;
+  t->struct_strings_len = 0;
+}
+
+
+/**
+ * sv_internal_struct_free:
+ * @t: sv object
+ *
+ * INTERNAL - Free the schema and string buffers
+ */
+void
+sv_internal_struct_free(sv* t)
+{
+  sv_struct_free_schema(t);
+
+  if(t->struct_strings) {
+    free(t->struct_strings);
+    t->struct_strings = NULL;
+  }
+  t->struct_strings_size = 0;
+
+  if(t->struct_string_offsets) {
+    free(t->struct_string_offsets);
+    t->struct_string_offsets = NULL;
+  }
+  t->struct_string_offsets_size = 0;
+
+  sv_internal_struct_reset(t);
+}
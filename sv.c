@@ -69,6 +69,7 @@ sv_new(void *user_data, sv_fields_callback header_callback,
   t->flags = SV_FLAGS_SAVE_HEADER | SV_FLAGS_QUOTED_FIELDS;
   sv_internal_set_quote_char(t, '"');
   t->escape_char = '\0';
+  sv_internal_update_char_classes(t);
   t->skip_rows = 0;
   t->comment_prefix = NULL;
 
@@ -79,6 +80,12 @@ sv_new(void *user_data, sv_fields_callback header_callback,
 
   t->field_size_limit = 128 * 1024; /* 128KB */
 
+  t->thread_index = -1;
+
+  t->batch_size = SV_BATCH_DEFAULT_SIZE;
+
+  t->source_fd = -1;
+
   sv_reset(t);
 
   return t;
@@ -114,6 +121,11 @@ sv_free(sv *t)
 
   sv_internal_parse_reset(t);
   sv_internal_free_line_buffer(t);
+  sv_internal_free_fields(t);
+  sv_internal_free_select(t);
+  sv_internal_batch_free(t);
+  sv_internal_struct_free(t);
+  sv_internal_pull_free(t);
 
   if(t->comment_prefix)
     free(t->comment_prefix);
@@ -141,6 +153,25 @@ sv_get_line(sv *t)
 }
 
 
+/**
+ * sv_get_thread_index:
+ * @t: sv object
+ *
+ * Get the index of the thread parsing with @t in sv_parse_file_parallel()
+ *
+ * Return value: thread index from 0 or <0 if @t is not being used
+ * by sv_parse_file_parallel()
+ */
+int
+sv_get_thread_index(sv *t)
+{
+  if(!t)
+    return -1;
+
+  return t->thread_index;
+}
+
+
 /**
  * sv_get_header:
  * @t: sv object
@@ -177,14 +208,66 @@ sv_get_header(sv *t, unsigned int i, size_t *width_p)
  * Parse a chunk of data
  *
  * The input data is finished (EOF) if either @buffer is NULL or @len
- * is 0.  NULs in the data are ignored.
+ * is 0.  NULs in the data are ignored.  All of @buffer is parsed even
+ * if a callback returns #SV_STATUS_PAUSE.
+ *
+ * When a callback returns #SV_STATUS_STOP or #SV_OPTION_MAX_ROWS data
+ * rows have been returned, parsing ends at once and this and all
+ * later calls until sv_reset() return #SV_STATUS_STOP.
  *
  * Return value: #SV_STATUS_OK on success
  */
 sv_status_t
 sv_parse_chunk(sv *t, char *buffer, size_t len)
 {
-  return sv_internal_parse_chunk(t, buffer, len);
+  while(1) {
+    size_t consumed = 0;
+    sv_status_t status;
+
+    status = sv_internal_parse_chunk(t, buffer, len, &consumed);
+    if(status || !t->pause || consumed >= len)
+      return status;
+
+    buffer += consumed;
+    len -= consumed;
+  }
+}
+
+
+/**
+ * sv_parse_chunk_partial:
+ * @t: sv object
+ * @buffer: buffer to parse (or NULL)
+ * @len: length of @buffer (or 0)
+ * @consumed_p: pointer to store the number of bytes of @buffer parsed (or NULL)
+ *
+ * Parse a chunk of data stopping after a row if a callback pauses
+ *
+ * As sv_parse_chunk() but when a header, data, line, comment, batch
+ * or struct callback returns #SV_STATUS_PAUSE, parsing stops after
+ * the byte that ended that row.  The bytes of @buffer from
+ * *@consumed_p on have not been parsed and must be passed in the next
+ * call to resume; the bytes before them may be reused.  A pause at
+ * the end of input has no effect.
+ *
+ * Return value: #SV_STATUS_PAUSE if a callback paused, #SV_STATUS_OK
+ * if all of @buffer was parsed, #SV_STATUS_STOP if parsing was
+ * stopped or an error code
+ */
+sv_status_t
+sv_parse_chunk_partial(sv *t, char *buffer, size_t len, size_t *consumed_p)
+{
+  size_t consumed = 0;
+  sv_status_t status;
+
+  status = sv_internal_parse_chunk(t, buffer, len, &consumed);
+  if(consumed_p)
+    *consumed_p = consumed;
+
+  if(!status && t->pause && buffer && len)
+    status = SV_STATUS_PAUSE;
+
+  return status;
 }
 
 /**
@@ -197,4 +280,34 @@ sv_internal_set_quote_char(sv *t, char quote_char)
   t->quote_char = quote_char;
   if(quote_char == '"')
     t->flags |= SV_FLAGS_DOUBLE_QUOTE;
+  sv_internal_update_char_classes(t);
+}
+
+
+/**
+ * INTERNAL - rebuild the character class table from the separator,
+ * quote and escape chars and the whitespace stripping flag.  When
+ * built with SV_DFA also rebuild the parser's DFA table.
+ */
+void
+sv_internal_update_char_classes(sv *t)
+{
+  memset(t->char_class, '\0', sizeof(t->char_class));
+
+  t->char_class[(unsigned char)'\n'] |= SV_CLASS_EOL;
+  t->char_class[(unsigned char)'\r'] |= SV_CLASS_EOL;
+  t->char_class[0] |= SV_CLASS_EOL | SV_CLASS_NUL;
+  t->char_class[(unsigned char)t->field_sep] |= SV_CLASS_SEP;
+  if(t->quote_char)
+    t->char_class[(unsigned char)t->quote_char] |= SV_CLASS_QUOTE;
+  if(t->escape_char)
+    t->char_class[(unsigned char)t->escape_char] |= SV_CLASS_ESCAPE;
+  if(t->flags & SV_FLAGS_STRIP_WHITESPACE) {
+    t->char_class[(unsigned char)' '] |= SV_CLASS_SPACE;
+    t->char_class[(unsigned char)'\t'] |= SV_CLASS_SPACE;
+  }
+
+#ifdef SV_DFA
+  sv_internal_parse_update_dfa(t);
+#endif
 }
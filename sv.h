@@ -21,6 +21,7 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
 
 /**
  * sv_status_t:
@@ -28,6 +29,10 @@
  * @SV_STATUS_FAILED: Failure
  * @SV_STATUS_NO_MEMORY: Out of memory
  * @SV_STATUS_LINE_FIELDS: Line had wrong number of fields
+ * @SV_STATUS_FIELD_TOO_LARGE: Field was larger than #SV_OPTION_FIELD_SIZE_LIMIT
+ * @SV_STATUS_END: No more rows from sv_next_row()
+ * @SV_STATUS_PAUSE: Returned by a callback to pause sv_parse_chunk_partial() after this row
+ * @SV_STATUS_STOP: Returned by a callback to stop parsing at once; returned by parsing after the stop or #SV_OPTION_MAX_ROWS rows
  *
  * Status / errors
 */
@@ -36,7 +41,10 @@ typedef enum {
   SV_STATUS_FAILED,
   SV_STATUS_NO_MEMORY,
   SV_STATUS_LINE_FIELDS,
-  SV_STATUS_FIELD_TOO_LARGE
+  SV_STATUS_FIELD_TOO_LARGE,
+  SV_STATUS_END,
+  SV_STATUS_PAUSE,
+  SV_STATUS_STOP
 } sv_status_t;
 
 typedef struct sv_s sv;
@@ -64,10 +72,141 @@ typedef sv_status_t (*sv_fields_callback)(sv *t, void *user_data, char** fields,
  *
  * Callback function for lines set via sv_set_option() with #SV_OPTION_LINE_CALLBACK
  *
+ * @line is NUL terminated and only valid during the callback.  With
+ * #SV_OPTION_ZERO_COPY it may instead point into the buffer passed to
+ * sv_parse_chunk() without NUL termination.
+ *
  * Return value: #SV_STATUS_OK or error code
  */
 typedef sv_status_t (*sv_line_callback)(sv *t, void *user_data, const char* line, size_t length);
 
+/**
+ * @sv_read_callback:
+ * @t: sv object
+ * @user_data: user data
+ * @buffer: buffer to read into
+ * @size: size of @buffer
+ * @len_p: pointer to store the number of bytes read; 0 at end of input
+ *
+ * Callback function reading input for sv_next_row() set via
+ * sv_set_option() with #SV_OPTION_SOURCE_CALLBACK
+ *
+ * Return value: #SV_STATUS_OK or error code
+ */
+typedef sv_status_t (*sv_read_callback)(sv *t, void *user_data, char* buffer, size_t size, size_t* len_p);
+
+/**
+ * sv_batch_column:
+ * @data: bytes of all values in the column, not NUL terminated
+ * @offsets: value i is bytes @offsets[i] to @offsets[i+1] of @data; rows + 1 of them
+ * @validity: bitmap with bit (i % 8) of byte (i / 8) set if value i is not NULL
+ * @null_count: number of NULL values
+ *
+ * One column of a #sv_batch
+ */
+typedef struct {
+  char* data;
+  size_t* offsets;
+  unsigned char* validity;
+  size_t null_count;
+} sv_batch_column;
+
+/**
+ * sv_batch:
+ * @rows: number of rows
+ * @columns: number of columns
+ * @column: array of @columns columns
+ *
+ * Columnar batch of data rows returned to a #sv_batch_callback
+ *
+ * A field that is NULL with #SV_OPTION_NULL_HANDLING or a column
+ * that a row does not have is NULL.
+ */
+typedef struct {
+  size_t rows;
+  size_t columns;
+  sv_batch_column* column;
+} sv_batch;
+
+/**
+ * @sv_batch_callback:
+ * @t: sv object
+ * @user_data: user data
+ * @batch: batch of rows
+ *
+ * Callback function for batches set via sv_set_option() with #SV_OPTION_BATCH_CALLBACK
+ *
+ * @batch is only valid during the callback.
+ *
+ * Return value: #SV_STATUS_OK or error code
+ */
+typedef sv_status_t (*sv_batch_callback)(sv *t, void *user_data, sv_batch* batch);
+
+/**
+ * sv_struct_type:
+ * @SV_STRUCT_TYPE_INT: signed integer of size 1, 2, 4 or 8 bytes
+ * @SV_STRUCT_TYPE_FLOAT: float or double (size 4 or 8)
+ * @SV_STRUCT_TYPE_BOOL: signed integer of size 1, 2, 4 or 8 set to 1 for true or 0 for false
+ * @SV_STRUCT_TYPE_EPOCH_NS: int64_t nanoseconds since the epoch from an ISO 8601 timestamp
+ * @SV_STRUCT_TYPE_CHARS: char array of size bytes, NUL terminated and truncated to fit
+ * @SV_STRUCT_TYPE_STRING: #sv_string_view
+ *
+ * Type of a struct member filled from a field
+ */
+typedef enum {
+  SV_STRUCT_TYPE_INT,
+  SV_STRUCT_TYPE_FLOAT,
+  SV_STRUCT_TYPE_BOOL,
+  SV_STRUCT_TYPE_EPOCH_NS,
+  SV_STRUCT_TYPE_CHARS,
+  SV_STRUCT_TYPE_STRING
+} sv_struct_type;
+
+/**
+ * sv_string_view:
+ * @data: bytes, not NUL terminated, or NULL for a NULL field
+ * @len: number of bytes
+ *
+ * Struct member for #SV_STRUCT_TYPE_STRING; @data is only valid during
+ * the #sv_struct_callback
+ */
+typedef struct {
+  const char* data;
+  size_t len;
+} sv_string_view;
+
+/**
+ * sv_struct_field:
+ * @name: header name of the column or NULL to use @column
+ * @column: 0-based column index when @name is NULL
+ * @type: member type
+ * @offset: offsetof() the member in the struct
+ * @size: sizeof() the member
+ *
+ * Schema entry mapping a column to a struct member for
+ * #SV_OPTION_STRUCT_SCHEMA
+ */
+typedef struct {
+  const char* name;
+  int column;
+  sv_struct_type type;
+  size_t offset;
+  size_t size;
+} sv_struct_field;
+
+/**
+ * @sv_struct_callback:
+ * @t: sv object
+ * @user_data: user data
+ * @records: array of structs given to #SV_OPTION_STRUCT_CALLBACK
+ * @count: number of filled structs in @records
+ *
+ * Callback function for filled structs set via sv_set_option() with #SV_OPTION_STRUCT_CALLBACK
+ *
+ * Return value: #SV_STATUS_OK or error code
+ */
+typedef sv_status_t (*sv_struct_callback)(sv *t, void *user_data, void* records, size_t count);
+
 
 /**
  * sv_option_t:
@@ -86,6 +225,18 @@ typedef sv_status_t (*sv_line_callback)(sv *t, void *user_data, const char* line
  * @SV_OPTION_COMMENT_CALLBACK: Set comment callback of type #sv_line_callback
  * @SV_OPTION_NULL_HANDLING: enable null handling to return NULL pointers for missing data; type long
  * @SV_OPTION_NULL_VALUES: set array of strings that represent null values; type char** array, count
+ * @SV_OPTION_FIELD_SIZE_LIMIT: set the maximum size of a field in bytes or 0 for no limit; type size_t
+ * @SV_OPTION_ZERO_COPY: return fields, lines and comments pointing into the buffer given to sv_parse_chunk() where possible, without NUL termination; type long
+ * @SV_OPTION_SELECT_COLUMNS: return only these columns, in this order; type int* array of 0-based column indexes, int count.  NULL or 0 returns all columns
+ * @SV_OPTION_SELECT_COLUMN_NAMES: return only the columns with these header names, in this order; type char** array, int count.  Requires #SV_OPTION_SAVE_HEADER; names not in the header return missing fields
+ * @SV_OPTION_BATCH_CALLBACK: return data rows in columnar batches to this callback instead of the data callback; NULL returns rows to the data callback; type #sv_batch_callback
+ * @SV_OPTION_BATCH_SIZE: set the maximum number of rows in a batch (default 1024); type long
+ * @SV_OPTION_STRUCT_SCHEMA: set the struct members filled from each data row; type #sv_struct_field* array, int count, size_t struct size.  Names require #SV_OPTION_SAVE_HEADER
+ * @SV_OPTION_STRUCT_CALLBACK: fill structs from data rows using the #SV_OPTION_STRUCT_SCHEMA and return them to this callback when full and at the end, instead of the data or batch callback; type #sv_struct_callback, void* array of structs, size_t number of structs.  NULL returns rows to the data callback
+ * @SV_OPTION_SOURCE_FD: read input for sv_next_row() from this file descriptor starting at its current offset, mapping the rest of a regular file into memory; type int.  The descriptor is not closed
+ * @SV_OPTION_SOURCE_BUFFER: read input for sv_next_row() from this memory such as a mapped file; type char* data, size_t length.  The memory must be valid until the last row is returned
+ * @SV_OPTION_SOURCE_CALLBACK: read input for sv_next_row() with this callback; type #sv_read_callback
+ * @SV_OPTION_MAX_ROWS: stop parsing after this many data rows or 0 for no limit (default); type long
  *
  * Option type
  */
@@ -104,9 +255,121 @@ typedef enum {
   SV_OPTION_COMMENT_CALLBACK,
   SV_OPTION_NULL_HANDLING,
   SV_OPTION_NULL_VALUES,
-  SV_OPTION_FIELD_SIZE_LIMIT
+  SV_OPTION_FIELD_SIZE_LIMIT,
+  SV_OPTION_ZERO_COPY,
+  SV_OPTION_SELECT_COLUMNS,
+  SV_OPTION_SELECT_COLUMN_NAMES,
+  SV_OPTION_BATCH_CALLBACK,
+  SV_OPTION_BATCH_SIZE,
+  SV_OPTION_STRUCT_SCHEMA,
+  SV_OPTION_STRUCT_CALLBACK,
+  SV_OPTION_SOURCE_FD,
+  SV_OPTION_SOURCE_BUFFER,
+  SV_OPTION_SOURCE_CALLBACK,
+  SV_OPTION_MAX_ROWS
 } sv_option_t;
 
+/**
+ * sv_record_counts:
+ * @records: number of records
+ * @min_fields: smallest number of fields in a record
+ * @max_fields: largest number of fields in a record
+ * @bad_records: number of records with malformed quoting
+ * @bad_offset: offset of the first malformed byte or #SV_COUNT_NO_OFFSET
+ *
+ * Record counts returned by sv_count_records()
+ */
+typedef struct {
+  size_t records;
+  size_t min_fields;
+  size_t max_fields;
+  size_t bad_records;
+  size_t bad_offset;
+} sv_record_counts;
+
+/**
+ * SV_COUNT_NO_OFFSET:
+ *
+ * #sv_record_counts bad_offset value when no malformed quoting was seen
+ */
+#define SV_COUNT_NO_OFFSET ((size_t)-1)
+
+/**
+ * sv_table:
+ *
+ * Table builder: columns in the Arrow columnar format built from
+ * parsed rows
+ */
+typedef struct sv_table_s sv_table;
+
+/**
+ * sv_writer:
+ *
+ * Writer of rows to a file handle through an output buffer
+ */
+typedef struct sv_writer_s sv_writer;
+
+/**
+ * sv_table_type:
+ * @SV_TABLE_TYPE_STRING: string (Arrow utf8 or large_utf8)
+ * @SV_TABLE_TYPE_INT64: 64 bit signed integer (Arrow int64)
+ * @SV_TABLE_TYPE_FLOAT64: double (Arrow float64)
+ * @SV_TABLE_TYPE_BOOL: true or false (Arrow bool)
+ *
+ * Type of a #sv_table column
+ */
+typedef enum {
+  SV_TABLE_TYPE_STRING,
+  SV_TABLE_TYPE_INT64,
+  SV_TABLE_TYPE_FLOAT64,
+  SV_TABLE_TYPE_BOOL
+} sv_table_type;
+
+/* Arrow C data interface
+ * https://arrow.apache.org/docs/format/CDataInterface.html
+ */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  /* Array type description */
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+
+  /* Release callback */
+  void (*release)(struct ArrowSchema*);
+  /* Opaque producer-specific data */
+  void* private_data;
+};
+
+struct ArrowArray {
+  /* Array data description */
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+
+  /* Release callback */
+  void (*release)(struct ArrowArray*);
+  /* Opaque producer-specific data */
+  void* private_data;
+};
+
+#endif  /* ARROW_C_DATA_INTERFACE */
+
 sv* sv_new(void *user_data, sv_fields_callback header_callback, sv_fields_callback data_callback, char field_sep);
 void sv_free(sv *t);
 
@@ -120,4 +383,40 @@ const char* sv_get_header(sv *t, unsigned int i, size_t *width_p);
 
 sv_status_t sv_parse_chunk(sv *t, char *buffer, size_t len);
 
+sv_status_t sv_parse_chunk_partial(sv *t, char *buffer, size_t len, size_t *consumed_p);
+
+sv_status_t sv_parse_file(sv *t, const char *path);
+
+sv_status_t sv_parse_fd(sv *t, int fd);
+
+sv_status_t sv_parse_file_parallel(sv *t, const char *path, int nthreads, int ordered);
+
+int sv_get_thread_index(sv *t);
+
+sv_status_t sv_next_row(sv *t, char*** fields_p, size_t** widths_p, size_t* count_p);
+
+sv_status_t sv_count_records(sv *t, const char *data, size_t len, sv_record_counts *counts);
+
+sv_status_t sv_field_to_int64(const char* field, size_t len, int64_t* value_p);
+sv_status_t sv_fields_to_int64(char** fields, size_t *widths, size_t count, int64_t* values, unsigned char* ok);
+sv_status_t sv_field_to_double(const char* field, size_t len, double* value_p);
+sv_status_t sv_fields_to_double(char** fields, size_t *widths, size_t count, double* values, unsigned char* ok);
+sv_status_t sv_field_to_epoch_ns(const char* field, size_t len, int64_t* value_p);
+sv_status_t sv_fields_to_epoch_ns(char** fields, size_t *widths, size_t count, int64_t* values, unsigned char* ok);
+
+sv_table* sv_table_new(int offset_size);
+void sv_table_free(sv_table* table);
+sv_status_t sv_table_add_row(sv_table* table, sv *t, char** fields, size_t *widths, size_t count);
+sv_status_t sv_table_data_callback(sv *t, void *user_data, char** fields, size_t *widths, size_t count);
+size_t sv_table_get_rows(sv_table* table);
+size_t sv_table_get_columns(sv_table* table);
+sv_status_t sv_table_set_infer_rows(sv_table* table, size_t rows);
+sv_table_type sv_table_get_column_type(sv_table* table, size_t column);
+sv_status_t sv_table_export(sv_table* table, struct ArrowArray* array, struct ArrowSchema* schema);
+
 sv_status_t sv_write_fields(sv *t, FILE* fh, char** fields, size_t *widths, size_t count);
+
+sv_writer* sv_writer_new(sv *t, FILE* fh, size_t buffer_size);
+sv_status_t sv_writer_write_fields(sv_writer* w, char** fields, size_t *widths, size_t count);
+sv_status_t sv_writer_flush(sv_writer* w);
+sv_status_t sv_writer_close(sv_writer* w);
@@ -34,6 +34,29 @@
 /* double a quote to quote it (primarily for ") */
 #define SV_FLAGS_DOUBLE_QUOTE      (1<<4)
 #define SV_FLAGS_NULL_HANDLING     (1<<5)
+/* return fields pointing into the input chunk where possible */
+#define SV_FLAGS_ZERO_COPY         (1<<6)
+/* fields are only converted into structs so may point into the input */
+#define SV_FLAGS_STRUCT_SPANS      (1<<7)
+/* fields point into the input chunk where possible */
+#define SV_FLAGS_SPANS (SV_FLAGS_ZERO_COPY | SV_FLAGS_STRUCT_SPANS)
+
+/* character class bits in sv 'char_class' table.  A character may
+ * be in several classes and each state tests them in its own order.
+ */
+/* CR, LF and NUL (end of input) */
+#define SV_CLASS_EOL    (1<<0)
+#define SV_CLASS_SEP    (1<<1)
+#define SV_CLASS_QUOTE  (1<<2)
+#define SV_CLASS_ESCAPE (1<<3)
+/* space or tab when stripping whitespace */
+#define SV_CLASS_SPACE  (1<<4)
+#define SV_CLASS_NUL    (1<<5)
+/* number of combinations of class bits */
+#define SV_CLASS_COUNT  (1<<6)
+
+/* value of sv 'fields_offsets' entries for fields not in 'fields_buffer' */
+#define SV_NO_OFFSET ((size_t)-1)
 
 typedef enum  {
   SV_STATE_UNKNOWN,
@@ -76,25 +99,41 @@ struct sv_s {
   sv_fields_callback header_callback;
   sv_fields_callback data_callback;
 
-  /* line buffer */
+  /* line buffer: copy of the raw line when it spans input chunks */
   char *buffer;
   /* size allocated */
   size_t size;
   /* size used */
   size_t len;
 
+  /* raw line as a span of the current input chunk (or NULL) */
+  const char* line_span;
+  size_t line_span_len;
+
   unsigned int fields_count;
+  /* allocated size of the fields arrays */
+  size_t fields_size;
   char **fields;
   size_t *fields_widths;
+  /* offset of each field in 'fields_buffer' or SV_NO_OFFSET if the
+   * field pointer was set directly (e.g. NULL)
+   */
+  size_t *fields_offsets;
 
-  /* memory buffer used for constructing fields for user;
-   * array above 'fields' points into this
+  /* memory buffer used for constructing fields for user; holds all
+   * the row's cells each terminated with a NUL and is reused for
+   * every row.  Array above 'fields' points into this
    */
   char* fields_buffer;
   /* allocate size */
   size_t fields_buffer_size;
   /* used size */
   size_t fields_buffer_len;
+  /* offset of the current cell in 'fields_buffer' */
+  size_t cell_start;
+  /* zero copy: current cell as a span of the input chunk (or NULL) */
+  const char* cell_span;
+  size_t cell_span_len;
 
   /* first row is saved as headers */
   unsigned int headers_count;
@@ -135,15 +174,181 @@ struct sv_s {
   size_t* null_values_lengths;
 
   size_t field_size_limit;
+
+  /* SV_CLASS_* bits for each byte; rebuilt when the dialect changes */
+  unsigned char char_class[256];
+
+  /* index of a sv_parse_file_parallel() worker or -1 */
+  int thread_index;
+
+  /* column selection: source column of each output field or <0 if
+   * missing; select_count of them or NULL if all columns are returned
+   */
+  int* select_columns;
+  unsigned int select_count;
+  /* header names to select (or NULL); resolved to select_columns at
+   * the header row
+   */
+  char** select_names;
+  /* non-0 for selected source columns; select_map_size of them or NULL
+   * if not resolved yet
+   */
+  unsigned char* select_map;
+  /* index in fields of each selected source column in this row */
+  unsigned int* select_stored;
+  unsigned int select_map_size;
+  /* output fields and widths arrays of select_count */
+  char** select_fields;
+  size_t* select_widths;
+  /* source column of the current cell */
+  unsigned int column;
+  /* non-0 if unselected cells in this row are skipped */
+  int skip_columns;
+  /* non-0 if the current cell is skipped and not stored */
+  int skip_cell;
+
+  /* batch mode: data rows are returned in columnar batches of up to
+   * batch_size rows
+   */
+  sv_batch_callback batch_callback;
+  size_t batch_size;
+  sv_batch batch;
+  /* allocated columns in batch and rows in each column */
+  size_t batch_columns_size;
+  size_t batch_rows_size;
+  /* allocated size of each column data */
+  size_t* batch_data_sizes;
+
+  /* struct mode: data rows are converted into structs of
+   * struct_record_size bytes in the caller's struct_records array of
+   * struct_capacity, struct_rows of them filled so far
+   */
+  sv_struct_callback struct_callback;
+  sv_struct_field* struct_fields;
+  unsigned int struct_fields_count;
+  size_t struct_record_size;
+  void* struct_records;
+  size_t struct_capacity;
+  size_t struct_rows;
+  /* source column of each struct field or <0 if missing; found at the
+   * first data row when struct_resolved is 0
+   */
+  int* struct_columns;
+  int struct_resolved;
+  /* bytes of the string views in the filled structs */
+  char* struct_strings;
+  size_t struct_strings_size;
+  size_t struct_strings_len;
+  /* offset in struct_strings of each string view or SV_NO_OFFSET;
+   * struct_string_count per struct
+   */
+  size_t* struct_string_offsets;
+  size_t struct_string_offsets_size;
+  unsigned int struct_string_count;
+
+  /* pull mode: sv_next_row() reads input from one of source_fd (or
+   * -1), source_data or source_callback
+   */
+  int source_fd;
+  char* source_data;
+  size_t source_data_len;
+  sv_read_callback source_callback;
+  /* input being parsed: pull_len bytes at pull_data of which
+   * pull_offset have been parsed.  pull_data is source_data, a mapped
+   * file or pull_buffer
+   */
+  char* pull_data;
+  size_t pull_len;
+  size_t pull_offset;
+  int pull_mapped;
+  /* read buffer of SV_PULL_BUFFER_SIZE bytes (or NULL) */
+  char* pull_buffer;
+  /* non-0 when the source has no more input */
+  int pull_eof;
+  /* non-0 when the end of input has been parsed */
+  int pull_ended;
+  /* non-0 while sv_next_row() is parsing; data rows are kept in
+   * pull_fields, pull_widths and pull_count instead of being returned
+   * to callbacks
+   */
+  int pulling;
+  char** pull_fields;
+  size_t* pull_widths;
+  size_t pull_count;
+
+  /* non-0 if sv_internal_parse_chunk() should stop after this row */
+  int pause;
+  /* non-0 to pause after the skipped rows and header; used by
+   * sv_parse_file_parallel() to find where the data rows start
+   */
+  int pause_after_prefix;
+
+  /* stop after max_rows data rows (or 0); data_rows returned so far */
+  size_t max_rows;
+  size_t data_rows;
+  /* non-0 when parsing was stopped by max_rows or a callback; all
+   * parsing returns SV_STATUS_STOP until a reset
+   */
+  int stopped;
+
+#ifdef SV_DFA
+  /* action and next state for each state and char_class value */
+  unsigned char dfa[SV_STATE_LAST + 1][SV_CLASS_COUNT];
+#endif
 };
 
-sv_status_t sv_internal_parse_chunk(sv *t, char *buffer, size_t len);
+sv_status_t sv_internal_parse_chunk(sv *t, char *buffer, size_t len, size_t* consumed_p);
 
 /* read.c */
 void sv_internal_parse_reset(sv* t);
 void sv_internal_free_line_buffer(sv *t);
+void sv_internal_free_fields(sv *t);
+sv_status_t sv_internal_copy_headers(sv *dest, sv *src);
+int sv_internal_is_null_value(sv *t, const char* field, size_t field_len);
+#ifdef SV_DFA
+void sv_internal_parse_update_dfa(sv *t);
+#endif
+
+/* batch.c */
+/* default maximum rows in a batch */
+#define SV_BATCH_DEFAULT_SIZE 1024
+sv_status_t sv_internal_batch_add_row(sv* t, char** fields, size_t* widths, size_t count);
+sv_status_t sv_internal_batch_flush(sv* t);
+void sv_internal_batch_reset(sv* t);
+void sv_internal_batch_free(sv* t);
+
+/* struct.c */
+sv_status_t sv_internal_struct_set_schema(sv* t, const sv_struct_field* fields, unsigned int count, size_t record_size);
+sv_status_t sv_internal_struct_add_row(sv* t, char** fields, size_t* widths, size_t count);
+sv_status_t sv_internal_struct_flush(sv* t);
+void sv_internal_struct_reset(sv* t);
+void sv_internal_struct_free(sv* t);
+
+/* pull.c */
+/* size of the buffer used to read input that is not mapped */
+#define SV_PULL_BUFFER_SIZE (64 * 1024)
+void sv_internal_pull_reset(sv* t);
+void sv_internal_pull_free(sv* t);
+
+/* file.c */
+int sv_internal_file_map(int fd, char** data_p, size_t* len_p);
+void sv_internal_file_unmap(char* data, size_t len);
+
+/* convert.c */
+sv_status_t sv_internal_field_to_bool(const char* field, size_t len, int* value_p);
+
+/* option.c */
+sv_status_t sv_internal_copy_options(sv *dest, sv *src);
+void sv_internal_free_select(sv *t);
+sv_status_t sv_internal_select_columns(sv *t, const int* columns, unsigned int count);
 
 /* sv.c */
 void sv_internal_set_quote_char(sv *t, char quote_char);
+void sv_internal_update_char_classes(sv *t);
+
+/* scan.c */
+/* most bytes that can end a run: sep, CR, LF, escape and NUL */
+#define SV_SCAN_MAX_STOPS 5
+size_t sv_internal_scan_run(const char* buffer, size_t len, const char* stops, unsigned int nstops);
 
 #endif
@@ -0,0 +1,697 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * svbench.c - SV parser benchmark program
+ *
+ * Copyright (C) 2025, Dave Beckett https://www.dajobe.org/
+ *
+ * This package is Free Software
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+/*
+ * Parses generated CSV data held in memory and reports throughput,
+ * with row and batch callbacks, then counts the records with
+ * sv_count_records() for comparison and writes the rows with
+ * sv_write_fields() and a buffered #sv_writer.  Also times integer and
+ * floating point field conversion with sv_fields_to_int64() and
+ * sv_fields_to_double() against strtoll() and strtod() and timestamp
+ * conversion with sv_fields_to_epoch_ns() against sscanf() and
+ * timegm().
+ * Link against a library built with and without -DSV_DFA to compare
+ * the table driven and switch based parser cores:
+ *   make -f GNUMakefile bench
+ */
+
+
+#ifdef SV_CONFIG
+#include <sv_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <stdint.h>
+
+#include <sv.h>
+
+
+#define SVBENCH_CHUNK_SIZE (64 * 1024)
+
+typedef struct
+{
+  const char* name;
+  /* generated data */
+  char* data;
+  size_t len;
+} svbench_dataset;
+
+
+const char* program;
+
+
+static sv_status_t
+svbench_fields_callback(sv *t, void *user_data,
+                        char** fields, size_t *widths, size_t count)
+{
+  size_t* rows = (size_t*)user_data;
+
+  (*rows)++;
+  return SV_STATUS_OK;
+}
+
+
+static sv_status_t
+svbench_batch_callback(sv *t, void *user_data, sv_batch* batch)
+{
+  size_t* rows = (size_t*)user_data;
+
+  *rows += batch->rows;
+  return SV_STATUS_OK;
+}
+
+
+/* rows parsed by svbench_write() are written here */
+#define SVBENCH_OUTPUT "/dev/null"
+
+typedef struct
+{
+  FILE* fh;
+  /* or NULL to write with sv_write_fields() */
+  sv_writer* writer;
+  size_t rows;
+} svbench_output;
+
+
+static sv_status_t
+svbench_write_callback(sv *t, void *user_data,
+                       char** fields, size_t *widths, size_t count)
+{
+  svbench_output* out = (svbench_output*)user_data;
+
+  out->rows++;
+  if(out->writer)
+    return sv_writer_write_fields(out->writer, fields, widths, count);
+  return sv_write_fields(t, out->fh, fields, widths, count);
+}
+
+
+/* Append s to a growing buffer */
+static int
+svbench_append(svbench_dataset* ds, size_t* size, const char* s)
+{
+  size_t l = strlen(s);
+
+  if(ds->len + l + 1 > *size) {
+    size_t new_size = *size ? *size * 2 : 1024;
+    char* new_data;
+
+    while(new_size < ds->len + l + 1)
+      new_size *= 2;
+    new_data = (char*)realloc(ds->data, new_size);
+    if(!new_data)
+      return 1;
+    ds->data = new_data;
+    *size = new_size;
+  }
+  memcpy(ds->data + ds->len, s, l + 1);
+  ds->len += l;
+
+  return 0;
+}
+
+
+/*
+ * Generate rows of @ncols columns; @quoted_percent of cells are
+ * quoted and some of those contain separators and doubled quotes
+ */
+static int
+svbench_generate(svbench_dataset* ds, unsigned int nrows, unsigned int ncols,
+                 int quoted_percent)
+{
+  static const char* const words[8] = {
+    "1", "42", "3.14159", "abc", "hello world", "2025-01-01", "x", "NA"
+  };
+  size_t size = 0;
+  unsigned int r, c;
+  unsigned long seed = 12345;
+
+  for(r = 0; r < nrows; r++) {
+    for(c = 0; c < ncols; c++) {
+      const char* word;
+      char cell[64];
+
+      seed = seed * 1103515245UL + 12345UL;
+      word = words[(seed >> 16) & 7];
+      if((int)((seed >> 8) % 100) < quoted_percent) {
+        if((seed >> 20) & 1)
+          sprintf(cell, "\"%s, \"\"%s\"\"\"", word, word);
+        else
+          sprintf(cell, "\"%s\"", word);
+      } else
+        strcpy(cell, word);
+
+      if(svbench_append(ds, &size, cell) ||
+         svbench_append(ds, &size, (c == ncols - 1) ? "\n" : ","))
+        return 1;
+    }
+  }
+
+  return 0;
+}
+
+
+/* Parse all of @ds in chunks then signal EOF; returns non-0 on failure */
+static int
+svbench_parse_chunks(sv* t, svbench_dataset* ds)
+{
+  size_t offset;
+
+  for(offset = 0; offset < ds->len; offset += SVBENCH_CHUNK_SIZE) {
+    size_t len = ds->len - offset;
+
+    if(len > SVBENCH_CHUNK_SIZE)
+      len = SVBENCH_CHUNK_SIZE;
+    if(sv_parse_chunk(t, ds->data + offset, len))
+      return 1;
+  }
+
+  return sv_parse_chunk(t, NULL, 0) != SV_STATUS_OK;
+}
+
+
+/* Parse @ds @repeat times, returning rows in batches if @batch is
+ * non-0 and skipping the first @skip rows; returns seconds taken or
+ * < 0 on failure
+ */
+static double
+svbench_parse(svbench_dataset* ds, unsigned int repeat, int batch, int skip,
+              size_t* rows_p)
+{
+  clock_t start;
+  unsigned int i;
+
+  start = clock();
+  for(i = 0; i < repeat; i++) {
+    sv *t;
+
+    t = sv_new(rows_p, NULL, svbench_fields_callback, ',');
+    if(!t)
+      return -1.0;
+    sv_set_option(t, SV_OPTION_SAVE_HEADER, 0L);
+    if(batch)
+      sv_set_option(t, SV_OPTION_BATCH_CALLBACK, svbench_batch_callback);
+    if(skip)
+      sv_set_option(t, SV_OPTION_SKIP_ROWS, skip);
+
+    if(svbench_parse_chunks(t, ds)) {
+      sv_free(t);
+      return -1.0;
+    }
+    sv_free(t);
+  }
+
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+
+/* Parse @ds writing every row with a writer if @buffered is non-0 or
+ * else sv_write_fields(), @repeat times; returns seconds taken or < 0
+ * on failure
+ */
+static double
+svbench_write(svbench_dataset* ds, unsigned int repeat, int buffered,
+              size_t* rows_p)
+{
+  svbench_output out;
+  clock_t start;
+  unsigned int i;
+  int failed = 0;
+
+  out.fh = fopen(SVBENCH_OUTPUT, "w");
+  if(!out.fh)
+    return -1.0;
+  out.rows = 0;
+
+  start = clock();
+  for(i = 0; i < repeat && !failed; i++) {
+    sv *t;
+
+    t = sv_new(&out, NULL, svbench_write_callback, ',');
+    if(!t) {
+      failed = 1;
+      break;
+    }
+    sv_set_option(t, SV_OPTION_SAVE_HEADER, 0L);
+    out.writer = buffered ? sv_writer_new(t, out.fh, 0) : NULL;
+    if(buffered && !out.writer)
+      failed = 1;
+    else if(svbench_parse_chunks(t, ds))
+      failed = 1;
+    if(out.writer && sv_writer_close(out.writer))
+      failed = 1;
+    sv_free(t);
+  }
+  fclose(out.fh);
+  *rows_p += out.rows;
+
+  return failed ? -1.0 : (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+
+/* Count records in @ds @repeat times; returns seconds taken or < 0 on failure */
+static double
+svbench_count(svbench_dataset* ds, unsigned int repeat, size_t* rows_p)
+{
+  clock_t start;
+  sv *t;
+  unsigned int i;
+
+  t = sv_new(NULL, NULL, svbench_fields_callback, ',');
+  if(!t)
+    return -1.0;
+  sv_set_option(t, SV_OPTION_SAVE_HEADER, 0L);
+
+  start = clock();
+  for(i = 0; i < repeat; i++) {
+    sv_record_counts counts;
+
+    if(sv_count_records(t, ds->data, ds->len, &counts)) {
+      sv_free(t);
+      return -1.0;
+    }
+    *rows_p += counts.records;
+  }
+  sv_free(t);
+
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+
+#define SVBENCH_N_VALUES 1000000
+
+/* Convert generated integer fields @repeat times with
+ * sv_fields_to_int64() and then strtoll(), printing the rate of each
+ */
+static int
+svbench_int64(const char* label, unsigned int repeat)
+{
+  char* buffer;
+  char** fields;
+  size_t* widths;
+  int64_t* values;
+  unsigned long seed = 12345;
+  int64_t sum[2] = { 0, 0 };
+  size_t offset = 0;
+  unsigned int i, r;
+  int rc = 1;
+
+  /* up to 20 bytes each: sign, 18 digits and NUL */
+  buffer = (char*)malloc(SVBENCH_N_VALUES * 20);
+  fields = (char**)malloc(sizeof(char*) * SVBENCH_N_VALUES);
+  widths = (size_t*)malloc(sizeof(size_t) * SVBENCH_N_VALUES);
+  values = (int64_t*)malloc(sizeof(int64_t) * SVBENCH_N_VALUES);
+  if(!buffer || !fields || !widths || !values)
+    goto tidy;
+
+  /* 1 to 18 digits, a quarter negative */
+  for(i = 0; i < SVBENCH_N_VALUES; i++) {
+    unsigned int ndigits;
+    unsigned int d;
+
+    seed = seed * 1103515245UL + 12345UL;
+    ndigits = 1 + (unsigned int)((seed >> 16) % 18);
+    fields[i] = buffer + offset;
+    if(!((seed >> 8) & 3))
+      buffer[offset++] = '-';
+    for(d = 0; d < ndigits; d++) {
+      seed = seed * 1103515245UL + 12345UL;
+      buffer[offset++] = (char)('0' + (seed >> 16) % 10);
+    }
+    widths[i] = (size_t)(buffer + offset - fields[i]);
+    buffer[offset++] = '\0';
+  }
+
+  for(r = 0; r < 2; r++) {
+    clock_t start = clock();
+    unsigned int k;
+    double secs;
+
+    for(k = 0; k < repeat; k++) {
+      if(!r) {
+        if(sv_fields_to_int64(fields, widths, SVBENCH_N_VALUES, values, NULL))
+          goto tidy;
+      } else {
+        for(i = 0; i < SVBENCH_N_VALUES; i++)
+          values[i] = strtoll(fields[i], NULL, 10);
+      }
+      for(i = 0; i < SVBENCH_N_VALUES; i += 1000)
+        sum[r] += values[i];
+    }
+    secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    fprintf(stdout, "%s: int64  %-21s %8u values in %6.3fs %8.1f Mvalues/s\n",
+            label, r ? "strtoll" : "sv_fields_to_int64",
+            SVBENCH_N_VALUES * repeat, secs,
+            secs > 0 ? SVBENCH_N_VALUES * (double)repeat / secs / 1e6 : 0.0);
+  }
+
+  if(sum[0] == sum[1])
+    rc = 0;
+  else
+    fprintf(stderr, "%s: sv_fields_to_int64() and strtoll() differ\n",
+            program);
+
+ tidy:
+  if(buffer)
+    free(buffer);
+  if(fields)
+    free(fields);
+  if(widths)
+    free(widths);
+  if(values)
+    free(values);
+
+  return rc;
+}
+
+
+/* Convert generated sensor style decimal fields @repeat times with
+ * sv_fields_to_double() and then strtod(), printing the rate of each
+ */
+static int
+svbench_double(const char* label, unsigned int repeat)
+{
+  char* buffer;
+  char** fields;
+  size_t* widths;
+  double* values;
+  unsigned long seed = 12345;
+  double sum[2] = { 0.0, 0.0 };
+  size_t offset = 0;
+  unsigned int i, r;
+  int rc = 1;
+
+  buffer = (char*)malloc(SVBENCH_N_VALUES * 32);
+  fields = (char**)malloc(sizeof(char*) * SVBENCH_N_VALUES);
+  widths = (size_t*)malloc(sizeof(size_t) * SVBENCH_N_VALUES);
+  values = (double*)malloc(sizeof(double) * SVBENCH_N_VALUES);
+  if(!buffer || !fields || !widths || !values)
+    goto tidy;
+
+  /* -9999.999999 to 9999.999999 with 1 to 6 decimals; some exponents */
+  for(i = 0; i < SVBENCH_N_VALUES; i++) {
+    double d;
+    int len;
+
+    seed = seed * 1103515245UL + 12345UL;
+    d = (double)((long)(seed >> 8) % 2000000000L - 1000000000L) / 100000.0;
+    if(!((seed >> 4) & 7))
+      len = sprintf(buffer + offset, "%.6e", d);
+    else
+      len = sprintf(buffer + offset, "%.*f", 1 + (int)((seed >> 12) % 6), d);
+    fields[i] = buffer + offset;
+    widths[i] = (size_t)len;
+    offset += (size_t)len + 1;
+  }
+
+  for(r = 0; r < 2; r++) {
+    clock_t start = clock();
+    unsigned int k;
+    double secs;
+
+    for(k = 0; k < repeat; k++) {
+      if(!r) {
+        if(sv_fields_to_double(fields, widths, SVBENCH_N_VALUES, values, NULL))
+          goto tidy;
+      } else {
+        for(i = 0; i < SVBENCH_N_VALUES; i++)
+          values[i] = strtod(fields[i], NULL);
+      }
+      for(i = 0; i < SVBENCH_N_VALUES; i += 1000)
+        sum[r] += values[i];
+    }
+    secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    fprintf(stdout, "%s: double %-21s %8u values in %6.3fs %8.1f Mvalues/s\n",
+            label, r ? "strtod" : "sv_fields_to_double",
+            SVBENCH_N_VALUES * repeat, secs,
+            secs > 0 ? SVBENCH_N_VALUES * (double)repeat / secs / 1e6 : 0.0);
+  }
+
+  if(sum[0] == sum[1])
+    rc = 0;
+  else
+    fprintf(stderr, "%s: sv_fields_to_double() and strtod() differ\n",
+            program);
+
+ tidy:
+  if(buffer)
+    free(buffer);
+  if(fields)
+    free(fields);
+  if(widths)
+    free(widths);
+  if(values)
+    free(values);
+
+  return rc;
+}
+
+
+/* Convert generated RFC 3339 timestamp fields @repeat times with
+ * sv_fields_to_epoch_ns() and then sscanf() and timegm(), printing the
+ * rate of each
+ */
+static int
+svbench_epoch(const char* label, unsigned int repeat)
+{
+  char* buffer;
+  char** fields;
+  size_t* widths;
+  int64_t* values;
+  unsigned long seed = 12345;
+  int64_t sum[2] = { 0, 0 };
+  size_t offset = 0;
+  unsigned int i, r;
+  int rc = 1;
+
+  buffer = (char*)malloc(SVBENCH_N_VALUES * 32);
+  fields = (char**)malloc(sizeof(char*) * SVBENCH_N_VALUES);
+  widths = (size_t*)malloc(sizeof(size_t) * SVBENCH_N_VALUES);
+  values = (int64_t*)malloc(sizeof(int64_t) * SVBENCH_N_VALUES);
+  if(!buffer || !fields || !widths || !values)
+    goto tidy;
+
+  for(i = 0; i < SVBENCH_N_VALUES; i++) {
+    int len;
+
+    seed = seed * 1103515245UL + 12345UL;
+    len = sprintf(buffer + offset, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+                  1990 + (int)((seed >> 8) % 40), 1 + (int)((seed >> 12) % 12),
+                  1 + (int)((seed >> 16) % 28), (int)((seed >> 4) % 24),
+                  (int)((seed >> 20) % 60), (int)((seed >> 10) % 60),
+                  (int)((seed >> 6) % 1000));
+    fields[i] = buffer + offset;
+    widths[i] = (size_t)len;
+    offset += (size_t)len + 1;
+  }
+
+  for(r = 0; r < 2; r++) {
+    clock_t start = clock();
+    unsigned int k;
+    double secs;
+
+    for(k = 0; k < repeat; k++) {
+      if(!r) {
+        if(sv_fields_to_epoch_ns(fields, widths, SVBENCH_N_VALUES, values,
+                                 NULL))
+          goto tidy;
+      } else {
+        for(i = 0; i < SVBENCH_N_VALUES; i++) {
+          struct tm tm;
+          int millis = 0;
+
+          memset(&tm, '\0', sizeof(tm));
+          if(sscanf(fields[i], "%d-%d-%dT%d:%d:%d.%dZ", &tm.tm_year,
+                    &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min,
+                    &tm.tm_sec, &millis) != 7)
+            goto tidy;
+          tm.tm_year -= 1900;
+          tm.tm_mon--;
+          values[i] = (int64_t)timegm(&tm) * 1000000000 +
+            (int64_t)millis * 1000000;
+        }
+      }
+      for(i = 0; i < SVBENCH_N_VALUES; i += 1000)
+        sum[r] += values[i];
+    }
+    secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    fprintf(stdout, "%s: epoch  %-21s %8u values in %6.3fs %8.1f Mvalues/s\n",
+            label, r ? "sscanf+timegm" : "sv_fields_to_epoch_ns",
+            SVBENCH_N_VALUES * repeat, secs,
+            secs > 0 ? SVBENCH_N_VALUES * (double)repeat / secs / 1e6 : 0.0);
+  }
+
+  if(sum[0] == sum[1])
+    rc = 0;
+  else
+    fprintf(stderr, "%s: sv_fields_to_epoch_ns() and timegm() differ\n",
+            program);
+
+ tidy:
+  if(buffer)
+    free(buffer);
+  if(fields)
+    free(fields);
+  if(widths)
+    free(widths);
+  if(values)
+    free(values);
+
+  return rc;
+}
+
+
+/* Print a throughput line */
+static void
+svbench_report(const char* label, const char* mode, svbench_dataset* ds,
+               unsigned int repeat, double secs, size_t rows)
+{
+  double mb = (double)ds->len * repeat / (1024.0 * 1024.0);
+
+  fprintf(stdout, "%s: %-5s %-14s %8.1f MB in %6.3fs %8.1f MB/s %zu rows\n",
+          label, mode, ds->name, mb, secs, secs > 0 ? mb / secs : 0.0, rows);
+}
+
+
+#define SVBENCH_N_DATASETS 3
+/* rows in each dataset */
+#define SVBENCH_ROWS 200000
+
+int
+main(int argc, char *argv[])
+{
+  svbench_dataset datasets[SVBENCH_N_DATASETS] = {
+    { "short unquoted", NULL, 0 },
+    { "mixed quoted",   NULL, 0 },
+    { "all quoted",     NULL, 0 }
+  };
+  static const int quoted_percents[SVBENCH_N_DATASETS] = { 0, 30, 100 };
+  const char* label = "libsv";
+  unsigned int repeat = 5;
+  unsigned int i;
+  int rc = 0;
+
+  program = "svbench";
+
+  if(argc > 3) {
+    fprintf(stderr, "USAGE: %s [LABEL [REPEAT]]\n", program);
+    return 1;
+  }
+  if(argc > 1)
+    label = argv[1];
+  if(argc > 2)
+    repeat = (unsigned int)atoi(argv[2]);
+  if(!repeat)
+    repeat = 1;
+
+  for(i = 0; i < SVBENCH_N_DATASETS; i++) {
+    svbench_dataset* ds = &datasets[i];
+    size_t rows = 0;
+    double secs;
+
+    if(svbench_generate(ds, SVBENCH_ROWS, 10, quoted_percents[i])) {
+      fprintf(stderr, "%s: Failed to generate data\n", program);
+      rc = 1;
+      break;
+    }
+
+    secs = svbench_parse(ds, repeat, 0, 0, &rows);
+    if(secs < 0) {
+      fprintf(stderr, "%s: Failed to parse %s data\n", program, ds->name);
+      rc = 1;
+      break;
+    }
+    svbench_report(label, "parse", ds, repeat, secs, rows);
+
+    rows = 0;
+    secs = svbench_parse(ds, repeat, 1, 0, &rows);
+    if(secs < 0) {
+      fprintf(stderr, "%s: Failed to parse %s data\n", program, ds->name);
+      rc = 1;
+      break;
+    }
+    svbench_report(label, "batch", ds, repeat, secs, rows);
+
+    rows = 0;
+    secs = svbench_count(ds, repeat, &rows);
+    if(secs < 0) {
+      fprintf(stderr, "%s: Failed to count %s data\n", program, ds->name);
+      rc = 1;
+      break;
+    }
+    svbench_report(label, "count", ds, repeat, secs, rows);
+
+    /* skip all but the last row */
+    rows = 0;
+    secs = svbench_parse(ds, repeat, 0, SVBENCH_ROWS - 1, &rows);
+    if(secs < 0) {
+      fprintf(stderr, "%s: Failed to skip %s data\n", program, ds->name);
+      rc = 1;
+      break;
+    }
+    svbench_report(label, "skip", ds, repeat, secs, rows);
+
+    rows = 0;
+    secs = svbench_write(ds, repeat, 0, &rows);
+    if(secs < 0) {
+      fprintf(stderr, "%s: Failed to write %s data\n", program, ds->name);
+      rc = 1;
+      break;
+    }
+    svbench_report(label, "write", ds, repeat, secs, rows);
+
+    rows = 0;
+    secs = svbench_write(ds, repeat, 1, &rows);
+    if(secs < 0) {
+      fprintf(stderr, "%s: Failed to write %s data\n", program, ds->name);
+      rc = 1;
+      break;
+    }
+    svbench_report(label, "wbuf", ds, repeat, secs, rows);
+  }
+
+  if(!rc && svbench_int64(label, repeat)) {
+    fprintf(stderr, "%s: Failed to convert integers\n", program);
+    rc = 1;
+  }
+  if(!rc && svbench_double(label, repeat)) {
+    fprintf(stderr, "%s: Failed to convert doubles\n", program);
+    rc = 1;
+  }
+  if(!rc && svbench_epoch(label, repeat)) {
+    fprintf(stderr, "%s: Failed to convert timestamps\n", program);
+    rc = 1;
+  }
+
+  for(i = 0; i < SVBENCH_N_DATASETS; i++) {
+    if(datasets[i].data)
+      free(datasets[i].data);
+  }
+
+  return rc;
+}
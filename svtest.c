@@ -28,6 +28,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <time.h>
+#include <math.h>
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -35,6 +38,9 @@
 #ifdef HAVE_ERRNO_H
 #include <errno.h>
 #endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
 
 #include <sv.h>
 
@@ -318,6 +324,28 @@ static int svtest_run_skip_rows_gt_total(void);
 static int svtest_run_null_handling_default(void);
 static int svtest_run_null_handling_enhanced(void);
 static int svtest_run_field_size_limit(void);
+static int svtest_run_long_cells(void);
+static int svtest_run_fields_reuse(void);
+static int svtest_run_wide_row(void);
+static int svtest_run_line_callback_chunks(void);
+static int svtest_run_zero_copy(void);
+static int svtest_run_dialect_options(void);
+static int svtest_run_parallel(void);
+static int svtest_run_parse_file(void);
+static int svtest_run_select_columns(void);
+static int svtest_run_count_records(void);
+static int svtest_run_batch_callback(void);
+static int svtest_run_table(void);
+static int svtest_run_table_infer(void);
+static int svtest_run_field_to_int64(void);
+static int svtest_run_field_to_double(void);
+static int svtest_run_field_to_epoch_ns(void);
+static int svtest_run_struct_decode(void);
+static int svtest_run_next_row(void);
+static int svtest_run_parse_chunk_partial(void);
+static int svtest_run_max_rows(void);
+static int svtest_run_skip_rows_scan(void);
+static int svtest_run_writer(void);
 
 
 static int
@@ -1339,97 +1367,2936 @@ static int svtest_run_field_size_limit(void) {
 }
 
 
-#define MAX_TEST_INDEX (N_TESTS-1)
+/* structure used to collect parsed rows as one string */
+typedef struct
+{
+  char* buffer;
+  size_t len;
+  size_t size;
+  int rows_count;
+} svtest_collector;
 
-int
-main(int argc, char *argv[])
+
+static int
+svtest_collector_add(svtest_collector* c, const char* s, size_t len)
 {
-  char *p;
+  if(c->len + len + 1 > c->size) {
+    size_t nsize = (c->len + len + 1) * 2;
+    char* nbuffer = (char*)realloc(c->buffer, nsize);
+    if(!nbuffer)
+      return 1;
+    c->buffer = nbuffer;
+    c->size = nsize;
+  }
+  memcpy(c->buffer + c->len, s, len);
+  c->len += len;
+  c->buffer[c->len] = '\0';
+  return 0;
+}
+
+
+/* Append row to collector as fields joined by | and ending in \n */
+static sv_status_t
+svtest_collect_callback(sv *t, void *user_data,
+                        char** fields, size_t *widths, size_t count)
+{
+  svtest_collector* c = (svtest_collector*)user_data;
+  size_t i;
+
+  for(i = 0; i < count; i++) {
+    if(i > 0 && svtest_collector_add(c, "|", 1))
+      return SV_STATUS_NO_MEMORY;
+    if(!fields[i]) {
+      if(svtest_collector_add(c, "<NULL>", 6))
+        return SV_STATUS_NO_MEMORY;
+    } else if(svtest_collector_add(c, fields[i], widths[i]))
+      return SV_STATUS_NO_MEMORY;
+  }
+  if(svtest_collector_add(c, "\n", 1))
+    return SV_STATUS_NO_MEMORY;
+
+  c->rows_count++;
+  return SV_STATUS_OK;
+}
+
+
+/* Parse data in chunks of chunk_size bytes then signal EOF */
+static sv_status_t
+svtest_parse_in_chunks(sv* t, const char* data, size_t len, size_t chunk_size)
+{
+  sv_status_t status = SV_STATUS_OK;
+
+  while(len > 0) {
+    size_t n = (len < chunk_size) ? len : chunk_size;
+    status = sv_parse_chunk(t, (char*)data, n);
+    if(status)
+      return status;
+    data += n;
+    len -= n;
+  }
+
+  return sv_parse_chunk(t, NULL, 0);
+}
+
+
+/* Long unquoted and quoted cells exercise the run scanning fast paths */
+static int svtest_run_long_cells(void) {
+  static const size_t chunk_sizes[4] = { 1, 7, 64, 0 };
+  svtest_collector input;
+  svtest_collector expected;
+  svtest_collector got;
+  unsigned int row, col, i;
   int rc = 0;
-  unsigned int test_index;
 
-  program = argv[0];
-  if((p = strrchr(program, '/')))
-    program = p + 1;
-  else if((p = strrchr(program, '\\')))
-    program = p + 1;
-  argv[0] = program;
+  fprintf(stderr, "Running Test: Long Cells...\n");
 
-  if(argc < 1 || argc > 2) {
-    fprintf(stderr, "USAGE: %s [TEST-INDEX 1..%d]\n", program, MAX_TEST_INDEX);
+  memset(&input, '\0', sizeof(input));
+  memset(&expected, '\0', sizeof(expected));
+
+  for(row = 0; row < 50; row++) {
+    for(col = 0; col < 5; col++) {
+      char cell[128];
+      size_t cell_len = (row * 7 + col * 13) % 100;
+      /* odd columns are quoted and may hold sep, newline and quote */
+      int quoted = (col % 2);
+
+      for(i = 0; i < cell_len; i++)
+        cell[i] = (char)('a' + (row + col + i) % 26);
+      if(quoted) {
+        for(i = 5; i < cell_len; i += 17)
+          cell[i] = ",\n\""[(row + i) % 3];
+      }
+      if(col > 0) {
+        svtest_collector_add(&input, ",", 1);
+        svtest_collector_add(&expected, "|", 1);
+      }
+      if(quoted) {
+        svtest_collector_add(&input, "\"", 1);
+        for(i = 0; i < cell_len; i++) {
+          if(cell[i] == '"')
+            svtest_collector_add(&input, "\"", 1);
+          svtest_collector_add(&input, &cell[i], 1);
+        }
+        svtest_collector_add(&input, "\"", 1);
+      } else
+        svtest_collector_add(&input, cell, cell_len);
+      svtest_collector_add(&expected, cell, cell_len);
+    }
+    svtest_collector_add(&input, (row % 2) ? "\r\n" : "\n", (row % 2) + 1);
+    svtest_collector_add(&expected, "\n", 1);
+  }
+
+  if(!input.buffer || !expected.buffer) {
+    fprintf(stderr, "%s: Test Long Cells FAIL - out of memory\n", program);
     rc = 1;
     goto tidy;
   }
 
-  if(argc == 2) {
-    test_index = atoi(argv[1]);
-    if(test_index < 1 || test_index > MAX_TEST_INDEX) {
-      fprintf(stderr, "%s: Test arg '%s' not in range 1..%d\n", program,
-              argv[1], MAX_TEST_INDEX);
+  for(i = 0; i < 4; i++) {
+    size_t chunk_size = chunk_sizes[i] ? chunk_sizes[i] : input.len;
+    sv* t;
+
+    memset(&got, '\0', sizeof(got));
+    t = sv_new(&got, NULL, svtest_collect_callback, ',');
+    if(!t) {
+      fprintf(stderr, "%s: Test Long Cells FAIL - sv_new() failed\n", program);
       rc = 1;
-      goto tidy;
+      break;
     }
-    rc = svtest_run_test(test_index);
-  } else {
-    /* run all tests */
-
-    for(test_index = 0; test_index < N_TESTS; test_index++) {
-      int test_rc;
+    sv_set_option(t, SV_OPTION_SAVE_HEADER, 0L);
 
-      test_rc = svtest_run_test(test_index);
-      if(test_rc > 0) {
-        /* error */
-        rc++;
-      } else if (test_rc < 0) {
-        /* failure; do not run any more tests */
-        rc = 1;
-        break;
-      }
-    }
-    /* Add the custom test call AFTER the loop */
-    if (svtest_run_unclosed_quote_eof() != 0) {
-      rc++;
-    }
-    if (svtest_run_custom_quote_double_quote() != 0) {
-      rc++;
-    }
-    if (svtest_run_quote_char_disabled() != 0) {
-      rc++;
-    }
-    if (svtest_run_empty_file() != 0) {
-      rc++;
-    }
-    if (svtest_run_newlines_only_file() != 0) {
-      rc++;
-    }
-    if (svtest_run_delimiters_only_file() != 0) {
-      rc++;
-    }
-    if (svtest_run_ends_with_delimiter() != 0) {
-      rc++;
-    }
-    if (svtest_run_crlf_eol() != 0) {
-      rc++;
+    if(svtest_parse_in_chunks(t, input.buffer, input.len, chunk_size) ||
+       !got.buffer || strcmp(got.buffer, expected.buffer)) {
+      fprintf(stderr, "%s: Test Long Cells FAIL - chunk size %d gave wrong rows\n",
+              program, (int)chunk_size);
+      rc = 1;
     }
-    if (svtest_run_strip_whitespace_empty() != 0) {
-      rc++;
+
+    sv_free(t);
+    if(got.buffer)
+      free(got.buffer);
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Long Cells OK\n", program);
+
+  tidy:
+  if(input.buffer)
+    free(input.buffer);
+  if(expected.buffer)
+    free(expected.buffer);
+
+  return rc;
+}
+
+
+/* structure used to check the same arrays are passed for every row */
+typedef struct
+{
+  char** fields;
+  size_t* widths;
+  int rows_count;
+  int changed_count;
+} svtest_reuse_context;
+
+
+static sv_status_t
+svtest_reuse_callback(sv *t, void *user_data,
+                      char** fields, size_t *widths, size_t count)
+{
+  svtest_reuse_context* c = (svtest_reuse_context*)user_data;
+
+  if(!c->rows_count) {
+    c->fields = fields;
+    c->widths = widths;
+  } else if(c->fields != fields || c->widths != widths)
+    c->changed_count++;
+
+  c->rows_count++;
+  return SV_STATUS_OK;
+}
+
+
+/* Fields arrays are kept across rows and resets */
+static int svtest_run_fields_reuse(void) {
+  const char* data = "a,b,c\n1,2,3\n4,5,6\n7,8\n";
+  svtest_reuse_context c;
+  sv *t;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Fields Reuse...\n");
+
+  memset(&c, '\0', sizeof(c));
+  t = sv_new(&c, NULL, svtest_reuse_callback, ',');
+  if(!t) {
+    fprintf(stderr, "%s: Test Fields Reuse FAIL - sv_new() failed\n", program);
+    return 1;
+  }
+  sv_set_option(t, SV_OPTION_SAVE_HEADER, 0L);
+
+  svtest_parse_in_chunks(t, data, strlen(data), 5);
+  sv_reset(t);
+  svtest_parse_in_chunks(t, data, strlen(data), 5);
+
+  if(c.rows_count != 8) {
+    fprintf(stderr, "%s: Test Fields Reuse FAIL - saw %d rows, expected 8\n",
+            program, c.rows_count);
+    rc = 1;
+  } else if(c.changed_count) {
+    fprintf(stderr, "%s: Test Fields Reuse FAIL - fields arrays changed %d times\n",
+            program, c.changed_count);
+    rc = 1;
+  } else
+    fprintf(stderr, "%s: Test Fields Reuse OK\n", program);
+
+  sv_free(t);
+  return rc;
+}
+
+
+/* structure used to count rows and fields */
+typedef struct
+{
+  int rows_count;
+  size_t fields_count;
+  size_t last_width;
+} svtest_count_context;
+
+
+static sv_status_t
+svtest_count_callback(sv *t, void *user_data,
+                      char** fields, size_t *widths, size_t count)
+{
+  svtest_count_context* c = (svtest_count_context*)user_data;
+
+  c->rows_count++;
+  c->fields_count += count;
+  c->last_width = count ? widths[count - 1] : 0;
+  return SV_STATUS_OK;
+}
+
+
+/* Parse data as rows of `columns` fields; return CPU seconds or <0 */
+static double
+svtest_time_rows(size_t rows, size_t columns, svtest_count_context* c)
+{
+  svtest_collector input;
+  clock_t start;
+  double secs;
+  sv *t;
+  size_t row, col;
+
+  memset(&input, '\0', sizeof(input));
+  for(row = 0; row < rows; row++) {
+    for(col = 0; col < columns; col++)
+      svtest_collector_add(&input, col ? ",42" : "42", col ? 3 : 2);
+    svtest_collector_add(&input, "\n", 1);
+  }
+  if(!input.buffer)
+    return -1.0;
+
+  memset(c, '\0', sizeof(*c));
+  t = sv_new(c, NULL, svtest_count_callback, ',');
+  if(!t) {
+    free(input.buffer);
+    return -1.0;
+  }
+  sv_set_option(t, SV_OPTION_SAVE_HEADER, 0L);
+
+  start = clock();
+  sv_parse_chunk(t, input.buffer, input.len);
+  sv_parse_chunk(t, NULL, 0);
+  secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  sv_free(t);
+  free(input.buffer);
+  return secs;
+}
+
+
+/* One row of 100k columns parses the same fields as 100 narrow rows.
+ * The timings are printed for comparison since growing a row's
+ * fields was quadratic; they are not checked as timers are noisy.
+ */
+static int svtest_run_wide_row(void) {
+  svtest_count_context c;
+  double narrow_secs;
+  double wide_secs;
+
+  fprintf(stderr, "Running Test: Wide Row...\n");
+
+  narrow_secs = svtest_time_rows(100, 1000, &c);
+  if(narrow_secs < 0 || c.rows_count != 100 || c.fields_count != 100000) {
+    fprintf(stderr, "%s: Test Wide Row FAIL - narrow rows parsed wrongly\n",
+            program);
+    return 1;
+  }
+
+  wide_secs = svtest_time_rows(1, 100000, &c);
+  if(wide_secs < 0 || c.rows_count != 1 || c.fields_count != 100000 ||
+     c.last_width != 2) {
+    fprintf(stderr, "%s: Test Wide Row FAIL - wide row parsed wrongly\n",
+            program);
+    return 1;
+  }
+
+  fprintf(stderr, "%s: 100 rows x 1000 columns %.4fs; 1 row x 100000 columns %.4fs\n",
+          program, narrow_secs, wide_secs);
+
+  fprintf(stderr, "%s: Test Wide Row OK\n", program);
+
+  return 0;
+}
+
+
+/* Append NUL terminated line to collector followed by | */
+static sv_status_t
+svtest_collect_line_callback(sv *t, void *user_data,
+                             const char* line, size_t length)
+{
+  svtest_collector* c = (svtest_collector*)user_data;
+
+  if(line[length])
+    return SV_STATUS_FAILED;
+  if(svtest_collector_add(c, line, length) || svtest_collector_add(c, "|", 1))
+    return SV_STATUS_NO_MEMORY;
+  return SV_STATUS_OK;
+}
+
+
+/* Append line that may not be NUL terminated to collector followed by | */
+static sv_status_t
+svtest_collect_line_span_callback(sv *t, void *user_data,
+                                  const char* line, size_t length)
+{
+  svtest_collector* c = (svtest_collector*)user_data;
+
+  if(svtest_collector_add(c, line, length) || svtest_collector_add(c, "|", 1))
+    return SV_STATUS_NO_MEMORY;
+  return SV_STATUS_OK;
+}
+
+
+/* Raw lines and comments are the same however the input is chunked */
+static int svtest_run_line_callback_chunks(void) {
+  static const char data[] = "a,b\n\"x\ny\",z\r\n#c1\n1,\0002\n3,4";
+  static const size_t chunk_sizes[4] = { 1, 3, 8, 0 };
+  const char* expected = "a,b|\"x\ny\",z|c1|1,2|3,4|";
+  svtest_collector got;
+  unsigned int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Line Callback Chunks...\n");
+
+  /* lines are NUL terminated copies except in zero copy mode */
+  for(i = 0; i < 8; i++) {
+    size_t chunk_size = chunk_sizes[i % 4] ? chunk_sizes[i % 4] :
+      sizeof(data) - 1;
+    int zero_copy = (i >= 4);
+    sv_line_callback cb = zero_copy ? svtest_collect_line_span_callback :
+      svtest_collect_line_callback;
+    sv *t;
+
+    memset(&got, '\0', sizeof(got));
+    t = sv_new(&got, NULL, NULL, ',');
+    if(!t) {
+      fprintf(stderr, "%s: Test Line Callback Chunks FAIL - sv_new() failed\n",
+              program);
+      return 1;
     }
-    if (svtest_run_skip_comment_interaction() != 0) {
-      rc++;
+    sv_set_option(t, SV_OPTION_LINE_CALLBACK, cb);
+    sv_set_option(t, SV_OPTION_COMMENT_PREFIX, "#");
+    sv_set_option(t, SV_OPTION_COMMENT_CALLBACK, cb);
+    sv_set_option(t, SV_OPTION_ZERO_COPY, (long)zero_copy);
+
+    svtest_parse_in_chunks(t, data, sizeof(data) - 1, chunk_size);
+
+    if(!got.buffer || strcmp(got.buffer, expected)) {
+      fprintf(stderr, "%s: Test Line Callback Chunks FAIL - chunk size %d zero copy %d got lines '%s' expected '%s'\n",
+              program, (int)chunk_size, zero_copy,
+              got.buffer ? got.buffer : "", expected);
+      rc = 1;
     }
-    if (svtest_run_skip_rows_gt_total() != 0) {
-      rc++;
+
+    sv_free(t);
+    if(got.buffer)
+      free(got.buffer);
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Line Callback Chunks OK\n", program);
+
+  return rc;
+}
+
+
+/* structure used for zero copy test callback */
+typedef struct
+{
+  svtest_collector rows;
+  const char* data;
+  size_t data_len;
+  /* fields pointing into data */
+  int in_data_count;
+} svtest_zero_copy_context;
+
+
+static sv_status_t
+svtest_zero_copy_callback(sv *t, void *user_data,
+                          char** fields, size_t *widths, size_t count)
+{
+  svtest_zero_copy_context* c = (svtest_zero_copy_context*)user_data;
+  size_t i;
+
+  for(i = 0; i < count; i++) {
+    if(fields[i] >= c->data && fields[i] < c->data + c->data_len)
+      c->in_data_count++;
+  }
+
+  return svtest_collect_callback(t, &c->rows, fields, widths, count);
+}
+
+
+/* Zero copy fields point into the input unless they span chunks or
+ * need unescaping
+ */
+static int svtest_run_zero_copy(void) {
+  static const char data[] = "a,b,c\nxx,\"q\"\"q\",  zz \n1,\"22\",3\n";
+  static const size_t chunk_sizes[3] = { 0, 4, 1 };
+  /* whole buffer: xx zz 1 22 3 are in data; q"q is unescaped */
+  static const int expected_in_data[3] = { 5, -1, 0 };
+  const char* expected = "xx|q\"q|zz\n1|22|3\n";
+  svtest_zero_copy_context c;
+  unsigned int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Zero Copy...\n");
+
+  for(i = 0; i < 3; i++) {
+    size_t chunk_size = chunk_sizes[i] ? chunk_sizes[i] : sizeof(data) - 1;
+    sv *t;
+
+    memset(&c, '\0', sizeof(c));
+    c.data = data;
+    c.data_len = sizeof(data) - 1;
+    t = sv_new(&c, NULL, svtest_zero_copy_callback, ',');
+    if(!t) {
+      fprintf(stderr, "%s: Test Zero Copy FAIL - sv_new() failed\n", program);
+      return 1;
     }
-    if (svtest_run_null_handling_default() != 0) {
-      rc++;
+    sv_set_option(t, SV_OPTION_ZERO_COPY, 1L);
+    sv_set_option(t, SV_OPTION_STRIP_WHITESPACE, 1L);
+
+    svtest_parse_in_chunks(t, data, sizeof(data) - 1, chunk_size);
+
+    if(!c.rows.buffer || strcmp(c.rows.buffer, expected)) {
+      fprintf(stderr, "%s: Test Zero Copy FAIL - chunk size %d got rows '%s' expected '%s'\n",
+              program, (int)chunk_size, c.rows.buffer ? c.rows.buffer : "",
+              expected);
+      rc = 1;
+    } else if(expected_in_data[i] >= 0 &&
+              c.in_data_count != expected_in_data[i]) {
+      fprintf(stderr, "%s: Test Zero Copy FAIL - chunk size %d got %d fields in input expected %d\n",
+              program, (int)chunk_size, c.in_data_count, expected_in_data[i]);
+      rc = 1;
     }
-    if (svtest_run_null_handling_enhanced() != 0) {
-      rc++;
+
+    sv_free(t);
+    if(c.rows.buffer)
+      free(c.rows.buffer);
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Zero Copy OK\n", program);
+
+  return rc;
+}
+
+
+typedef struct
+{
+  char quote_char;
+  char escape_char;
+  /* 1: strip whitespace; 2: set and then clear it again */
+  int strip_whitespace;
+  const char* data;
+  const char* expected;
+} svtest_dialect_test;
+
+#define N_DIALECT_TESTS 5
+static const svtest_dialect_test dialect_tests[N_DIALECT_TESTS] = {
+  { '\'', '\0', 0, "'a,b',\"c\"\n", "a,b|\"c\"\n" },
+  { '"', '\\', 0, "a\\,b,\"c\\\"d\"\n", "a,b|c\"d\n" },
+  { '"', '\0', 1, " a ,\t\"b\"\n", "a|b\n" },
+  { '"', '\0', 2, " a ,\tb\n", " a |\tb\n" },
+  { '\'', '\\', 1, " 'x\\'y' , z\n", "x'y|z\n" }
+};
+
+
+/* The parser follows quote, escape and whitespace options set after
+ * sv_new()
+ */
+static int svtest_run_dialect_options(void) {
+  svtest_collector got;
+  unsigned int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Dialect Options...\n");
+
+  for(i = 0; i < N_DIALECT_TESTS; i++) {
+    const svtest_dialect_test* dt = &dialect_tests[i];
+    sv *t;
+
+    memset(&got, '\0', sizeof(got));
+    t = sv_new(&got, NULL, svtest_collect_callback, ',');
+    if(!t) {
+      fprintf(stderr, "%s: Test Dialect Options FAIL - sv_new() failed\n",
+              program);
+      return 1;
     }
-    if (svtest_run_header_null_handling_enhanced() != 0) {
-      rc++;
+    sv_set_option(t, SV_OPTION_SAVE_HEADER, 0L);
+    sv_set_option(t, SV_OPTION_QUOTE_CHAR, dt->quote_char);
+    if(dt->escape_char)
+      sv_set_option(t, SV_OPTION_ESCAPE_CHAR, dt->escape_char);
+    if(dt->strip_whitespace)
+      sv_set_option(t, SV_OPTION_STRIP_WHITESPACE, 1L);
+    if(dt->strip_whitespace == 2)
+      sv_set_option(t, SV_OPTION_STRIP_WHITESPACE, 0L);
+
+    svtest_parse_in_chunks(t, dt->data, strlen(dt->data), strlen(dt->data));
+
+    if(!got.buffer || strcmp(got.buffer, dt->expected)) {
+      fprintf(stderr, "%s: Test Dialect Options FAIL - test %d got rows '%s' expected '%s'\n",
+              program, i, got.buffer ? got.buffer : "", dt->expected);
+      rc = 1;
     }
-    if (svtest_run_field_size_limit() != 0) {
+
+    sv_free(t);
+    if(got.buffer)
+      free(got.buffer);
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Dialect Options OK\n", program);
+
+  return rc;
+}
+
+
+#define SVTEST_PARALLEL_THREADS 4
+#define SVTEST_PARALLEL_FILE "svtest-parallel.csv"
+
+/* structure used for unordered parallel test callback */
+typedef struct
+{
+  /* per thread row count and sum of row hashes */
+  unsigned long rows[SVTEST_PARALLEL_THREADS];
+  unsigned long hash_sum[SVTEST_PARALLEL_THREADS];
+  int bad_thread_index;
+} svtest_parallel_context;
+
+
+/* Add an FNV-1a hash of the row to the calling thread's totals */
+static sv_status_t
+svtest_parallel_hash_callback(sv *t, void *user_data,
+                              char** fields, size_t *widths, size_t count)
+{
+  svtest_parallel_context* c = (svtest_parallel_context*)user_data;
+  int ti = sv_get_thread_index(t);
+  unsigned long hash = 2166136261UL;
+  size_t i, j;
+
+  if(ti < 0)
+    ti = 0;
+  if(ti >= SVTEST_PARALLEL_THREADS) {
+    c->bad_thread_index = 1;
+    return SV_STATUS_FAILED;
+  }
+
+  for(i = 0; i < count; i++) {
+    const char* f = fields[i] ? fields[i] : "<NULL>";
+    size_t w = fields[i] ? widths[i] : 6;
+
+    for(j = 0; j < w; j++)
+      hash = ((hash ^ (unsigned char)f[j]) * 16777619UL) & 0xFFFFFFFFUL;
+    hash = ((hash ^ '|') * 16777619UL) & 0xFFFFFFFFUL;
+  }
+
+  c->rows[ti]++;
+  c->hash_sum[ti] += hash;
+  return SV_STATUS_OK;
+}
+
+
+/* Write a CSV file with quoted cells, embedded newlines, CRLFs,
+ * comments and blank lines
+ */
+static int
+svtest_write_parallel_file(const char* path, char** data_p, size_t* len_p)
+{
+  svtest_collector out;
+  unsigned int i;
+  FILE* fh;
+  int rc = 0;
+
+  memset(&out, '\0', sizeof(out));
+  if(svtest_collector_add(&out, "id,name,note\n", 13))
+    return 1;
+
+  for(i = 0; i < 20000 && !rc; i++) {
+    char row[128];
+
+    switch(i % 7) {
+      case 0:
+        sprintf(row, "%u,\"name, %u\",plain\n", i, i);
+        break;
+      case 1:
+        sprintf(row, "%u,\"say \"\"%u\"\"\",\"two\nlines\"\r\n", i, i);
+        break;
+      case 2:
+        sprintf(row, "#comment %u \"\n", i);
+        break;
+      case 3:
+        sprintf(row, "%u,,\"\"\n\n", i);
+        break;
+      case 4:
+        sprintf(row, "%u,\"a\nb,\nc\",NA\n", i);
+        break;
+      default:
+        sprintf(row, "%u,x%u,y\n", i, i);
+        break;
+    }
+    rc = svtest_collector_add(&out, row, strlen(row));
+  }
+
+  if(!rc) {
+    fh = fopen(path, "wb");
+    if(!fh)
+      rc = 1;
+    else {
+      if(fwrite(out.buffer, 1, out.len, fh) != out.len)
+        rc = 1;
+      fclose(fh);
+    }
+  }
+
+  if(rc) {
+    free(out.buffer);
+    return rc;
+  }
+
+  *data_p = out.buffer;
+  *len_p = out.len;
+  return 0;
+}
+
+
+/* Parallel parsing gives the same rows, comments and order (when
+ * ordered) as parsing the file in one chunk
+ */
+static int svtest_run_parallel(void) {
+  char* data = NULL;
+  size_t len = 0;
+  svtest_collector expected;
+  svtest_collector got;
+  svtest_parallel_context expected_hash;
+  svtest_parallel_context got_hash;
+  unsigned long expected_rows = 0;
+  unsigned long got_rows = 0;
+  unsigned long expected_sum = 0;
+  unsigned long got_sum = 0;
+  unsigned int i;
+  sv *t;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Parallel...\n");
+
+  memset(&expected, '\0', sizeof(expected));
+  memset(&got, '\0', sizeof(got));
+  memset(&expected_hash, '\0', sizeof(expected_hash));
+  memset(&got_hash, '\0', sizeof(got_hash));
+
+  if(svtest_write_parallel_file(SVTEST_PARALLEL_FILE, &data, &len)) {
+    fprintf(stderr, "%s: Test Parallel FAIL - failed to write %s\n",
+            program, SVTEST_PARALLEL_FILE);
+    return 1;
+  }
+
+  /* expected: one chunk in one thread */
+  t = sv_new(&expected, NULL, svtest_collect_callback, ',');
+  sv_set_option(t, SV_OPTION_COMMENT_PREFIX, "#");
+  sv_set_option(t, SV_OPTION_COMMENT_CALLBACK, svtest_collect_line_callback);
+  svtest_parse_in_chunks(t, data, len, len);
+  sv_free(t);
+
+  /* ordered */
+  t = sv_new(&got, NULL, svtest_collect_callback, ',');
+  sv_set_option(t, SV_OPTION_COMMENT_PREFIX, "#");
+  sv_set_option(t, SV_OPTION_COMMENT_CALLBACK, svtest_collect_line_callback);
+  if(sv_parse_file_parallel(t, SVTEST_PARALLEL_FILE,
+                            SVTEST_PARALLEL_THREADS, 1)) {
+    fprintf(stderr, "%s: Test Parallel FAIL - ordered parse failed\n",
+            program);
+    rc = 1;
+  } else if(!expected.buffer || !got.buffer ||
+            strcmp(expected.buffer, got.buffer)) {
+    fprintf(stderr, "%s: Test Parallel FAIL - ordered parse got %d rows expected %d\n",
+            program, got.rows_count, expected.rows_count);
+    rc = 1;
+  }
+  sv_free(t);
+
+  /* ordered with skipped rows before the header */
+  if(expected.buffer)
+    free(expected.buffer);
+  if(got.buffer)
+    free(got.buffer);
+  memset(&expected, '\0', sizeof(expected));
+  memset(&got, '\0', sizeof(got));
+
+  t = sv_new(&expected, NULL, svtest_collect_callback, ',');
+  sv_set_option(t, SV_OPTION_SKIP_ROWS, 3L);
+  svtest_parse_in_chunks(t, data, len, len);
+  sv_free(t);
+
+  t = sv_new(&got, NULL, svtest_collect_callback, ',');
+  sv_set_option(t, SV_OPTION_SKIP_ROWS, 3L);
+  if(sv_parse_file_parallel(t, SVTEST_PARALLEL_FILE,
+                            SVTEST_PARALLEL_THREADS, 1)) {
+    fprintf(stderr, "%s: Test Parallel FAIL - skip rows parse failed\n",
+            program);
+    rc = 1;
+  } else if(!expected.buffer || !got.buffer ||
+            strcmp(expected.buffer, got.buffer)) {
+    fprintf(stderr, "%s: Test Parallel FAIL - skip rows parse got %d rows expected %d\n",
+            program, got.rows_count, expected.rows_count);
+    rc = 1;
+  }
+  sv_free(t);
+
+  /* unordered: compare row counts and hashes */
+  t = sv_new(&expected_hash, NULL, svtest_parallel_hash_callback, ',');
+  svtest_parse_in_chunks(t, data, len, len);
+  sv_free(t);
+
+  t = sv_new(&got_hash, NULL, svtest_parallel_hash_callback, ',');
+  if(sv_parse_file_parallel(t, SVTEST_PARALLEL_FILE,
+                            SVTEST_PARALLEL_THREADS, 0)) {
+    fprintf(stderr, "%s: Test Parallel FAIL - unordered parse failed\n",
+            program);
+    rc = 1;
+  }
+  sv_free(t);
+
+  for(i = 0; i < SVTEST_PARALLEL_THREADS; i++) {
+    expected_rows += expected_hash.rows[i];
+    expected_sum += expected_hash.hash_sum[i];
+    got_rows += got_hash.rows[i];
+    got_sum += got_hash.hash_sum[i];
+  }
+  if(got_hash.bad_thread_index || got_rows != expected_rows ||
+     got_sum != expected_sum) {
+    fprintf(stderr, "%s: Test Parallel FAIL - unordered parse got %lu rows expected %lu\n",
+            program, got_rows, expected_rows);
+    rc = 1;
+  }
+
+  remove(SVTEST_PARALLEL_FILE);
+  free(data);
+  if(expected.buffer)
+    free(expected.buffer);
+  if(got.buffer)
+    free(got.buffer);
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Parallel OK\n", program);
+
+  return rc;
+}
+
+
+#define SVTEST_PARSE_FILE "svtest-parse-file.csv"
+
+/* sv_parse_file() and sv_parse_fd() on a pipe give the same rows as
+ * sv_parse_chunk()
+ */
+static int svtest_run_parse_file(void) {
+  static const char data[] = "a,b,c\n1,\"x\ny\",3\r\n4,5,6";
+  svtest_collector expected;
+  svtest_collector got;
+  FILE* fh;
+  sv *t;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Parse File...\n");
+
+  memset(&expected, '\0', sizeof(expected));
+  t = sv_new(&expected, NULL, svtest_collect_callback, ',');
+  svtest_parse_in_chunks(t, data, sizeof(data) - 1, sizeof(data) - 1);
+  sv_free(t);
+
+  fh = fopen(SVTEST_PARSE_FILE, "wb");
+  if(!fh || fwrite(data, 1, sizeof(data) - 1, fh) != sizeof(data) - 1) {
+    fprintf(stderr, "%s: Test Parse File FAIL - failed to write %s\n",
+            program, SVTEST_PARSE_FILE);
+    if(fh)
+      fclose(fh);
+    free(expected.buffer);
+    return 1;
+  }
+  fclose(fh);
+
+  memset(&got, '\0', sizeof(got));
+  t = sv_new(&got, NULL, svtest_collect_callback, ',');
+  if(sv_parse_file(t, SVTEST_PARSE_FILE) ||
+     !got.buffer || strcmp(got.buffer, expected.buffer)) {
+    fprintf(stderr, "%s: Test Parse File FAIL - file got rows '%s' expected '%s'\n",
+            program, got.buffer ? got.buffer : "", expected.buffer);
+    rc = 1;
+  }
+  sv_free(t);
+  if(got.buffer)
+    free(got.buffer);
+
+  t = sv_new(NULL, NULL, NULL, ',');
+  if(sv_parse_file(t, SVTEST_PARSE_FILE ".missing") == SV_STATUS_OK) {
+    fprintf(stderr, "%s: Test Parse File FAIL - missing file succeeded\n",
+            program);
+    rc = 1;
+  }
+  sv_free(t);
+
+#ifdef HAVE_UNISTD_H
+  if(1) {
+    int fds[2];
+
+    memset(&got, '\0', sizeof(got));
+    /* data fits in the pipe buffer so can be written before reading */
+    if(pipe(fds) ||
+       write(fds[1], data, sizeof(data) - 1) != (ssize_t)(sizeof(data) - 1)) {
+      fprintf(stderr, "%s: Test Parse File FAIL - pipe failed\n", program);
+      rc = 1;
+    } else {
+      close(fds[1]);
+      t = sv_new(&got, NULL, svtest_collect_callback, ',');
+      if(sv_parse_fd(t, fds[0]) ||
+         !got.buffer || strcmp(got.buffer, expected.buffer)) {
+        fprintf(stderr, "%s: Test Parse File FAIL - pipe got rows '%s' expected '%s'\n",
+                program, got.buffer ? got.buffer : "", expected.buffer);
+        rc = 1;
+      }
+      sv_free(t);
+      close(fds[0]);
+    }
+    if(got.buffer)
+      free(got.buffer);
+  }
+#endif
+
+#if defined(HAVE_UNISTD_H) && defined(HAVE_FCNTL_H)
+  /* parsing starts at the fd offset: after a preamble shorter and
+   * longer than a page
+   */
+  if(1) {
+    static const size_t preamble_lens[2] = { 10, 5000 };
+    unsigned int i;
+
+    for(i = 0; i < 2; i++) {
+      size_t preamble_len = preamble_lens[i];
+      size_t j;
+      int fd;
+
+      fh = fopen(SVTEST_PARSE_FILE, "wb");
+      if(!fh) {
+        rc = 1;
+        break;
+      }
+      for(j = 0; j < preamble_len - 1; j++)
+        fputc('#', fh);
+      fputc('\n', fh);
+      fwrite(data, 1, sizeof(data) - 1, fh);
+      fclose(fh);
+
+      memset(&got, '\0', sizeof(got));
+      fd = open(SVTEST_PARSE_FILE, O_RDONLY);
+      if(fd < 0 || lseek(fd, (off_t)preamble_len, SEEK_SET) < 0) {
+        fprintf(stderr, "%s: Test Parse File FAIL - failed to open %s\n",
+                program, SVTEST_PARSE_FILE);
+        rc = 1;
+      } else {
+        t = sv_new(&got, NULL, svtest_collect_callback, ',');
+        if(sv_parse_fd(t, fd) ||
+           !got.buffer || strcmp(got.buffer, expected.buffer)) {
+          fprintf(stderr, "%s: Test Parse File FAIL - offset %zu got rows '%s' expected '%s'\n",
+                  program, preamble_len, got.buffer ? got.buffer : "",
+                  expected.buffer);
+          rc = 1;
+        }
+        if(lseek(fd, 0, SEEK_CUR) !=
+           (off_t)(preamble_len + sizeof(data) - 1)) {
+          fprintf(stderr, "%s: Test Parse File FAIL - offset %zu not left at the end\n",
+                  program, preamble_len);
+          rc = 1;
+        }
+        sv_free(t);
+      }
+      if(fd >= 0)
+        close(fd);
+      if(got.buffer)
+        free(got.buffer);
+    }
+  }
+#endif
+
+  remove(SVTEST_PARSE_FILE);
+  free(expected.buffer);
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Parse File OK\n", program);
+
+  return rc;
+}
+
+
+/* structure used for column selection tests */
+typedef struct
+{
+  const char* data;
+  /* selected column indexes or if NULL, names */
+  const int* columns;
+  const char* const* names;
+  int count;
+  int save_header;
+  /* expected data rows and if not NULL, headers joined by | */
+  const char* expected;
+  const char* expected_headers;
+} svtest_select_test;
+
+static const int select_reorder[3] = { 2, 0, 2 };
+static const int select_missing[2] = { 1, 5 };
+static const char* const select_names[3] = { "c", "zz", "a" };
+
+static const svtest_select_test select_tests[] = {
+  /* reorder and duplicate, quoted unselected cells with separators */
+  { "a,b,c\n1,\"x,\"\"y\",3\n4,5,6\n", select_reorder, NULL, 3, 1,
+    "3|1|3\n6|4|6\n", "c|a|c" },
+  /* rows with fewer cells give empty fields */
+  { "1,2\n3\n4,5,6,7,8,9\n", select_missing, NULL, 2, 0,
+    "2|\n|\n5|9\n", NULL },
+  /* names; a name not in the header is a missing column */
+  { "a,b,c\n1,2,3\n\"4\",,6\n", NULL, select_names, 3, 1,
+    "3||1\n6||4\n", "c||a" }
+};
+#define N_SELECT_TESTS (int)(sizeof(select_tests) / sizeof(select_tests[0]))
+
+
+static int svtest_run_select_columns(void) {
+  static const size_t chunk_sizes[2] = { 0, 1 };
+  svtest_collector got;
+  int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Select Columns...\n");
+
+  for(i = 0; i < N_SELECT_TESTS * 2; i++) {
+    const svtest_select_test* st = &select_tests[i / 2];
+    size_t len = strlen(st->data);
+    size_t chunk_size = chunk_sizes[i % 2] ? chunk_sizes[i % 2] : len;
+    sv *t;
+
+    memset(&got, '\0', sizeof(got));
+    t = sv_new(&got, NULL, svtest_collect_callback, ',');
+    if(!t) {
+      fprintf(stderr, "%s: Test Select Columns FAIL - sv_new() failed\n",
+              program);
+      return 1;
+    }
+    sv_set_option(t, SV_OPTION_SAVE_HEADER, (long)st->save_header);
+    if(st->columns)
+      sv_set_option(t, SV_OPTION_SELECT_COLUMNS, st->columns, st->count);
+    else
+      sv_set_option(t, SV_OPTION_SELECT_COLUMN_NAMES, st->names, st->count);
+
+    svtest_parse_in_chunks(t, st->data, len, chunk_size);
+
+    if(!got.buffer || strcmp(got.buffer, st->expected)) {
+      fprintf(stderr, "%s: Test Select Columns FAIL - test %d got rows '%s' expected '%s'\n",
+              program, i, got.buffer ? got.buffer : "", st->expected);
+      rc = 1;
+    }
+
+    if(st->expected_headers) {
+      char headers[64];
+      size_t hlen = 0;
+      unsigned int h;
+
+      for(h = 0; h < (unsigned int)st->count; h++) {
+        const char* header = sv_get_header(t, h, NULL);
+
+        hlen += (size_t)snprintf(headers + hlen, sizeof(headers) - hlen,
+                                 "%s%s", h ? "|" : "",
+                                 header ? header : "<NULL>");
+      }
+      if(strcmp(headers, st->expected_headers) ||
+         sv_get_header(t, (unsigned int)st->count, NULL)) {
+        fprintf(stderr, "%s: Test Select Columns FAIL - test %d got headers '%s' expected '%s'\n",
+                program, i, headers, st->expected_headers);
+        rc = 1;
+      }
+    }
+
+    sv_free(t);
+    if(got.buffer)
+      free(got.buffer);
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Select Columns OK\n", program);
+
+  return rc;
+}
+
+
+/* structure used for record counting tests */
+typedef struct
+{
+  char escape_char;
+  int skip_rows;
+  const char* comment_prefix;
+  const char* data;
+  size_t bad_records;
+  size_t bad_offset;
+} svtest_count_test;
+
+static const svtest_count_test count_tests[] = {
+  { 0, 0, NULL, "a,b,c\n1,\"2,\n\"\"x\",3\r\n\n4,5\n6", 0, SV_COUNT_NO_OFFSET },
+  { 0, 0, NULL, ",,\n  \" a \" ,b\n\n\n", 0, SV_COUNT_NO_OFFSET },
+  /* quote followed by x then an unfinished quoted cell */
+  { 0, 0, NULL, "a,\"b\"x,c\n1,2\n3,\"4\n5\n", 2, 5 },
+  { '\\', 0, NULL, "a\\,b,c\n\"x\\\"y\",z\nq\\", 1, 17 },
+  { 0, 2, "#", "s1\n\"s\n2\"\n#c,d\n1,2,3\n#\"x,y\"\n4\n", 0,
+    SV_COUNT_NO_OFFSET },
+  { 0, 0, NULL, "", 0, SV_COUNT_NO_OFFSET }
+};
+#define N_COUNT_TESTS (int)(sizeof(count_tests) / sizeof(count_tests[0]))
+
+
+/* Count records and fields seen by the parser */
+static sv_status_t
+svtest_count_fields_callback(sv *t, void *user_data,
+                             char** fields, size_t *widths, size_t count)
+{
+  sv_record_counts* c = (sv_record_counts*)user_data;
+
+  if(!c->records || count < c->min_fields)
+    c->min_fields = count;
+  if(count > c->max_fields)
+    c->max_fields = count;
+  c->records++;
+  return SV_STATUS_OK;
+}
+
+
+static int svtest_run_count_records(void) {
+  sv_record_counts counts;
+  int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Count Records...\n");
+
+  for(i = 0; i < N_COUNT_TESTS; i++) {
+    const svtest_count_test* ct = &count_tests[i];
+    size_t len = strlen(ct->data);
+    sv_record_counts parsed;
+    sv *t;
+
+    memset(&parsed, '\0', sizeof(parsed));
+    t = sv_new(&parsed, NULL, svtest_count_fields_callback, ',');
+    if(!t) {
+      fprintf(stderr, "%s: Test Count Records FAIL - sv_new() failed\n",
+              program);
+      return 1;
+    }
+    sv_set_option(t, SV_OPTION_SAVE_HEADER, 0L);
+    sv_set_option(t, SV_OPTION_STRIP_WHITESPACE, 1L);
+    if(ct->escape_char)
+      sv_set_option(t, SV_OPTION_ESCAPE_CHAR, ct->escape_char);
+    if(ct->skip_rows)
+      sv_set_option(t, SV_OPTION_SKIP_ROWS, ct->skip_rows);
+    if(ct->comment_prefix)
+      sv_set_option(t, SV_OPTION_COMMENT_PREFIX, ct->comment_prefix);
+
+    /* count before parsing to check it uses no parser state */
+    if(sv_count_records(t, ct->data, len, &counts)) {
+      fprintf(stderr, "%s: Test Count Records FAIL - test %d failed\n",
+              program, i);
+      rc = 1;
+    }
+    svtest_parse_in_chunks(t, ct->data, len, len);
+
+    if(counts.records != parsed.records ||
+       counts.min_fields != parsed.min_fields ||
+       counts.max_fields != parsed.max_fields) {
+      fprintf(stderr, "%s: Test Count Records FAIL - test %d counted %zu records of %zu..%zu fields, parsed %zu records of %zu..%zu fields\n",
+              program, i, counts.records, counts.min_fields,
+              counts.max_fields, parsed.records, parsed.min_fields,
+              parsed.max_fields);
+      rc = 1;
+    }
+    if(counts.bad_records != ct->bad_records ||
+       counts.bad_offset != ct->bad_offset) {
+      fprintf(stderr, "%s: Test Count Records FAIL - test %d got %zu bad records at %zu, expected %zu at %zu\n",
+              program, i, counts.bad_records, counts.bad_offset,
+              ct->bad_records, ct->bad_offset);
+      rc = 1;
+    }
+
+    sv_free(t);
+  }
+
+  if(sv_count_records(NULL, "a\n", 2, &counts) != SV_STATUS_FAILED) {
+    fprintf(stderr, "%s: Test Count Records FAIL - NULL sv accepted\n",
+            program);
+    rc = 1;
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Count Records OK\n", program);
+
+  return rc;
+}
+
+
+/* Append the rows of a batch to a collector as fields joined by |
+ * and check the null counts
+ */
+static sv_status_t
+svtest_batch_callback(sv *t, void *user_data, sv_batch* batch)
+{
+  svtest_collector* c = (svtest_collector*)user_data;
+  size_t r, i;
+
+  for(i = 0; i < batch->columns; i++) {
+    const sv_batch_column* col = &batch->column[i];
+    size_t nulls = 0;
+
+    for(r = 0; r < batch->rows; r++) {
+      if(!(col->validity[r / 8] & (1 << (r % 8))))
+        nulls++;
+    }
+    if(nulls != col->null_count)
+      return SV_STATUS_FAILED;
+  }
+
+  for(r = 0; r < batch->rows; r++) {
+    for(i = 0; i < batch->columns; i++) {
+      const sv_batch_column* col = &batch->column[i];
+
+      if(i > 0 && svtest_collector_add(c, "|", 1))
+        return SV_STATUS_NO_MEMORY;
+      if(!(col->validity[r / 8] & (1 << (r % 8)))) {
+        if(svtest_collector_add(c, "<NULL>", 6))
+          return SV_STATUS_NO_MEMORY;
+      } else if(svtest_collector_add(c, col->data + col->offsets[r],
+                                     col->offsets[r + 1] - col->offsets[r]))
+        return SV_STATUS_NO_MEMORY;
+    }
+    if(svtest_collector_add(c, "\n", 1))
+      return SV_STATUS_NO_MEMORY;
+  }
+
+  /* rows_count counts batches */
+  c->rows_count++;
+  return SV_STATUS_OK;
+}
+
+
+static int svtest_run_batch_callback(void) {
+  static const char data[] =
+    "a,b,c\n1,,3\n4,5\n6,7,8,9\n\"x,y\",z,w\n10,11,12\n";
+  static const size_t chunk_sizes[2] = { 0, 1 };
+  /* rows short of the 3 header columns or of a longer row in the
+   * same batch have NULLs
+   */
+  const char* expected =
+    "1|<NULL>|3\n4|5|<NULL>\n6|7|8|9\nx,y|z|w|<NULL>\n10|11|12\n";
+  svtest_collector got;
+  unsigned int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Batch Callback...\n");
+
+  for(i = 0; i < 2; i++) {
+    size_t len = sizeof(data) - 1;
+    size_t chunk_size = chunk_sizes[i] ? chunk_sizes[i] : len;
+    sv *t;
+
+    memset(&got, '\0', sizeof(got));
+    t = sv_new(&got, NULL, svtest_collect_callback, ',');
+    if(!t) {
+      fprintf(stderr, "%s: Test Batch Callback FAIL - sv_new() failed\n",
+              program);
+      return 1;
+    }
+    sv_set_option(t, SV_OPTION_NULL_HANDLING, 1L);
+    sv_set_option(t, SV_OPTION_BATCH_CALLBACK, svtest_batch_callback);
+    sv_set_option(t, SV_OPTION_BATCH_SIZE, 2L);
+
+    if(svtest_parse_in_chunks(t, data, len, chunk_size)) {
+      fprintf(stderr, "%s: Test Batch Callback FAIL - parse failed\n",
+              program);
+      rc = 1;
+    }
+
+    if(!got.buffer || strcmp(got.buffer, expected)) {
+      fprintf(stderr, "%s: Test Batch Callback FAIL - chunk size %zu got rows '%s' expected '%s'\n",
+              program, chunk_size, got.buffer ? got.buffer : "", expected);
+      rc = 1;
+    }
+    /* 2 full batches and 1 partial batch at end of input */
+    if(got.rows_count != 3) {
+      fprintf(stderr, "%s: Test Batch Callback FAIL - got %d batches expected 3\n",
+              program, got.rows_count);
+      rc = 1;
+    }
+
+    sv_free(t);
+    if(got.buffer)
+      free(got.buffer);
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Batch Callback OK\n", program);
+
+  return rc;
+}
+
+
+/* Append Arrow string array values joined by | to a collector */
+static int
+svtest_collect_arrow_column(svtest_collector* c, const struct ArrowArray* a,
+                            int offset_size)
+{
+  const unsigned char* validity = (const unsigned char*)a->buffers[0];
+  const char* data = (const char*)a->buffers[2];
+  int64_t r;
+
+  for(r = 0; r < a->length; r++) {
+    int64_t start, end;
+
+    if(r > 0 && svtest_collector_add(c, "|", 1))
+      return 1;
+    if(validity && !(validity[r / 8] & (1 << (r % 8)))) {
+      if(svtest_collector_add(c, "<NULL>", 6))
+        return 1;
+      continue;
+    }
+    if(offset_size == 4) {
+      start = ((const int32_t*)a->buffers[1])[r];
+      end = ((const int32_t*)a->buffers[1])[r + 1];
+    } else {
+      start = ((const int64_t*)a->buffers[1])[r];
+      end = ((const int64_t*)a->buffers[1])[r + 1];
+    }
+    if(svtest_collector_add(c, data + start, (size_t)(end - start)))
+      return 1;
+  }
+
+  return svtest_collector_add(c, "\n", 1);
+}
+
+
+static int svtest_run_table(void) {
+  static const char data[] =
+    "name,age\nalice,30\nbob,NA\ncarol\n\"d,e\",,extra\n";
+  /* each column then the column names */
+  const char* expected =
+    "alice|bob|carol|d,e\n30|<NULL>|<NULL>|<NULL>\n<NULL>|<NULL>|<NULL>|extra\n"
+    "name|age|\n";
+  static const int offset_sizes[2] = { 4, 8 };
+  unsigned int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Table...\n");
+
+  for(i = 0; i < 2; i++) {
+    int offset_size = offset_sizes[i];
+    svtest_collector got;
+    struct ArrowArray array;
+    struct ArrowSchema schema;
+    sv_table* table;
+    sv *t;
+    int64_t c;
+
+    memset(&got, '\0', sizeof(got));
+    table = sv_table_new(offset_size);
+    t = table ? sv_new(table, NULL, sv_table_data_callback, ',') : NULL;
+    if(!t) {
+      fprintf(stderr, "%s: Test Table FAIL - sv_new() failed\n", program);
+      sv_table_free(table);
+      return 1;
+    }
+
+    svtest_parse_in_chunks(t, data, sizeof(data) - 1, 5);
+
+    if(sv_table_get_rows(table) != 4 || sv_table_get_columns(table) != 3) {
+      fprintf(stderr, "%s: Test Table FAIL - got %zu rows of %zu columns expected 4 of 3\n",
+              program, sv_table_get_rows(table),
+              sv_table_get_columns(table));
+      rc = 1;
+    } else if(sv_table_export(table, &array, &schema)) {
+      fprintf(stderr, "%s: Test Table FAIL - sv_table_export() failed\n",
+              program);
+      rc = 1;
+    } else {
+      for(c = 0; c < array.n_children; c++)
+        svtest_collect_arrow_column(&got, array.children[c], offset_size);
+      for(c = 0; c < schema.n_children; c++) {
+        if(c > 0)
+          svtest_collector_add(&got, "|", 1);
+        svtest_collector_add(&got, schema.children[c]->name,
+                             strlen(schema.children[c]->name));
+        if(strcmp(schema.children[c]->format, offset_size == 4 ? "u" : "U"))
+          rc = 1;
+      }
+      svtest_collector_add(&got, "\n", 1);
+
+      if(rc || strcmp(schema.format, "+s") || array.length != 4 ||
+         array.children[1]->null_count != 3 ||
+         !got.buffer || strcmp(got.buffer, expected)) {
+        fprintf(stderr, "%s: Test Table FAIL - offset size %d got '%s' expected '%s'\n",
+                program, offset_size, got.buffer ? got.buffer : "",
+                expected);
+        rc = 1;
+      }
+
+      /* exported so the table is empty */
+      if(sv_table_get_rows(table) || sv_table_get_columns(table)) {
+        fprintf(stderr, "%s: Test Table FAIL - table not empty after export\n",
+                program);
+        rc = 1;
+      }
+
+      array.release(&array);
+      schema.release(&schema);
+    }
+
+    sv_free(t);
+    sv_table_free(table);
+    if(got.buffer)
+      free(got.buffer);
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Table OK\n", program);
+
+  return rc;
+}
+
+
+/* Append Arrow int64, float64 or bool array values joined by | to a
+ * collector
+ */
+static int
+svtest_collect_arrow_typed(svtest_collector* c, const struct ArrowArray* a,
+                           const char* format)
+{
+  const unsigned char* validity = (const unsigned char*)a->buffers[0];
+  int64_t r;
+
+  for(r = 0; r < a->length; r++) {
+    char buffer[32];
+
+    if(r > 0 && svtest_collector_add(c, "|", 1))
+      return 1;
+    if(validity && !(validity[r / 8] & (1 << (r % 8))))
+      strcpy(buffer, "<NULL>");
+    else if(*format == 'l')
+      sprintf(buffer, "%lld", (long long)((const int64_t*)a->buffers[1])[r]);
+    else if(*format == 'g')
+      sprintf(buffer, "%g", ((const double*)a->buffers[1])[r]);
+    else
+      strcpy(buffer, (((const unsigned char*)a->buffers[1])[r / 8] &
+                      (1 << (r % 8))) ? "true" : "false");
+    if(svtest_collector_add(c, buffer, strlen(buffer)))
+      return 1;
+  }
+
+  return svtest_collector_add(c, "\n", 1);
+}
+
+
+static int svtest_run_table_infer(void) {
+  static const char data[] =
+    "i,f,b,s,p,d,e\n"
+    "1,1.5,true,x,1,5,0.1\n"
+    "-2,NA,FALSE,y,2,6,007\n"
+    "3,2,true,z,2.5,seven,9007199254740993\n"
+    ",4e2,false,w,3,8,1.5\n"
+    "5,6,true,v,4,9,abc\n";
+  /* p changes from int64 to float64, d from int64 to string and e
+   * from float64 to string with the values as they were parsed after
+   * sampling 2 rows; sampling all rows gives the same types
+   */
+  const char* expected =
+    "l:1|-2|3|<NULL>|5\n"
+    "g:1.5|<NULL>|2|400|6\n"
+    "b:true|false|true|false|true\n"
+    "u:x|y|z|w|v\n"
+    "g:1|2|2.5|3|4\n"
+    "u:5|6|seven|8|9\n"
+    "u:0.1|007|9007199254740993|1.5|abc\n";
+  static const size_t infer_rows[2] = { 2, 100 };
+  unsigned int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Table Infer...\n");
+
+  for(i = 0; i < 2; i++) {
+    svtest_collector got;
+    struct ArrowArray array;
+    struct ArrowSchema schema;
+    sv_table* table;
+    sv *t;
+    int64_t c;
+
+    memset(&got, '\0', sizeof(got));
+    table = sv_table_new(4);
+    t = table ? sv_new(table, NULL, sv_table_data_callback, ',') : NULL;
+    if(!t) {
+      fprintf(stderr, "%s: Test Table Infer FAIL - sv_new() failed\n",
+              program);
+      sv_table_free(table);
+      return 1;
+    }
+    sv_table_set_infer_rows(table, infer_rows[i]);
+
+    svtest_parse_in_chunks(t, data, sizeof(data) - 1, sizeof(data) - 1);
+
+    if(sv_table_export(table, &array, &schema)) {
+      fprintf(stderr, "%s: Test Table Infer FAIL - sv_table_export() failed\n",
+              program);
+      rc = 1;
+    } else {
+      for(c = 0; c < array.n_children; c++) {
+        const char* format = schema.children[c]->format;
+
+        svtest_collector_add(&got, format, strlen(format));
+        svtest_collector_add(&got, ":", 1);
+        if(*format == 'u')
+          svtest_collect_arrow_column(&got, array.children[c], 4);
+        else
+          svtest_collect_arrow_typed(&got, array.children[c], format);
+      }
+
+      if(!got.buffer || strcmp(got.buffer, expected)) {
+        fprintf(stderr, "%s: Test Table Infer FAIL - sampling %zu rows got '%s' expected '%s'\n",
+                program, infer_rows[i], got.buffer ? got.buffer : "",
+                expected);
+        rc = 1;
+      }
+
+      array.release(&array);
+      schema.release(&schema);
+    }
+
+    sv_free(t);
+    sv_table_free(table);
+    if(got.buffer)
+      free(got.buffer);
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Table Infer OK\n", program);
+
+  return rc;
+}
+
+
+static int svtest_run_field_to_int64(void) {
+  static const struct {
+    const char* field;
+    int ok;
+    int64_t value;
+  } cases[] = {
+    { "0", 1, 0 },
+    { "-0", 1, 0 },
+    { "+7", 1, 7 },
+    { "12345678", 1, 12345678 },
+    { "-123456789", 1, -123456789 },
+    { "1234567890123456", 1, 1234567890123456LL },
+    { "00000000000000000000000042", 1, 42 },
+    { "9223372036854775807", 1, INT64_MAX },
+    { "-9223372036854775808", 1, INT64_MIN },
+    { "9223372036854775808", 0, 0 },
+    { "-9223372036854775809", 0, 0 },
+    { "10000000000000000000", 0, 0 },
+    { "99999999999999999999", 0, 0 },
+    { "", 0, 0 },
+    { "-", 0, 0 },
+    { "+-1", 0, 0 },
+    { " 1", 0, 0 },
+    { "1 ", 0, 0 },
+    { "1234567a", 0, 0 },
+    { "12345678:", 0, 0 },
+    { "1234/678", 0, 0 },
+    { "1.5", 0, 0 },
+    { "0x10", 0, 0 }
+  };
+  const unsigned int ncases = sizeof(cases) / sizeof(cases[0]);
+  char* fields[3];
+  size_t widths[3];
+  int64_t values[3];
+  unsigned char ok[3];
+  /* fields are not NUL terminated: trailing digits must be ignored */
+  char row[] = "12345678901234567,x,-42";
+  unsigned int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Field To Int64...\n");
+
+  for(i = 0; i < ncases; i++) {
+    int64_t value = -1;
+    sv_status_t status;
+
+    status = sv_field_to_int64(cases[i].field, strlen(cases[i].field), &value);
+    if((status == SV_STATUS_OK) != cases[i].ok ||
+       (cases[i].ok && value != cases[i].value)) {
+      fprintf(stderr, "%s: Test Field To Int64 FAIL - '%s' got status %d value %lld\n",
+              program, cases[i].field, (int)status, (long long)value);
+      rc = 1;
+    }
+  }
+
+  fields[0] = row; widths[0] = 9;
+  fields[1] = row + 18; widths[1] = 1;
+  fields[2] = NULL; widths[2] = 0;
+  if(sv_fields_to_int64(fields, widths, 3, values, ok) == SV_STATUS_OK ||
+     !ok[0] || values[0] != 123456789 || ok[1] || values[1] || ok[2]) {
+    fprintf(stderr, "%s: Test Field To Int64 FAIL - sv_fields_to_int64() mixed fields\n",
+            program);
+    rc = 1;
+  }
+
+  fields[1] = row + 20; widths[1] = 3;
+  fields[2] = row + 10; widths[2] = 7;
+  if(sv_fields_to_int64(fields, widths, 3, values, NULL) != SV_STATUS_OK ||
+     values[1] != -42 || values[2] != 1234567) {
+    fprintf(stderr, "%s: Test Field To Int64 FAIL - sv_fields_to_int64() all fields\n",
+            program);
+    rc = 1;
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Field To Int64 OK\n", program);
+
+  return rc;
+}
+
+
+static int svtest_run_field_to_double(void) {
+  static const struct {
+    const char* field;
+    int ok;
+    double value;
+  } cases[] = {
+    { "0", 1, 0.0 },
+    { "-0.0", 1, -0.0 },
+    { "1.5", 1, 1.5 },
+    { "+.25", 1, 0.25 },
+    { "7.", 1, 7.0 },
+    { "0.1", 1, 0.1 },
+    { "-123.456e-2", 1, -1.23456 },
+    { "1e23", 1, 1e23 },
+    { "9007199254740993", 1, 9007199254740992.0 },
+    { "0.000000000000000000000000000000001234", 1, 1.234e-33 },
+    { "12345678901234567890123", 1, 1.2345678901234568e22 },
+    { "1.7976931348623157e308", 1, 1.7976931348623157e308 },
+    { "2.2250738585072014e-308", 1, 2.2250738585072014e-308 },
+    { "4.9e-324", 1, 4.9e-324 },
+    { "1e400", 1, HUGE_VAL },
+    { "-Infinity", 1, -HUGE_VAL },
+    /* longer than the strtod() stack buffer */
+    { "100000000000000000000000000000000000000000000000000000000000000000000",
+      1, 1e68 },
+    { "0.1000000000000000000000000000000000000000000000000000000000000000001",
+      1, 0.1 },
+    { "1000000000000000000000000000000000000000000000000000000000000000000x",
+      0, 0.0 },
+    { "", 0, 0.0 },
+    { ".", 0, 0.0 },
+    { "-", 0, 0.0 },
+    { "1e", 0, 0.0 },
+    { "1e+", 0, 0.0 },
+    { "e5", 0, 0.0 },
+    { "1.2.3", 0, 0.0 },
+    { " 1", 0, 0.0 },
+    { "1,5", 0, 0.0 },
+    { "0x1p3", 0, 0.0 }
+  };
+  const unsigned int ncases = sizeof(cases) / sizeof(cases[0]);
+  char* fields[2];
+  size_t widths[2];
+  double values[2];
+  unsigned char ok[2];
+  char row[] = "2.5,nan,x";
+  unsigned long seed = 12345;
+  unsigned int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Field To Double...\n");
+
+  for(i = 0; i < ncases; i++) {
+    double value = -1.0;
+    sv_status_t status;
+
+    status = sv_field_to_double(cases[i].field, strlen(cases[i].field),
+                                &value);
+    if((status == SV_STATUS_OK) != cases[i].ok ||
+       (cases[i].ok && memcmp(&value, &cases[i].value, sizeof(value)))) {
+      fprintf(stderr, "%s: Test Field To Double FAIL - '%s' got status %d value %.17g\n",
+              program, cases[i].field, (int)status, value);
+      rc = 1;
+    }
+  }
+
+  /* shortest round trip of many doubles must give back the same bits */
+  for(i = 0; i < 100000 && !rc; i++) {
+    char buffer[32];
+    double d, value = 0.0;
+    int len;
+
+    seed = seed * 1103515245UL + 12345UL;
+    d = (double)(seed % 100000000UL) / (double)(1 + (seed >> 8) % 100000UL);
+    if(i & 1)
+      d *= 1e-30;
+    len = sprintf(buffer, "%.17g", d);
+    if(sv_field_to_double(buffer, (size_t)len, &value) ||
+       memcmp(&value, &d, sizeof(d))) {
+      fprintf(stderr, "%s: Test Field To Double FAIL - '%s' got %.17g\n",
+              program, buffer, value);
+      rc = 1;
+    }
+  }
+
+  /* fields are not NUL terminated */
+  fields[0] = row; widths[0] = 3;
+  fields[1] = row + 4; widths[1] = 5;
+  if(sv_fields_to_double(fields, widths, 2, values, ok) == SV_STATUS_OK ||
+     !ok[0] || values[0] != 2.5 || ok[1] || values[1] != 0.0) {
+    fprintf(stderr, "%s: Test Field To Double FAIL - sv_fields_to_double()\n",
+            program);
+    rc = 1;
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Field To Double OK\n", program);
+
+  return rc;
+}
+
+
+static int svtest_run_field_to_epoch_ns(void) {
+  static const struct {
+    const char* field;
+    int ok;
+    int64_t value;
+  } cases[] = {
+    { "1970-01-01", 1, 0 },
+    { "1970-01-01T00:00:00Z", 1, 0 },
+    { "2026-10-16T12:34:56.789Z", 1, 1792154096789000000LL },
+    { "2026-10-16 12:34:56,789", 1, 1792154096789000000LL },
+    { "2026-10-16t14:34:56.789+02:00", 1, 1792154096789000000LL },
+    { "2026-10-16T07:04:56.789-0530", 1, 1792154096789000000LL },
+    { "2026-10-16T13:34:56.789+01", 1, 1792154096789000000LL },
+    { "2000-02-29T00:00:00.000000001Z", 1, 951782400000000001LL },
+    { "2000-02-29T00:00:00.1234567891Z", 1, 951782400123456789LL },
+    { "1969-12-31T23:59:59.5Z", 1, -500000000LL },
+    { "2016-12-31T23:59:60Z", 1, 1483228800000000000LL },
+    { "1677-09-21T00:12:43.145224192Z", 1, INT64_MIN },
+    { "2262-04-11T23:47:16.854775807Z", 1, INT64_MAX },
+    { "1677-09-21T00:12:43.145224191Z", 0, 0 },
+    { "2262-04-11T23:47:16.854775808Z", 0, 0 },
+    { "1900-02-29", 0, 0 },
+    { "2026-13-01", 0, 0 },
+    { "2026-10-32T00:00:00Z", 0, 0 },
+    { "2026-10-16T24:00:00Z", 0, 0 },
+    { "2026-10-16T12:60:00Z", 0, 0 },
+    { "2026-10-16T12:34:56.Z", 0, 0 },
+    { "2026-10-16T12:34:56+24:00", 0, 0 },
+    { "2026-10-16T12:34:56+1", 0, 0 },
+    { "2026-10-16T12:34:56 ", 0, 0 },
+    { "2026-10-16X12:34:56", 0, 0 },
+    { "2026/10/16T12:34:56", 0, 0 },
+    { "2026-1a-16T12:34:56", 0, 0 },
+    { "2026-10-16T12:34", 0, 0 },
+    { "", 0, 0 }
+  };
+  const unsigned int ncases = sizeof(cases) / sizeof(cases[0]);
+  char* fields[2];
+  size_t widths[2];
+  int64_t values[2];
+  unsigned char ok[2];
+  /* fields are not NUL terminated */
+  char row[] = "1970-01-02T00:00:00.5,1970-01-02Z";
+  unsigned int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Field To Epoch ns...\n");
+
+  for(i = 0; i < ncases; i++) {
+    int64_t value = -1;
+    sv_status_t status;
+
+    status = sv_field_to_epoch_ns(cases[i].field, strlen(cases[i].field),
+                                  &value);
+    if((status == SV_STATUS_OK) != cases[i].ok ||
+       (cases[i].ok && value != cases[i].value)) {
+      fprintf(stderr, "%s: Test Field To Epoch ns FAIL - '%s' got status %d value %lld\n",
+              program, cases[i].field, (int)status, (long long)value);
+      rc = 1;
+    }
+  }
+
+  fields[0] = row; widths[0] = 19;
+  fields[1] = row + 22; widths[1] = 10;
+  if(sv_fields_to_epoch_ns(fields, widths, 2, values, ok) != SV_STATUS_OK ||
+     !ok[0] || values[0] != 86400000000000LL ||
+     !ok[1] || values[1] != 86400000000000LL) {
+    fprintf(stderr, "%s: Test Field To Epoch ns FAIL - sv_fields_to_epoch_ns()\n",
+            program);
+    rc = 1;
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Field To Epoch ns OK\n", program);
+
+  return rc;
+}
+
+
+typedef struct {
+  int32_t id;
+  double price;
+  char ok;
+  int64_t ts;
+  char code[4];
+  sv_string_view name;
+  int16_t small;
+  int64_t absent;
+} svtest_struct_record;
+
+/* Append each filled struct to the collector as a line */
+static sv_status_t
+svtest_struct_callback(sv *t, void *user_data, void* records, size_t count)
+{
+  svtest_collector* c = (svtest_collector*)user_data;
+  svtest_struct_record* r = (svtest_struct_record*)records;
+  size_t i;
+
+  for(i = 0; i < count; i++) {
+    char line[200];
+
+    sprintf(line, "%d|%g|%d|%lld|%s|", (int)r[i].id, r[i].price, r[i].ok,
+            (long long)r[i].ts, r[i].code);
+    if(svtest_collector_add(c, line, strlen(line)))
+      return SV_STATUS_NO_MEMORY;
+    if(!r[i].name.data) {
+      if(svtest_collector_add(c, "<NULL>", 6))
+        return SV_STATUS_NO_MEMORY;
+    } else if(svtest_collector_add(c, r[i].name.data, r[i].name.len))
+      return SV_STATUS_NO_MEMORY;
+    sprintf(line, "|%d|%lld\n", (int)r[i].small, (long long)r[i].absent);
+    if(svtest_collector_add(c, line, strlen(line)))
+      return SV_STATUS_NO_MEMORY;
+  }
+
+  c->rows_count++;
+  return SV_STATUS_OK;
+}
+
+
+static int svtest_run_struct_decode(void) {
+  static const char data[] =
+    "id,price,ok,ts,code,name,small\n"
+    "1,2.5,true,1970-01-01T00:00:01Z,ABCDEFG,alpha,7\n"
+    "-2,1e3,FALSE,1970-01-01T00:00:00.5Z,\"X,Y\",\"be \"\"ta\"\"\",40000\n"
+    "x,,maybe,not a time,,,\n"
+    "4,0.25,true\n"
+    "5,-0,false,1970-01-02,Q,\"long name over several chunks\",-1\n";
+  /* fields out of header order, one by index, one name not in the header */
+  static const sv_struct_field schema[] = {
+    { "name", 0, SV_STRUCT_TYPE_STRING, offsetof(svtest_struct_record, name),
+      sizeof(sv_string_view) },
+    { NULL, 0, SV_STRUCT_TYPE_INT, offsetof(svtest_struct_record, id),
+      sizeof(int32_t) },
+    { "price", 0, SV_STRUCT_TYPE_FLOAT, offsetof(svtest_struct_record, price),
+      sizeof(double) },
+    { "ok", 0, SV_STRUCT_TYPE_BOOL, offsetof(svtest_struct_record, ok),
+      sizeof(char) },
+    { "ts", 0, SV_STRUCT_TYPE_EPOCH_NS, offsetof(svtest_struct_record, ts),
+      sizeof(int64_t) },
+    { "code", 0, SV_STRUCT_TYPE_CHARS, offsetof(svtest_struct_record, code),
+      4 },
+    { "small", 0, SV_STRUCT_TYPE_INT, offsetof(svtest_struct_record, small),
+      sizeof(int16_t) },
+    { "absent", 0, SV_STRUCT_TYPE_INT, offsetof(svtest_struct_record, absent),
+      sizeof(int64_t) }
+  };
+  const char* expected =
+    "1|2.5|1|1000000000|ABC|alpha|7|0\n"
+    "-2|1000|0|500000000|X,Y|be \"ta\"|0|0\n"
+    "0|0|0|0||<NULL>|0|0\n"
+    "4|0.25|1|0||<NULL>|0|0\n"
+    "5|-0|0|86400000000000|Q|long name over several chunks|-1|0\n";
+  static const size_t chunk_sizes[3] = { 1, 7, 0 };
+  static const sv_struct_field bad_schema[] = {
+    { NULL, 0, SV_STRUCT_TYPE_INT, 0, 3 }
+  };
+  svtest_struct_record records[2];
+  unsigned int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Struct Decode...\n");
+
+  for(i = 0; i < 3; i++) {
+    size_t chunk_size = chunk_sizes[i] ? chunk_sizes[i] : sizeof(data) - 1;
+    svtest_collector got;
+    sv *t;
+
+    memset(&got, '\0', sizeof(got));
+    t = sv_new(&got, NULL, svtest_collect_callback, ',');
+    if(!t) {
+      fprintf(stderr, "%s: Test Struct Decode FAIL - sv_new() failed\n",
+              program);
+      return 1;
+    }
+    sv_set_option(t, SV_OPTION_NULL_HANDLING, 1L);
+    if(sv_set_option(t, SV_OPTION_STRUCT_SCHEMA, schema,
+                     (int)(sizeof(schema) / sizeof(schema[0])),
+                     sizeof(svtest_struct_record)) ||
+       sv_set_option(t, SV_OPTION_STRUCT_CALLBACK, svtest_struct_callback,
+                     (void*)records, (size_t)2)) {
+      fprintf(stderr, "%s: Test Struct Decode FAIL - sv_set_option() failed\n",
+              program);
+      rc = 1;
+    } else {
+      svtest_parse_in_chunks(t, data, sizeof(data) - 1, chunk_size);
+
+      /* 5 rows in 2 structs: 3 callbacks */
+      if(!got.buffer || strcmp(got.buffer, expected) || got.rows_count != 3) {
+        fprintf(stderr, "%s: Test Struct Decode FAIL - chunk size %zu got %d callbacks '%s' expected '%s'\n",
+                program, chunk_size, got.rows_count,
+                got.buffer ? got.buffer : "", expected);
+        rc = 1;
+      }
+    }
+
+    sv_free(t);
+    if(got.buffer)
+      free(got.buffer);
+  }
+
+  if(!rc) {
+    /* with bad data an error, the bad row is not returned as a record
+     * so the next row fills the structs
+     */
+    static const char rows[] =
+      "id,name\n1,one\nx,bad\n3,three\n";
+    const char* bad_expected =
+      "1|0|0|0||one|0|0\n"
+      "3|0|0|0||three|0|0\n";
+    size_t consumed = 0;
+    svtest_collector got;
+    sv_status_t status;
+    sv *t;
+
+    memset(&got, '\0', sizeof(got));
+    memset(records, '\0', sizeof(records));
+    t = sv_new(&got, NULL, svtest_collect_callback, ',');
+    sv_set_option(t, SV_OPTION_BAD_DATA_ERROR, 1L);
+    sv_set_option(t, SV_OPTION_STRUCT_SCHEMA, schema, 2,
+                  sizeof(svtest_struct_record));
+    sv_set_option(t, SV_OPTION_STRUCT_CALLBACK, svtest_struct_callback,
+                  (void*)records, (size_t)2);
+    status = sv_parse_chunk_partial(t, (char*)rows, sizeof(rows) - 1,
+                                    &consumed);
+    if(status == SV_STATUS_FAILED && consumed < sizeof(rows) - 1)
+      status = sv_parse_chunk_partial(t, (char*)rows + consumed,
+                                      sizeof(rows) - 1 - consumed,
+                                      &consumed);
+    if(status || !got.buffer || strcmp(got.buffer, bad_expected)) {
+      fprintf(stderr, "%s: Test Struct Decode FAIL - bad data error status %d got '%s' expected '%s'\n",
+              program, (int)status, got.buffer ? got.buffer : "",
+              bad_expected);
+      rc = 1;
+    }
+    sv_free(t);
+    if(got.buffer)
+      free(got.buffer);
+  }
+
+  if(!rc) {
+    sv *t = sv_new(NULL, NULL, NULL, ',');
+
+    /* 3 byte integers and structs too small are rejected */
+    if(!t ||
+       sv_set_option(t, SV_OPTION_STRUCT_SCHEMA, bad_schema, 1, (size_t)8) ==
+       SV_STATUS_OK ||
+       sv_set_option(t, SV_OPTION_STRUCT_SCHEMA, schema, 2, (size_t)4) ==
+       SV_STATUS_OK ||
+       sv_set_option(t, SV_OPTION_STRUCT_CALLBACK, svtest_struct_callback,
+                     NULL, (size_t)1) == SV_STATUS_OK) {
+      fprintf(stderr, "%s: Test Struct Decode FAIL - bad schema accepted\n",
+              program);
+      rc = 1;
+    }
+    sv_free(t);
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Struct Decode OK\n", program);
+
+  return rc;
+}
+
+
+/* read callback giving the input a few bytes at a time */
+typedef struct
+{
+  const char* data;
+  size_t len;
+  size_t offset;
+} svtest_reader;
+
+static sv_status_t
+svtest_read_callback(sv *t, void *user_data, char* buffer, size_t size,
+                     size_t* len_p)
+{
+  svtest_reader* r = (svtest_reader*)user_data;
+  size_t n = r->len - r->offset;
+
+  if(n > 3)
+    n = 3;
+  if(n > size)
+    n = size;
+  memcpy(buffer, r->data + r->offset, n);
+  r->offset += n;
+  *len_p = n;
+  return SV_STATUS_OK;
+}
+
+
+/* Pull rows from @t until the end and collect them in @c */
+static sv_status_t
+svtest_pull_rows(sv* t, svtest_collector* c)
+{
+  char** fields;
+  size_t* widths;
+  size_t count;
+  sv_status_t status;
+
+  while((status = sv_next_row(t, &fields, &widths, &count)) == SV_STATUS_OK) {
+    status = svtest_collect_callback(t, c, fields, widths, count);
+    if(status)
+      return status;
+  }
+
+  if(status != SV_STATUS_END)
+    return status;
+
+  /* stays at the end */
+  status = sv_next_row(t, &fields, &widths, &count);
+  return (status == SV_STATUS_END && !fields && !count) ?
+    SV_STATUS_OK : SV_STATUS_FAILED;
+}
+
+
+#define SVTEST_NEXT_ROW_FILE "svtest-next-row.csv"
+#define SVTEST_NEXT_ROW_OFFSET_FILE "svtest-next-row-offset.csv"
+
+/* sv_next_row() from each kind of source gives the same rows as the
+ * data callback
+ */
+static int svtest_run_next_row(void) {
+  static const char data[] =
+    "a,b,c\n1,\"x\ny\",3\r\n# comment\n\n4,\"5,5\",6\n7,8,9";
+  svtest_collector expected;
+  int source;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Next Row...\n");
+
+  memset(&expected, '\0', sizeof(expected));
+  if(1) {
+    sv *t = sv_new(&expected, NULL, svtest_collect_callback, ',');
+    sv_set_option(t, SV_OPTION_COMMENT_PREFIX, "#");
+    svtest_parse_in_chunks(t, data, sizeof(data) - 1, sizeof(data) - 1);
+    sv_free(t);
+  }
+
+  if(1) {
+    FILE* fh = fopen(SVTEST_NEXT_ROW_FILE, "wb");
+    if(!fh || fwrite(data, 1, sizeof(data) - 1, fh) != sizeof(data) - 1) {
+      fprintf(stderr, "%s: Test Next Row FAIL - failed to write %s\n",
+              program, SVTEST_NEXT_ROW_FILE);
+      if(fh)
+        fclose(fh);
+      free(expected.buffer);
+      return 1;
+    }
+    fclose(fh);
+
+    /* the same after a line that is skipped by seeking past it */
+    fh = fopen(SVTEST_NEXT_ROW_OFFSET_FILE, "wb");
+    if(!fh || fputs("junk line\n", fh) == EOF ||
+       fwrite(data, 1, sizeof(data) - 1, fh) != sizeof(data) - 1) {
+      fprintf(stderr, "%s: Test Next Row FAIL - failed to write %s\n",
+              program, SVTEST_NEXT_ROW_OFFSET_FILE);
+      if(fh)
+        fclose(fh);
+      free(expected.buffer);
+      return 1;
+    }
+    fclose(fh);
+  }
+
+  /* buffer, callback, buffer with zero copy, mapped file, pipe, mapped
+   * file from an offset
+   */
+  for(source = 0; source < 6; source++) {
+    svtest_collector got;
+    svtest_collector headers;
+    svtest_reader reader;
+    sv_status_t status = SV_STATUS_OK;
+    int fd = -1;
+    sv *t;
+
+    memset(&got, '\0', sizeof(got));
+    memset(&headers, '\0', sizeof(headers));
+    reader.data = data;
+    reader.len = sizeof(data) - 1;
+    reader.offset = 0;
+
+    /* data callback is not used */
+    t = sv_new(&reader, NULL, svtest_collect_callback, ',');
+    sv_set_option(t, SV_OPTION_COMMENT_PREFIX, "#");
+
+    if(source == 0 || source == 2) {
+      if(source == 2)
+        sv_set_option(t, SV_OPTION_ZERO_COPY, 1L);
+      status = sv_set_option(t, SV_OPTION_SOURCE_BUFFER, (char*)data,
+                             sizeof(data) - 1);
+    } else if(source == 1)
+      status = sv_set_option(t, SV_OPTION_SOURCE_CALLBACK,
+                             svtest_read_callback);
+#if defined(HAVE_UNISTD_H) && defined(HAVE_FCNTL_H)
+    else if(source == 3) {
+      fd = open(SVTEST_NEXT_ROW_FILE, O_RDONLY);
+      status = sv_set_option(t, SV_OPTION_SOURCE_FD, fd);
+    } else if(source == 5) {
+      fd = open(SVTEST_NEXT_ROW_OFFSET_FILE, O_RDONLY);
+      if(fd < 0 || lseek(fd, 10, SEEK_SET) != 10)
+        status = SV_STATUS_FAILED;
+      else
+        status = sv_set_option(t, SV_OPTION_SOURCE_FD, fd);
+    } else {
+      int fds[2];
+
+      /* data fits in the pipe buffer so can be written before reading */
+      if(pipe(fds) ||
+         write(fds[1], data, sizeof(data) - 1) != (ssize_t)(sizeof(data) - 1))
+        status = SV_STATUS_FAILED;
+      else {
+        close(fds[1]);
+        fd = fds[0];
+        status = sv_set_option(t, SV_OPTION_SOURCE_FD, fd);
+      }
+    }
+#else
+    else {
+      sv_free(t);
+      continue;
+    }
+#endif
+
+    if(!status)
+      status = svtest_pull_rows(t, &got);
+    if(status || !got.buffer || strcmp(got.buffer, expected.buffer) ||
+       sv_get_header(t, 2, NULL) == NULL) {
+      fprintf(stderr, "%s: Test Next Row FAIL - source %d got rows '%s' expected '%s'\n",
+              program, source, got.buffer ? got.buffer : "", expected.buffer);
+      rc = 1;
+    } else if(reader.offset != (source == 1 ? sizeof(data) - 1 : 0)) {
+      fprintf(stderr, "%s: Test Next Row FAIL - source %d data callback used\n",
+              program, source);
+      rc = 1;
+    }
+
+    /* a reset reads a buffer again */
+    if(!rc && source == 0) {
+      char** fields;
+      size_t* widths;
+      size_t count;
+
+      sv_reset(t);
+      if(sv_next_row(t, &fields, &widths, &count) || count != 3 ||
+         strcmp(fields[0], "1")) {
+        fprintf(stderr, "%s: Test Next Row FAIL - reset did not restart\n",
+                program);
+        rc = 1;
+      }
+    }
+
+    sv_free(t);
+#ifdef HAVE_UNISTD_H
+    if(fd >= 0)
+      close(fd);
+#endif
+    if(got.buffer)
+      free(got.buffer);
+  }
+
+  if(1) {
+    sv *t = sv_new(NULL, NULL, NULL, ',');
+    char** fields;
+    size_t* widths;
+    size_t count;
+
+    if(sv_next_row(t, &fields, &widths, &count) != SV_STATUS_FAILED) {
+      fprintf(stderr, "%s: Test Next Row FAIL - no source succeeded\n",
+              program);
+      rc = 1;
+    }
+    sv_free(t);
+  }
+
+  remove(SVTEST_NEXT_ROW_FILE);
+  remove(SVTEST_NEXT_ROW_OFFSET_FILE);
+  free(expected.buffer);
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Next Row OK\n", program);
+
+  return rc;
+}
+
+
+/* collector that pauses after every data row */
+static sv_status_t
+svtest_pause_callback(sv *t, void *user_data,
+                      char** fields, size_t *widths, size_t count)
+{
+  sv_status_t status = svtest_collect_callback(t, user_data, fields, widths,
+                                               count);
+  return status ? status : SV_STATUS_PAUSE;
+}
+
+
+static sv_status_t
+svtest_fail_callback(sv *t, void *user_data,
+                     char** fields, size_t *widths, size_t count)
+{
+  return SV_STATUS_FAILED;
+}
+
+
+/* collector that fails the first row */
+static sv_status_t
+svtest_fail_first_callback(sv *t, void *user_data,
+                           char** fields, size_t *widths, size_t count)
+{
+  svtest_collector* c = (svtest_collector*)user_data;
+
+  if(!c->rows_count++)
+    return SV_STATUS_FAILED;
+  c->rows_count--;
+  return svtest_collect_callback(t, user_data, fields, widths, count);
+}
+
+
+/* sv_parse_chunk_partial() stops after each paused row and resumes
+ * from the unconsumed bytes; sv_parse_chunk() parses all of a chunk
+ */
+static int svtest_run_parse_chunk_partial(void) {
+  static const char data[] = "a,b\n1,\"x\ny\"\r\n3,4\n5,6";
+  const char* expected = "1|x\ny\n3|4\n5|6\n";
+  /* end offset of each paused row in data */
+  static const size_t pause_offsets[2] = { 12, 17 };
+  static const size_t chunk_sizes[3] = { 1, 5, 0 };
+  unsigned int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Parse Chunk Partial...\n");
+
+  for(i = 0; i < 3; i++) {
+    size_t chunk_size = chunk_sizes[i] ? chunk_sizes[i] : sizeof(data) - 1;
+    svtest_collector got;
+    size_t offset = 0;
+    unsigned int pauses = 0;
+    sv_status_t status = SV_STATUS_OK;
+    sv *t;
+
+    memset(&got, '\0', sizeof(got));
+    t = sv_new(&got, NULL, svtest_pause_callback, ',');
+
+    while(offset < sizeof(data) - 1) {
+      size_t len = sizeof(data) - 1 - offset;
+      size_t consumed = 0;
+
+      if(len > chunk_size)
+        len = chunk_size;
+      status = sv_parse_chunk_partial(t, (char*)data + offset, len, &consumed);
+      offset += consumed;
+      if(status == SV_STATUS_PAUSE) {
+        /* the whole chunk may have ended with the row */
+        if(pauses >= 2 || offset != pause_offsets[pauses] ||
+           got.rows_count != (int)pauses + 1) {
+          status = SV_STATUS_FAILED;
+          break;
+        }
+        pauses++;
+        status = SV_STATUS_OK;
+      } else if(status || consumed != len)
+        break;
+    }
+    if(!status)
+      status = sv_parse_chunk_partial(t, NULL, 0, NULL);
+
+    if(status || pauses != 2 || !got.buffer || strcmp(got.buffer, expected)) {
+      fprintf(stderr, "%s: Test Parse Chunk Partial FAIL - chunk size %zu status %d %u pauses got '%s' expected '%s'\n",
+              program, chunk_size, (int)status, pauses,
+              got.buffer ? got.buffer : "", expected);
+      rc = 1;
+    }
+    sv_free(t);
+    if(got.buffer)
+      free(got.buffer);
+  }
+
+  if(1) {
+    svtest_collector got;
+    sv *t;
+
+    /* sv_parse_chunk() ignores pauses */
+    memset(&got, '\0', sizeof(got));
+    t = sv_new(&got, NULL, svtest_pause_callback, ',');
+    if(svtest_parse_in_chunks(t, data, sizeof(data) - 1, sizeof(data) - 1) ||
+       !got.buffer || strcmp(got.buffer, expected)) {
+      fprintf(stderr, "%s: Test Parse Chunk Partial FAIL - sv_parse_chunk() got '%s' expected '%s'\n",
+              program, got.buffer ? got.buffer : "", expected);
+      rc = 1;
+    }
+    sv_free(t);
+    if(got.buffer)
+      free(got.buffer);
+
+    /* callback errors are returned */
+    t = sv_new(NULL, NULL, svtest_fail_callback, ',');
+    if(sv_parse_chunk(t, (char*)data, sizeof(data) - 1) != SV_STATUS_FAILED) {
+      fprintf(stderr, "%s: Test Parse Chunk Partial FAIL - callback error not returned\n",
+              program);
+      rc = 1;
+    }
+    sv_free(t);
+
+    /* parsing resumes after a row whose callback failed */
+    if(1) {
+      static const char rows[] = "a,b\nc,d\n";
+      size_t consumed = 0;
+      sv_status_t status;
+
+      memset(&got, '\0', sizeof(got));
+      t = sv_new(&got, NULL, svtest_fail_first_callback, ',');
+      sv_set_option(t, SV_OPTION_SAVE_HEADER, 0L);
+      status = sv_parse_chunk_partial(t, (char*)rows, sizeof(rows) - 1,
+                                      &consumed);
+      if(status == SV_STATUS_FAILED && consumed < sizeof(rows) - 1)
+        status = sv_parse_chunk_partial(t, (char*)rows + consumed,
+                                        sizeof(rows) - 1 - consumed,
+                                        &consumed);
+      if(!status)
+        status = sv_parse_chunk_partial(t, NULL, 0, NULL);
+      if(status || !got.buffer || strcmp(got.buffer, "c|d\n")) {
+        fprintf(stderr, "%s: Test Parse Chunk Partial FAIL - resume after error status %d got '%s' expected 'c|d\n'\n",
+                program, (int)status, got.buffer ? got.buffer : "");
+        rc = 1;
+      }
+      sv_free(t);
+      if(got.buffer)
+        free(got.buffer);
+    }
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Parse Chunk Partial OK\n", program);
+
+  return rc;
+}
+
+
+/* collector that stops on the second data row */
+static sv_status_t
+svtest_stop_callback(sv *t, void *user_data,
+                     char** fields, size_t *widths, size_t count)
+{
+  svtest_collector* c = (svtest_collector*)user_data;
+  sv_status_t status = svtest_collect_callback(t, user_data, fields, widths,
+                                               count);
+  return (status || c->rows_count < 2) ? status : SV_STATUS_STOP;
+}
+
+
+static sv_status_t
+svtest_count_batch_callback(sv *t, void *user_data, sv_batch* batch)
+{
+  *(size_t*)user_data += batch->rows;
+  return SV_STATUS_OK;
+}
+
+
+#define SVTEST_MAX_ROWS_FILE "svtest-max-rows.csv"
+
+/* SV_OPTION_MAX_ROWS and callbacks returning SV_STATUS_STOP end the
+ * parse at once, and sv_parse_file() stops reading
+ */
+static int svtest_run_max_rows(void) {
+  static const char data[] = "a,b\n1,2\n# c\n3,\"4\n\"\n5,6\n7,8\n";
+  const char* expected = "1|2\n3|4\n\n";
+  static const size_t chunk_sizes[2] = { 1, 0 };
+  unsigned int i;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Max Rows...\n");
+
+  /* max rows then a callback stop, in several chunk sizes */
+  for(i = 0; i < 4; i++) {
+    size_t chunk_size = chunk_sizes[i % 2] ? chunk_sizes[i % 2] :
+      sizeof(data) - 1;
+    svtest_collector got;
+    sv_status_t status;
+    sv *t;
+
+    memset(&got, '\0', sizeof(got));
+    if(i < 2) {
+      t = sv_new(&got, NULL, svtest_collect_callback, ',');
+      sv_set_option(t, SV_OPTION_MAX_ROWS, 2L);
+    } else
+      t = sv_new(&got, NULL, svtest_stop_callback, ',');
+    sv_set_option(t, SV_OPTION_COMMENT_PREFIX, "#");
+
+    status = svtest_parse_in_chunks(t, data, sizeof(data) - 1, chunk_size);
+    if(status != SV_STATUS_STOP || !got.buffer || strcmp(got.buffer, expected) ||
+       sv_parse_chunk(t, (char*)data, sizeof(data) - 1) != SV_STATUS_STOP) {
+      fprintf(stderr, "%s: Test Max Rows FAIL - %s chunk size %zu status %d got '%s' expected '%s'\n",
+              program, i < 2 ? "max rows" : "stop", chunk_size, (int)status,
+              got.buffer ? got.buffer : "", expected);
+      rc = 1;
+    }
+
+    /* a reset starts again */
+    got.len = 0;
+    got.rows_count = 0;
+    sv_reset(t);
+    status = svtest_parse_in_chunks(t, data, sizeof(data) - 1, chunk_size);
+    if(status != SV_STATUS_STOP || got.rows_count != 2) {
+      fprintf(stderr, "%s: Test Max Rows FAIL - %s after reset got %d rows\n",
+              program, i < 2 ? "max rows" : "stop", got.rows_count);
+      rc = 1;
+    }
+
+    sv_free(t);
+    if(got.buffer)
+      free(got.buffer);
+  }
+
+  /* rows in a partial batch are returned at the stop */
+  if(1) {
+    size_t rows = 0;
+    sv *t = sv_new(&rows, NULL, NULL, ',');
+
+    sv_set_option(t, SV_OPTION_BATCH_CALLBACK, svtest_count_batch_callback);
+    sv_set_option(t, SV_OPTION_BATCH_SIZE, 2L);
+    sv_set_option(t, SV_OPTION_MAX_ROWS, 3L);
+    if(sv_parse_chunk(t, (char*)data, sizeof(data) - 1) != SV_STATUS_STOP ||
+       rows != 3) {
+      fprintf(stderr, "%s: Test Max Rows FAIL - batches got %zu rows expected 3\n",
+              program, rows);
+      rc = 1;
+    }
+    sv_free(t);
+  }
+
+  /* sv_next_row() stops reading after the last row */
+  if(1) {
+    svtest_reader reader;
+    char** fields;
+    size_t* widths;
+    size_t count;
+    sv *t;
+
+    reader.data = data;
+    reader.len = sizeof(data) - 1;
+    reader.offset = 0;
+    t = sv_new(&reader, NULL, NULL, ',');
+    sv_set_option(t, SV_OPTION_MAX_ROWS, 1L);
+    sv_set_option(t, SV_OPTION_SOURCE_CALLBACK, svtest_read_callback);
+    if(sv_next_row(t, &fields, &widths, &count) || count != 2 ||
+       strcmp(fields[1], "2") ||
+       sv_next_row(t, &fields, &widths, &count) != SV_STATUS_END ||
+       reader.offset >= reader.len) {
+      fprintf(stderr, "%s: Test Max Rows FAIL - sv_next_row() read %zu bytes\n",
+              program, reader.offset);
+      rc = 1;
+    }
+    sv_free(t);
+  }
+
+  /* stopping a file parse is not an error */
+  if(1) {
+    FILE* fh = fopen(SVTEST_MAX_ROWS_FILE, "wb");
+    svtest_collector got;
+    sv *t;
+
+    if(!fh || fwrite(data, 1, sizeof(data) - 1, fh) != sizeof(data) - 1) {
+      fprintf(stderr, "%s: Test Max Rows FAIL - failed to write %s\n",
+              program, SVTEST_MAX_ROWS_FILE);
+      if(fh)
+        fclose(fh);
+      return 1;
+    }
+    fclose(fh);
+
+    memset(&got, '\0', sizeof(got));
+    t = sv_new(&got, NULL, svtest_collect_callback, ',');
+    sv_set_option(t, SV_OPTION_COMMENT_PREFIX, "#");
+    sv_set_option(t, SV_OPTION_MAX_ROWS, 2L);
+    if(sv_parse_file(t, SVTEST_MAX_ROWS_FILE) ||
+       !got.buffer || strcmp(got.buffer, expected)) {
+      fprintf(stderr, "%s: Test Max Rows FAIL - file got '%s' expected '%s'\n",
+              program, got.buffer ? got.buffer : "", expected);
+      rc = 1;
+    }
+    sv_free(t);
+    if(got.buffer)
+      free(got.buffer);
+    remove(SVTEST_MAX_ROWS_FILE);
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Max Rows OK\n", program);
+
+  return rc;
+}
+
+
+/* collector dropping the first rows it is given */
+typedef struct
+{
+  svtest_collector c;
+  int skip;
+} svtest_drop_collector;
+
+static sv_status_t
+svtest_drop_callback(sv *t, void *user_data,
+                     char** fields, size_t *widths, size_t count)
+{
+  svtest_drop_collector* d = (svtest_drop_collector*)user_data;
+
+  if(d->skip > 0) {
+    d->skip--;
+    return SV_STATUS_OK;
+  }
+  return svtest_collect_callback(t, &d->c, fields, widths, count);
+}
+
+
+/* New sv with the dialect of skip rows scan test @input */
+static sv*
+svtest_skip_rows_new(void* user_data, sv_fields_callback callback,
+                     unsigned int input)
+{
+  sv* t = sv_new(user_data, NULL, callback, ',');
+
+  sv_set_option(t, SV_OPTION_SAVE_HEADER, 0L);
+  if(input == 1)
+    sv_set_option(t, SV_OPTION_ESCAPE_CHAR, '\\');
+  else
+    sv_set_option(t, SV_OPTION_STRIP_WHITESPACE, 1L);
+  return t;
+}
+
+
+/* Skipped rows are scanned for ends of rows without being parsed;
+ * the rows after them are the same as when parsing everything
+ */
+static int svtest_run_skip_rows_scan(void) {
+  static const char* const inputs[2] = {
+    /* quoted separators, newlines and quotes; blank lines; CRLF */
+    "a,\"b,\nc\"\r\n\n\"d\"\"\n\",e\n  f , \"g\" \nh\n\"i\nj\",k,l\nm",
+    /* escaped separators and newlines */
+    "a\\,b,c\n\\\nd,e\n\"f\\\"\n\",g\nh\\\\,i\nj"
+  };
+  static const size_t chunk_sizes[3] = { 1, 3, 0 };
+  unsigned int input;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Skip Rows Scan...\n");
+
+  for(input = 0; input < 2; input++) {
+    const char* data = inputs[input];
+    size_t len = strlen(data);
+    int skip;
+
+    for(skip = 0; skip <= 7; skip++) {
+      svtest_drop_collector expected;
+      unsigned int i;
+      sv *t;
+
+      /* all the rows parsed, dropping the first skip of them */
+      memset(&expected, '\0', sizeof(expected));
+      expected.skip = skip;
+      t = svtest_skip_rows_new(&expected, svtest_drop_callback, input);
+      svtest_parse_in_chunks(t, data, len, len);
+      sv_free(t);
+
+      for(i = 0; i < 3; i++) {
+        size_t chunk_size = chunk_sizes[i] ? chunk_sizes[i] : len;
+        svtest_collector got;
+
+        memset(&got, '\0', sizeof(got));
+        t = svtest_skip_rows_new(&got, svtest_collect_callback, input);
+        sv_set_option(t, SV_OPTION_SKIP_ROWS, skip);
+        svtest_parse_in_chunks(t, data, len, chunk_size);
+
+        if(strcmp(got.buffer ? got.buffer : "",
+                  expected.c.buffer ? expected.c.buffer : "")) {
+          fprintf(stderr, "%s: Test Skip Rows Scan FAIL - input %u skip %d chunk size %zu got '%s' expected '%s'\n",
+                  program, input, skip, chunk_size,
+                  got.buffer ? got.buffer : "",
+                  expected.c.buffer ? expected.c.buffer : "");
+          rc = 1;
+        }
+        sv_free(t);
+        if(got.buffer)
+          free(got.buffer);
+      }
+
+      if(expected.c.buffer)
+        free(expected.c.buffer);
+    }
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Skip Rows Scan OK\n", program);
+
+  return rc;
+}
+
+
+/* Read all of temporary file @fh into a new string */
+static char*
+svtest_read_tmpfile(FILE* fh)
+{
+  long len;
+  char* buffer;
+
+  if(fflush(fh) || fseek(fh, 0L, SEEK_END))
+    return NULL;
+  len = ftell(fh);
+  if(len < 0 || fseek(fh, 0L, SEEK_SET))
+    return NULL;
+
+  buffer = (char*)malloc((size_t)len + 1);
+  if(!buffer)
+    return NULL;
+  if(fread(buffer, 1, (size_t)len, fh) != (size_t)len) {
+    free(buffer);
+    return NULL;
+  }
+  buffer[len] = '\0';
+
+  return buffer;
+}
+
+
+#define SVTEST_WRITER_ROWS 4
+#define SVTEST_WRITER_FIELDS 3
+
+static int svtest_run_writer(void) {
+  static const char* const rows[SVTEST_WRITER_ROWS][SVTEST_WRITER_FIELDS] = {
+    { "a", "b,c", "say \"hi\"" },
+    { "", "line1\r\nline2", "back\\slash" },
+    { "\"\"\"", "a long field without anything to quote", "," },
+    { "x", NULL, "y" }
+  };
+  static const char expected_default[] =
+    "a,\"b,c\",\"say \"\"hi\"\"\"\n"
+    ",\"line1\r\nline2\",back\\slash\n"
+    "\"\"\"\"\"\"\"\",a long field without anything to quote,\",\"\n"
+    "x\n";
+  static const size_t buffer_sizes[4] = { 1, 2, 7, 0 };
+  int dialect;
+  int rc = 0;
+
+  fprintf(stderr, "Running Test: Writer...\n");
+
+  /* 0: default; 1: escape char and no double quote; 2: tab separated */
+  for(dialect = 0; dialect < 3; dialect++) {
+    char* expected = NULL;
+    FILE* fh;
+    unsigned int b;
+    unsigned int r;
+    sv *t;
+
+    t = sv_new(NULL, NULL, NULL, dialect == 2 ? '\t' : ',');
+    if(!t) {
+      fprintf(stderr, "%s: Test Writer FAIL - sv_new failed\n", program);
+      return 1;
+    }
+    if(dialect == 1) {
+      sv_set_option(t, SV_OPTION_DOUBLE_QUOTE, 0L);
+      sv_set_option(t, SV_OPTION_ESCAPE_CHAR, '\\');
+    }
+
+    /* sv_write_fields() output is the reference */
+    fh = tmpfile();
+    if(fh) {
+      for(r = 0; r < SVTEST_WRITER_ROWS; r++)
+        sv_write_fields(t, fh, (char**)rows[r], NULL, SVTEST_WRITER_FIELDS);
+      expected = svtest_read_tmpfile(fh);
+      fclose(fh);
+    }
+    if(!expected) {
+      fprintf(stderr, "%s: Test Writer FAIL - dialect %d failed to write reference\n",
+              program, dialect);
+      sv_free(t);
+      rc = 1;
+      continue;
+    }
+    if(!dialect && strcmp(expected, expected_default)) {
+      fprintf(stderr, "%s: Test Writer FAIL - sv_write_fields() got '%s' expected '%s'\n",
+              program, expected, expected_default);
+      rc = 1;
+    }
+
+    /* the output parses back to the rows */
+    if(1) {
+      svtest_collector want;
+      svtest_collector parsed;
+      sv *p;
+
+      memset(&want, '\0', sizeof(want));
+      memset(&parsed, '\0', sizeof(parsed));
+      for(r = 0; r < SVTEST_WRITER_ROWS; r++) {
+        unsigned int f;
+
+        for(f = 0; f < SVTEST_WRITER_FIELDS && rows[r][f]; f++) {
+          if(f > 0)
+            svtest_collector_add(&want, "|", 1);
+          svtest_collector_add(&want, rows[r][f], strlen(rows[r][f]));
+        }
+        svtest_collector_add(&want, "\n", 1);
+      }
+
+      p = sv_new(&parsed, NULL, svtest_collect_callback,
+                 dialect == 2 ? '\t' : ',');
+      sv_set_option(p, SV_OPTION_SAVE_HEADER, 0L);
+      if(dialect == 1) {
+        sv_set_option(p, SV_OPTION_DOUBLE_QUOTE, 0L);
+        sv_set_option(p, SV_OPTION_ESCAPE_CHAR, '\\');
+      }
+      svtest_parse_in_chunks(p, expected, strlen(expected), strlen(expected));
+      sv_free(p);
+
+      if(strcmp(parsed.buffer ? parsed.buffer : "",
+                want.buffer ? want.buffer : "")) {
+        fprintf(stderr, "%s: Test Writer FAIL - dialect %d parsed '%s' expected '%s'\n",
+                program, dialect, parsed.buffer ? parsed.buffer : "",
+                want.buffer ? want.buffer : "");
+        rc = 1;
+      }
+      if(want.buffer)
+        free(want.buffer);
+      if(parsed.buffer)
+        free(parsed.buffer);
+    }
+
+    for(b = 0; b < 4; b++) {
+      sv_writer* w;
+      char* got = NULL;
+
+      fh = tmpfile();
+      if(!fh) {
+        rc = 1;
+        break;
+      }
+
+      w = sv_writer_new(t, fh, buffer_sizes[b]);
+      if(!w) {
+        fprintf(stderr, "%s: Test Writer FAIL - sv_writer_new failed\n",
+                program);
+        fclose(fh);
+        rc = 1;
+        break;
+      }
+
+      for(r = 0; r < SVTEST_WRITER_ROWS; r++) {
+        if(sv_writer_write_fields(w, (char**)rows[r], NULL,
+                                  SVTEST_WRITER_FIELDS)) {
+          fprintf(stderr, "%s: Test Writer FAIL - dialect %d buffer size %zu row %u write failed\n",
+                  program, dialect, buffer_sizes[b], r);
+          rc = 1;
+        }
+      }
+
+      /* nothing reaches the file handle until the buffer is full */
+      if(!buffer_sizes[b] && ftell(fh) != 0L) {
+        fprintf(stderr, "%s: Test Writer FAIL - dialect %d wrote before flush\n",
+                program, dialect);
+        rc = 1;
+      }
+
+      if(sv_writer_flush(w)) {
+        fprintf(stderr, "%s: Test Writer FAIL - dialect %d buffer size %zu flush failed\n",
+                program, dialect, buffer_sizes[b]);
+        rc = 1;
+      }
+      /* the writer can be used after a flush */
+      if(sv_writer_write_fields(w, (char**)rows[0], NULL,
+                                SVTEST_WRITER_FIELDS) ||
+         sv_writer_close(w)) {
+        fprintf(stderr, "%s: Test Writer FAIL - dialect %d buffer size %zu close failed\n",
+                program, dialect, buffer_sizes[b]);
+        rc = 1;
+      }
+
+      got = svtest_read_tmpfile(fh);
+      fclose(fh);
+
+      /* the reference output then the first row again */
+      if(!got || strlen(got) <= strlen(expected) ||
+         strncmp(got, expected, strlen(expected)) ||
+         strncmp(got + strlen(expected), expected,
+                 strchr(expected, '\n') + 1 - expected) ||
+         got[strlen(expected) + (strchr(expected, '\n') + 1 - expected)]) {
+        fprintf(stderr, "%s: Test Writer FAIL - dialect %d buffer size %zu got '%s' expected '%s' then its first row\n",
+                program, dialect, buffer_sizes[b], got ? got : "(null)",
+                expected);
+        rc = 1;
+      }
+      if(got)
+        free(got);
+    }
+
+    free(expected);
+    sv_free(t);
+  }
+
+  if(rc == 0)
+    fprintf(stderr, "%s: Test Writer OK\n", program);
+
+  return rc;
+}
+
+
+#define MAX_TEST_INDEX (N_TESTS-1)
+
+int
+main(int argc, char *argv[])
+{
+  char *p;
+  int rc = 0;
+  unsigned int test_index;
+
+  program = argv[0];
+  if((p = strrchr(program, '/')))
+    program = p + 1;
+  else if((p = strrchr(program, '\\')))
+    program = p + 1;
+  argv[0] = program;
+
+  if(argc < 1 || argc > 2) {
+    fprintf(stderr, "USAGE: %s [TEST-INDEX 1..%d]\n", program, MAX_TEST_INDEX);
+    rc = 1;
+    goto tidy;
+  }
+
+  if(argc == 2) {
+    test_index = atoi(argv[1]);
+    if(test_index < 1 || test_index > MAX_TEST_INDEX) {
+      fprintf(stderr, "%s: Test arg '%s' not in range 1..%d\n", program,
+              argv[1], MAX_TEST_INDEX);
+      rc = 1;
+      goto tidy;
+    }
+    rc = svtest_run_test(test_index);
+  } else {
+    /* run all tests */
+
+    for(test_index = 0; test_index < N_TESTS; test_index++) {
+      int test_rc;
+
+      test_rc = svtest_run_test(test_index);
+      if(test_rc > 0) {
+        /* error */
+        rc++;
+      } else if (test_rc < 0) {
+        /* failure; do not run any more tests */
+        rc = 1;
+        break;
+      }
+    }
+    /* Add the custom test call AFTER the loop */
+    if (svtest_run_unclosed_quote_eof() != 0) {
+      rc++;
+    }
+    if (svtest_run_custom_quote_double_quote() != 0) {
+      rc++;
+    }
+    if (svtest_run_quote_char_disabled() != 0) {
+      rc++;
+    }
+    if (svtest_run_empty_file() != 0) {
+      rc++;
+    }
+    if (svtest_run_newlines_only_file() != 0) {
+      rc++;
+    }
+    if (svtest_run_delimiters_only_file() != 0) {
+      rc++;
+    }
+    if (svtest_run_ends_with_delimiter() != 0) {
+      rc++;
+    }
+    if (svtest_run_crlf_eol() != 0) {
+      rc++;
+    }
+    if (svtest_run_strip_whitespace_empty() != 0) {
+      rc++;
+    }
+    if (svtest_run_skip_comment_interaction() != 0) {
+      rc++;
+    }
+    if (svtest_run_skip_rows_gt_total() != 0) {
+      rc++;
+    }
+    if (svtest_run_null_handling_default() != 0) {
+      rc++;
+    }
+    if (svtest_run_null_handling_enhanced() != 0) {
+      rc++;
+    }
+    if (svtest_run_header_null_handling_enhanced() != 0) {
+      rc++;
+    }
+    if (svtest_run_field_size_limit() != 0) {
+      rc++;
+    }
+    if (svtest_run_long_cells() != 0) {
+      rc++;
+    }
+    if (svtest_run_fields_reuse() != 0) {
+      rc++;
+    }
+    if (svtest_run_wide_row() != 0) {
+      rc++;
+    }
+    if (svtest_run_line_callback_chunks() != 0) {
+      rc++;
+    }
+    if (svtest_run_zero_copy() != 0) {
+      rc++;
+    }
+    if (svtest_run_dialect_options() != 0) {
+      rc++;
+    }
+    if (svtest_run_parallel() != 0) {
+      rc++;
+    }
+    if (svtest_run_parse_file() != 0) {
+      rc++;
+    }
+    if (svtest_run_select_columns() != 0) {
+      rc++;
+    }
+    if (svtest_run_count_records() != 0) {
+      rc++;
+    }
+    if (svtest_run_batch_callback() != 0) {
+      rc++;
+    }
+    if (svtest_run_table() != 0) {
+      rc++;
+    }
+    if (svtest_run_table_infer() != 0) {
+      rc++;
+    }
+    if (svtest_run_field_to_int64() != 0) {
+      rc++;
+    }
+    if (svtest_run_field_to_double() != 0) {
+      rc++;
+    }
+    if (svtest_run_field_to_epoch_ns() != 0) {
+      rc++;
+    }
+    if (svtest_run_struct_decode() != 0) {
+      rc++;
+    }
+    if (svtest_run_next_row() != 0) {
+      rc++;
+    }
+    if (svtest_run_parse_chunk_partial() != 0) {
+      rc++;
+    }
+    if (svtest_run_max_rows() != 0) {
+      rc++;
+    }
+    if (svtest_run_skip_rows_scan() != 0) {
+      rc++;
+    }
+    if (svtest_run_writer() != 0) {
       rc++;
     }
   }
@@ -0,0 +1,1006 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * table.c - Build Arrow layout columns from parsed rows
+ *
+ * Copyright (C) 2025, Dave Beckett https://www.dajobe.org/
+ *
+ * This package is Free Software
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ */
+
+
+#ifdef SV_CONFIG
+#include <sv_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <sv.h>
+#include "sv_internal.h"
+
+
+/* bit of a type in sv_table_column candidates */
+#define SV_TABLE_TYPE_BIT(type) (1U << (type))
+
+/* types inferred from sampled values */
+#define SV_TABLE_INFER_TYPES (SV_TABLE_TYPE_BIT(SV_TABLE_TYPE_INT64) | \
+                              SV_TABLE_TYPE_BIT(SV_TABLE_TYPE_FLOAT64) | \
+                              SV_TABLE_TYPE_BIT(SV_TABLE_TYPE_BOOL))
+
+/* One column of a table.  The buffers are in the Arrow columnar
+ * format and are handed to an ArrowArray on export.
+ */
+typedef struct
+{
+  /* column name; NUL terminated */
+  char* name;
+
+  sv_table_type type;
+
+  /* validity bitmap: bit i set if row i is not null */
+  unsigned char* validity;
+  /* offsets: rows + 1 of int32_t or int64_t */
+  void* offsets;
+  /* string bytes.  Typed columns keep them until export so a change
+   * of type converts from the input, not from the typed values
+   */
+  char* data;
+  size_t data_len;
+  size_t data_size;
+  /* typed columns: int64_t or double values or a bitmap of booleans */
+  char* typed;
+  size_t typed_size;
+
+  size_t null_count;
+
+  /* while sampling: SV_TABLE_TYPE_BIT of types all values could be */
+  unsigned int candidates;
+  /* while sampling: number of non-null values */
+  size_t values;
+} sv_table_column;
+
+
+struct sv_table_s
+{
+  /* size of each offset: 4 or 8 bytes */
+  int offset_size;
+
+  size_t rows;
+  /* rows allocated in each column validity and offsets */
+  size_t rows_size;
+
+  sv_table_column* columns;
+  size_t columns_count;
+  size_t columns_size;
+
+  /* number of rows sampled to infer column types or 0 */
+  size_t infer_rows;
+  /* non-0 when column types have been inferred */
+  int inferred;
+
+  /* first error adding rows */
+  sv_status_t status;
+};
+
+
+/* Private data of an exported ArrowArray: the buffers it owns */
+typedef struct
+{
+  const void* buffers[3];
+  struct ArrowArray** children;
+  struct ArrowArray* child_arrays;
+} sv_table_arrow_array;
+
+
+/* Private data of an exported ArrowSchema: the strings it owns */
+typedef struct
+{
+  char* name;
+  struct ArrowSchema** children;
+  struct ArrowSchema* child_schemas;
+} sv_table_arrow_schema;
+
+
+/**
+ * sv_table_new:
+ * @offset_size: size of the value offsets: 4 for the Arrow utf8 type
+ * with int32 offsets or 8 for large_utf8 with int64 offsets
+ *
+ * Constructor: create a table builder
+ *
+ * Rows are added with sv_table_add_row() or by passing
+ * sv_table_data_callback() and the table as user data to sv_new().
+ * The finished table is handed off with sv_table_export().
+ *
+ * Return value: new table or NULL on failure
+ */
+sv_table*
+sv_table_new(int offset_size)
+{
+  sv_table* table;
+
+  if(offset_size != 4 && offset_size != 8)
+    return NULL;
+
+  table = (sv_table*)calloc(1, sizeof(*table));
+  if(!table)
+    return NULL;
+
+  table->offset_size = offset_size;
+
+  return table;
+}
+
+
+/* Free the buffers of a column */
+static void
+sv_table_free_column(sv_table_column* col)
+{
+  if(col->name)
+    free(col->name);
+  if(col->validity)
+    free(col->validity);
+  if(col->offsets)
+    free(col->offsets);
+  if(col->data)
+    free(col->data);
+  if(col->typed)
+    free(col->typed);
+  memset(col, '\0', sizeof(*col));
+}
+
+
+/* Free all columns and forget the rows */
+static void
+sv_table_clear(sv_table* table)
+{
+  size_t i;
+
+  for(i = 0; i < table->columns_size; i++)
+    sv_table_free_column(&table->columns[i]);
+
+  table->columns_count = 0;
+  table->rows = 0;
+  table->rows_size = 0;
+  table->inferred = 0;
+  table->status = SV_STATUS_OK;
+}
+
+
+/**
+ * sv_table_free:
+ * @table: table
+ *
+ * Destructor: destroy a table and any rows not exported
+ */
+void
+sv_table_free(sv_table* table)
+{
+  if(!table)
+    return;
+
+  sv_table_clear(table);
+  if(table->columns)
+    free(table->columns);
+  free(table);
+}
+
+
+/* Set offset @row of @col */
+static void
+sv_table_set_offset(sv_table* table, sv_table_column* col, size_t row,
+                    size_t offset)
+{
+  if(table->offset_size == 4)
+    ((int32_t*)col->offsets)[row] = (int32_t)offset;
+  else
+    ((int64_t*)col->offsets)[row] = (int64_t)offset;
+}
+
+
+/* Ensure room for @rows rows in the validity and offsets of every
+ * column
+ */
+static sv_status_t
+sv_table_ensure_rows(sv_table* table, size_t rows)
+{
+  size_t nsize;
+  size_t i;
+
+  if(rows <= table->rows_size)
+    return SV_STATUS_OK;
+
+  nsize = table->rows_size ? table->rows_size * 2 : 1024;
+  while(nsize < rows)
+    nsize *= 2;
+
+  for(i = 0; i < table->columns_count; i++) {
+    sv_table_column* col = &table->columns[i];
+    unsigned char* nvalidity;
+    void* noffsets;
+
+    nvalidity = (unsigned char*)realloc(col->validity, (nsize + 7) / 8);
+    if(!nvalidity)
+      return SV_STATUS_NO_MEMORY;
+    col->validity = nvalidity;
+
+    noffsets = realloc(col->offsets, (size_t)table->offset_size * (nsize + 1));
+    if(!noffsets)
+      return SV_STATUS_NO_MEMORY;
+    col->offsets = noffsets;
+  }
+  table->rows_size = nsize;
+
+  return SV_STATUS_OK;
+}
+
+
+/* Ensure the table has @columns columns named from the headers of
+ * @t; new columns are null in the rows already added
+ */
+static sv_status_t
+sv_table_ensure_columns(sv_table* table, sv* t, size_t columns)
+{
+  size_t i;
+
+  if(columns <= table->columns_count)
+    return SV_STATUS_OK;
+
+  if(columns > table->columns_size) {
+    size_t nsize = table->columns_size ? table->columns_size * 2 : 8;
+    sv_table_column* ncolumns;
+
+    while(nsize < columns)
+      nsize *= 2;
+
+    ncolumns = (sv_table_column*)realloc(table->columns,
+                                         sizeof(sv_table_column) * nsize);
+    if(!ncolumns)
+      return SV_STATUS_NO_MEMORY;
+    memset(&ncolumns[table->columns_size], '\0',
+           sizeof(sv_table_column) * (nsize - table->columns_size));
+    table->columns = ncolumns;
+    table->columns_size = nsize;
+  }
+
+  for(i = table->columns_count; i < columns; i++) {
+    sv_table_column* col = &table->columns[i];
+    const char* header = NULL;
+    size_t header_len = 0;
+    size_t row;
+
+    if(t)
+      header = sv_get_header(t, (unsigned int)i, &header_len);
+    if(!header)
+      header_len = 0;
+
+    col->name = (char*)malloc(header_len + 1);
+    col->validity = (unsigned char*)calloc((table->rows_size + 7) / 8, 1);
+    col->offsets = malloc((size_t)table->offset_size *
+                          (table->rows_size + 1));
+    if(!col->name || !col->validity || !col->offsets) {
+      sv_table_free_column(col);
+      return SV_STATUS_NO_MEMORY;
+    }
+    if(header_len)
+      memcpy(col->name, header, header_len);
+    col->name[header_len] = '\0';
+
+    /* null in earlier rows */
+    for(row = 0; row <= table->rows; row++)
+      sv_table_set_offset(table, col, row, 0);
+    col->null_count = table->rows;
+    col->type = SV_TABLE_TYPE_STRING;
+    col->candidates = table->inferred ? 0 : SV_TABLE_INFER_TYPES;
+
+    table->columns_count = i + 1;
+  }
+
+  return SV_STATUS_OK;
+}
+
+
+/* Ensure room for @size bytes in the column buffer @buffer_p of
+ * @size_p bytes
+ */
+static sv_status_t
+sv_table_ensure_buffer(char** buffer_p, size_t* size_p, size_t size)
+{
+  size_t nsize;
+  char* nbuffer;
+
+  if(size <= *size_p)
+    return SV_STATUS_OK;
+
+  nsize = *size_p ? *size_p * 2 : 4096;
+  while(nsize < size)
+    nsize *= 2;
+  nbuffer = (char*)realloc(*buffer_p, nsize);
+  if(!nbuffer)
+    return SV_STATUS_NO_MEMORY;
+  *buffer_p = nbuffer;
+  *size_p = nsize;
+
+  return SV_STATUS_OK;
+}
+
+
+/* Append string bytes to a string column and set the end offset of
+ * @row
+ */
+static sv_status_t
+sv_table_append_string(sv_table* table, sv_table_column* col, size_t row,
+                       const char* s, size_t len)
+{
+  sv_status_t status;
+
+  if(table->offset_size == 4 && col->data_len + len > (size_t)INT32_MAX)
+    return SV_STATUS_FIELD_TOO_LARGE;
+
+  status = sv_table_ensure_buffer(&col->data, &col->data_size,
+                                  col->data_len + len);
+  if(status)
+    return status;
+
+  if(len)
+    memcpy(col->data + col->data_len, s, len);
+  col->data_len += len;
+  sv_table_set_offset(table, col, row + 1, col->data_len);
+
+  return SV_STATUS_OK;
+}
+
+
+/* Store typed value @row of a column from @field or 0 if @field is
+ * NULL; returns non-0 if @field is not of the column type
+ */
+static sv_status_t
+sv_table_set_value(sv_table_column* col, size_t row,
+                   const char* field, size_t width)
+{
+  sv_status_t status;
+
+  if(col->type == SV_TABLE_TYPE_BOOL) {
+    int b = 0;
+
+    if(field && sv_internal_field_to_bool(field, width, &b))
+      return SV_STATUS_FAILED;
+
+    status = sv_table_ensure_buffer(&col->typed, &col->typed_size,
+                                    (row >> 3) + 1);
+    if(status)
+      return status;
+    if(!(row & 7))
+      col->typed[row >> 3] = 0;
+    if(b)
+      col->typed[row >> 3] |= (char)(1U << (row & 7));
+  } else {
+    /* int64_t and double are both 8 bytes */
+    size_t offset = row * 8;
+
+    status = sv_table_ensure_buffer(&col->typed, &col->typed_size,
+                                    offset + 8);
+    if(status)
+      return status;
+
+    if(col->type == SV_TABLE_TYPE_INT64) {
+      int64_t v = 0;
+
+      if(field && sv_field_to_int64(field, width, &v))
+        return SV_STATUS_FAILED;
+      memcpy(col->typed + offset, &v, sizeof(v));
+    } else {
+      double v = 0.0;
+
+      if(field && sv_field_to_double(field, width, &v))
+        return SV_STATUS_FAILED;
+      memcpy(col->typed + offset, &v, sizeof(v));
+    }
+  }
+
+  return SV_STATUS_OK;
+}
+
+
+/* Non-0 if value @row of a column is not null */
+#define SV_TABLE_IS_VALID(col, row) \
+  ((col)->validity[(row) >> 3] & (1U << ((row) & 7)))
+
+
+/* Set the type of a column and convert the strings of the first
+ * @rows rows to values of that type; returns non-0 if one is not of
+ * that type
+ */
+static sv_status_t
+sv_table_convert(sv_table* table, sv_table_column* col, size_t rows,
+                 sv_table_type type)
+{
+  sv_status_t status;
+  size_t row;
+
+  col->type = type;
+
+  for(row = 0; row < rows; row++) {
+    const char* field = NULL;
+    size_t start = 0;
+    size_t end = 0;
+
+    if(SV_TABLE_IS_VALID(col, row)) {
+      if(table->offset_size == 4) {
+        start = (size_t)((int32_t*)col->offsets)[row];
+        end = (size_t)((int32_t*)col->offsets)[row + 1];
+      } else {
+        start = (size_t)((int64_t*)col->offsets)[row];
+        end = (size_t)((int64_t*)col->offsets)[row + 1];
+      }
+      field = col->data + start;
+    }
+
+    status = sv_table_set_value(col, row, field, end - start);
+    if(status)
+      return status;
+  }
+
+  return SV_STATUS_OK;
+}
+
+
+/* Choose the type of each column from the sampled values and convert
+ * them
+ */
+static sv_status_t
+sv_table_infer(sv_table* table)
+{
+  sv_status_t status = SV_STATUS_OK;
+  size_t i;
+
+  table->inferred = 1;
+
+  for(i = 0; i < table->columns_count; i++) {
+    sv_table_column* col = &table->columns[i];
+    unsigned int c = col->candidates;
+    sv_table_type type = SV_TABLE_TYPE_STRING;
+
+    col->candidates = 0;
+    /* a column with no values stays string */
+    if(!col->values)
+      continue;
+
+    if(c & SV_TABLE_TYPE_BIT(SV_TABLE_TYPE_INT64))
+      type = SV_TABLE_TYPE_INT64;
+    else if(c & SV_TABLE_TYPE_BIT(SV_TABLE_TYPE_FLOAT64))
+      type = SV_TABLE_TYPE_FLOAT64;
+    else if(c & SV_TABLE_TYPE_BIT(SV_TABLE_TYPE_BOOL))
+      type = SV_TABLE_TYPE_BOOL;
+    else
+      continue;
+
+    /* sampled values were checked so only memory can fail */
+    status = sv_table_convert(table, col, table->rows, type);
+    if(status)
+      break;
+  }
+
+  return status;
+}
+
+
+/* Remove types from a sampled string column's candidates that @field
+ * is not
+ */
+static void
+sv_table_sample(sv_table_column* col, const char* field, size_t width)
+{
+  unsigned int c = col->candidates;
+  int64_t i;
+  double d;
+  int b;
+
+  col->values++;
+
+  if((c & SV_TABLE_TYPE_BIT(SV_TABLE_TYPE_INT64)) &&
+     sv_field_to_int64(field, width, &i))
+    c &= ~SV_TABLE_TYPE_BIT(SV_TABLE_TYPE_INT64);
+  if((c & SV_TABLE_TYPE_BIT(SV_TABLE_TYPE_FLOAT64)) &&
+     sv_field_to_double(field, width, &d))
+    c &= ~SV_TABLE_TYPE_BIT(SV_TABLE_TYPE_FLOAT64);
+  if((c & SV_TABLE_TYPE_BIT(SV_TABLE_TYPE_BOOL)) &&
+     sv_internal_field_to_bool(field, width, &b))
+    c &= ~SV_TABLE_TYPE_BIT(SV_TABLE_TYPE_BOOL);
+
+  col->candidates = c;
+}
+
+
+/* Store typed value @row of a column whose string is added, changing
+ * an int64 column to float64 or any typed column to string if @field
+ * does not fit
+ */
+static sv_status_t
+sv_table_add_typed(sv_table* table, sv_table_column* col, size_t row,
+                   const char* field, size_t width)
+{
+  sv_status_t status;
+  double d;
+
+  status = sv_table_set_value(col, row, field, width);
+  if(status != SV_STATUS_FAILED)
+    return status;
+
+  if(col->type == SV_TABLE_TYPE_INT64 &&
+     !sv_field_to_double(field, width, &d)) {
+    /* converted again from the strings; only memory can fail */
+    return sv_table_convert(table, col, row + 1, SV_TABLE_TYPE_FLOAT64);
+  }
+
+  /* the strings are already the column */
+  free(col->typed);
+  col->typed = NULL;
+  col->typed_size = 0;
+  col->type = SV_TABLE_TYPE_STRING;
+
+  return SV_STATUS_OK;
+}
+
+
+/**
+ * sv_table_add_row:
+ * @table: table
+ * @t: sv object that parsed the row (or NULL)
+ * @fields: row fields
+ * @widths: row field widths
+ * @count: number of fields
+ *
+ * Add a row to a table
+ *
+ * Field i is added to column i.  A field is null if it is NULL, a
+ * null value of @t (see #SV_OPTION_NULL_VALUES) or missing from the
+ * row.  Columns are named from the headers of @t when they are
+ * created.
+ *
+ * Return value: non-0 on failure; #SV_STATUS_FIELD_TOO_LARGE if a
+ * column has more bytes than 4 byte offsets can hold
+ */
+sv_status_t
+sv_table_add_row(sv_table* table, sv* t, char** fields, size_t* widths,
+                 size_t count)
+{
+  sv_status_t status;
+  size_t row = table->rows;
+  size_t byte = row >> 3;
+  unsigned char bit = (unsigned char)(1U << (row & 7));
+  size_t i;
+
+  if(table->status)
+    return table->status;
+
+  status = sv_table_ensure_rows(table, row + 1);
+  if(!status)
+    status = sv_table_ensure_columns(table, t, count);
+  if(status)
+    goto failed;
+
+  for(i = 0; i < table->columns_count; i++) {
+    sv_table_column* col = &table->columns[i];
+    const char* field = (i < count) ? fields[i] : NULL;
+    size_t width = field ? widths[i] : 0;
+
+    if(!(row & 7))
+      col->validity[byte] = 0;
+
+    if(field && t && sv_internal_is_null_value(t, field, width))
+      field = NULL;
+
+    if(field)
+      col->validity[byte] |= bit;
+    else {
+      col->null_count++;
+      width = 0;
+    }
+
+    if(field && col->candidates)
+      sv_table_sample(col, field, width);
+    status = sv_table_append_string(table, col, row, field, width);
+    if(!status && col->type != SV_TABLE_TYPE_STRING)
+      status = sv_table_add_typed(table, col, row, field, width);
+    if(status)
+      goto failed;
+  }
+
+  table->rows = row + 1;
+
+  if(table->infer_rows && !table->inferred &&
+     table->rows >= table->infer_rows) {
+    status = sv_table_infer(table);
+    if(status)
+      goto failed;
+  }
+
+  return SV_STATUS_OK;
+
+failed:
+  /* the row is partly added so the table cannot be used */
+  table->status = status;
+  return status;
+}
+
+
+/**
+ * sv_table_set_infer_rows:
+ * @table: table
+ * @rows: number of rows to sample or 0 to keep all columns as strings
+ *
+ * Infer column types from the first @rows rows
+ *
+ * Each column whose sampled non-null values are all integers, all
+ * numbers or all true or false becomes an int64, float64 or bool
+ * column; others stay strings.  Later values are converted directly
+ * as they are added.  A value that does not fit changes an int64
+ * column to float64, or any typed column to string.  Typed columns
+ * keep the input strings until export so the earlier values are
+ * converted again or returned exactly as they were parsed.
+ *
+ * Must be called before any rows are added.
+ *
+ * Return value: non-0 on failure
+ */
+sv_status_t
+sv_table_set_infer_rows(sv_table* table, size_t rows)
+{
+  if(table->rows)
+    return SV_STATUS_FAILED;
+
+  table->infer_rows = rows;
+  return SV_STATUS_OK;
+}
+
+
+/**
+ * sv_table_get_column_type:
+ * @table: table
+ * @column: column index
+ *
+ * Get the type of a column
+ *
+ * Return value: column type; #SV_TABLE_TYPE_STRING if @column is out
+ * of range
+ */
+sv_table_type
+sv_table_get_column_type(sv_table* table, size_t column)
+{
+  if(column >= table->columns_count)
+    return SV_TABLE_TYPE_STRING;
+  return table->columns[column].type;
+}
+
+
+/**
+ * sv_table_data_callback:
+ * @t: sv object
+ * @user_data: table
+ * @fields: array of fields
+ * @widths: array of field widths
+ * @count: size of @fields and @widths
+ *
+ * Data callback for sv_new() that adds rows to the table passed as
+ * user data.
+ *
+ * Return value: #SV_STATUS_OK or error code
+ */
+sv_status_t
+sv_table_data_callback(sv *t, void *user_data,
+                       char** fields, size_t *widths, size_t count)
+{
+  return sv_table_add_row((sv_table*)user_data, t, fields, widths, count);
+}
+
+
+/**
+ * sv_table_get_rows:
+ * @table: table
+ *
+ * Get the number of rows in a table
+ *
+ * Return value: number of rows
+ */
+size_t
+sv_table_get_rows(sv_table* table)
+{
+  return table->rows;
+}
+
+
+/**
+ * sv_table_get_columns:
+ * @table: table
+ *
+ * Get the number of columns in a table
+ *
+ * Return value: number of columns
+ */
+size_t
+sv_table_get_columns(sv_table* table)
+{
+  return table->columns_count;
+}
+
+
+/* Arrow C data interface format of a column type */
+static const char*
+sv_table_arrow_format(sv_table* table, sv_table_type type)
+{
+  switch(type) {
+    case SV_TABLE_TYPE_INT64:
+      return "l";
+    case SV_TABLE_TYPE_FLOAT64:
+      return "g";
+    case SV_TABLE_TYPE_BOOL:
+      return "b";
+    case SV_TABLE_TYPE_STRING:
+    default:
+      break;
+  }
+
+  return (table->offset_size == 4) ? "u" : "U";
+}
+
+
+static void
+sv_table_release_array(struct ArrowArray* array)
+{
+  sv_table_arrow_array* priv = (sv_table_arrow_array*)array->private_data;
+  int64_t i;
+
+  if(!array->release)
+    return;
+
+  for(i = 0; i < array->n_children; i++) {
+    struct ArrowArray* child = array->children[i];
+
+    if(child->release)
+      child->release(child);
+  }
+
+  for(i = 0; i < array->n_buffers; i++) {
+    if(priv->buffers[i])
+      free((void*)priv->buffers[i]);
+  }
+  if(priv->children)
+    free(priv->children);
+  if(priv->child_arrays)
+    free(priv->child_arrays);
+  free(priv);
+
+  array->release = NULL;
+}
+
+
+static void
+sv_table_release_schema(struct ArrowSchema* schema)
+{
+  sv_table_arrow_schema* priv = (sv_table_arrow_schema*)schema->private_data;
+  int64_t i;
+
+  if(!schema->release)
+    return;
+
+  for(i = 0; i < schema->n_children; i++) {
+    struct ArrowSchema* child = schema->children[i];
+
+    if(child->release)
+      child->release(child);
+  }
+
+  if(priv->name)
+    free(priv->name);
+  if(priv->children)
+    free(priv->children);
+  if(priv->child_schemas)
+    free(priv->child_schemas);
+  free(priv);
+
+  schema->release = NULL;
+}
+
+
+/**
+ * sv_table_export:
+ * @table: table
+ * @array: array to set
+ * @schema: schema to set (or NULL)
+ *
+ * Hand off the table rows as an Arrow C data interface struct array
+ * of string columns or the int64, float64 and bool columns found by
+ * sv_table_set_infer_rows().
+ *
+ * The column buffers are moved to @array without copying and are
+ * freed by its release callback.  @table is then empty and can be
+ * used to build another table.  Column values are the bytes from the
+ * input; they are not checked to be UTF-8.
+ *
+ * Return value: non-0 on failure, including an earlier failure to
+ * add a row
+ */
+sv_status_t
+sv_table_export(sv_table* table, struct ArrowArray* array,
+                struct ArrowSchema* schema)
+{
+  sv_table_arrow_array* array_priv = NULL;
+  sv_table_arrow_schema* schema_priv = NULL;
+  size_t n = table->columns_count;
+  size_t i;
+
+  if(table->status)
+    return table->status;
+
+  /* fewer rows than the sample */
+  if(table->infer_rows && !table->inferred) {
+    sv_status_t status = sv_table_infer(table);
+    if(status) {
+      table->status = status;
+      return status;
+    }
+  }
+
+  /* offsets for an empty table */
+  if(sv_table_ensure_rows(table, 1))
+    return SV_STATUS_NO_MEMORY;
+
+  array_priv = (sv_table_arrow_array*)calloc(1, sizeof(*array_priv));
+  if(!array_priv)
+    goto no_memory;
+  array_priv->children = (struct ArrowArray**)calloc(n + 1, sizeof(void*));
+  array_priv->child_arrays = (struct ArrowArray*)calloc(n + 1,
+                                                        sizeof(struct ArrowArray));
+  if(!array_priv->children || !array_priv->child_arrays)
+    goto no_memory;
+
+  if(schema) {
+    schema_priv = (sv_table_arrow_schema*)calloc(1, sizeof(*schema_priv));
+    if(!schema_priv)
+      goto no_memory;
+    schema_priv->children = (struct ArrowSchema**)calloc(n + 1,
+                                                         sizeof(void*));
+    schema_priv->child_schemas = (struct ArrowSchema*)calloc(n + 1,
+                                                             sizeof(struct ArrowSchema));
+    if(!schema_priv->children || !schema_priv->child_schemas)
+      goto no_memory;
+  }
+
+  /* allocate every column's private data before moving any buffers */
+  for(i = 0; i < n; i++) {
+    array_priv->child_arrays[i].private_data = calloc(1,
+                                                      sizeof(sv_table_arrow_array));
+    if(!array_priv->child_arrays[i].private_data)
+      goto no_memory;
+    if(schema) {
+      schema_priv->child_schemas[i].private_data = calloc(1,
+                                                          sizeof(sv_table_arrow_schema));
+      if(!schema_priv->child_schemas[i].private_data)
+        goto no_memory;
+    }
+  }
+
+  for(i = 0; i < n; i++) {
+    sv_table_column* col = &table->columns[i];
+    struct ArrowArray* child = &array_priv->child_arrays[i];
+    sv_table_arrow_array* child_priv;
+
+    child_priv = (sv_table_arrow_array*)child->private_data;
+    child_priv->buffers[0] = col->validity;
+    if(col->type == SV_TABLE_TYPE_STRING) {
+      child_priv->buffers[1] = col->offsets;
+      child_priv->buffers[2] = col->data;
+      child->n_buffers = 3;
+    } else {
+      child_priv->buffers[1] = col->typed;
+      child->n_buffers = 2;
+      /* the strings were only kept for a change of type */
+      free(col->offsets);
+      if(col->data)
+        free(col->data);
+    }
+
+    child->length = (int64_t)table->rows;
+    child->null_count = (int64_t)col->null_count;
+    child->offset = 0;
+    child->n_children = 0;
+    child->buffers = child_priv->buffers;
+    child->children = NULL;
+    child->dictionary = NULL;
+    child->release = sv_table_release_array;
+    array_priv->children[i] = child;
+
+    if(schema) {
+      struct ArrowSchema* child_schema = &schema_priv->child_schemas[i];
+      sv_table_arrow_schema* child_schema_priv;
+
+      child_schema_priv = (sv_table_arrow_schema*)child_schema->private_data;
+      child_schema_priv->name = col->name;
+
+      child_schema->format = sv_table_arrow_format(table, col->type);
+      child_schema->name = col->name;
+      child_schema->metadata = NULL;
+      child_schema->flags = ARROW_FLAG_NULLABLE;
+      child_schema->n_children = 0;
+      child_schema->children = NULL;
+      child_schema->dictionary = NULL;
+      child_schema->release = sv_table_release_schema;
+      schema_priv->children[i] = child_schema;
+    } else
+      free(col->name);
+
+    /* buffers now belong to the array */
+    memset(col, '\0', sizeof(*col));
+  }
+
+  array->length = (int64_t)table->rows;
+  array->null_count = 0;
+  array->offset = 0;
+  array->n_buffers = 1;
+  array->n_children = (int64_t)n;
+  array->buffers = array_priv->buffers;
+  array->children = array_priv->children;
+  array->dictionary = NULL;
+  array->release = sv_table_release_array;
+  array->private_data = array_priv;
+
+  if(schema) {
+    schema->format = "+s";
+    schema->name = NULL;
+    schema->metadata = NULL;
+    schema->flags = 0;
+    schema->n_children = (int64_t)n;
+    schema->children = schema_priv->children;
+    schema->dictionary = NULL;
+    schema->release = sv_table_release_schema;
+    schema->private_data = schema_priv;
+  }
+
+  sv_table_clear(table);
+
+  return SV_STATUS_OK;
+
+no_memory:
+  if(array_priv) {
+    if(array_priv->child_arrays) {
+      for(i = 0; i < n; i++) {
+        if(array_priv->child_arrays[i].private_data)
+          free(array_priv->child_arrays[i].private_data);
+      }
+      free(array_priv->child_arrays);
+    }
+    if(array_priv->children)
+      free(array_priv->children);
+    free(array_priv);
+  }
+  if(schema_priv) {
+    if(schema_priv->child_schemas) {
+      for(i = 0; i < n; i++) {
+        if(schema_priv->child_schemas[i].private_data)
+          free(schema_priv->child_schemas[i].private_data);
+      }
+      free(schema_priv->child_schemas);
+    }
+    if(schema_priv->children)
+      free(schema_priv->children);
+    free(schema_priv);
+  }
+
+  return SV_STATUS_NO_MEMORY;
+}
@@ -25,66 +25,174 @@
 #include <sv_config.h>
 #endif
 
+#include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 
 #include <sv.h>
 #include "sv_internal.h"
 
 
+/* default size of a #sv_writer output buffer */
+#define SV_WRITER_BUFFER_SIZE (64 * 1024)
+
+/* size of the buffer sv_write_fields() collects a row in */
+#define SV_WRITE_ROW_BUFFER_SIZE 1024
+
+
+struct sv_writer_s
+{
+  sv* t;
+  FILE* fh;
+
+  /* output not yet written to fh */
+  char* buffer;
+  size_t len;
+  size_t size;
+};
+
+
+/* Write the buffered output to the file handle */
+static sv_status_t
+sv_writer_drain(sv_writer* w)
+{
+  size_t len = w->len;
+
+  w->len = 0;
+  if(len && fwrite(w->buffer, 1, len, w->fh) != len)
+    return SV_STATUS_FAILED;
+
+  return SV_STATUS_OK;
+}
+
+
+/* Append @len bytes of @data to the output; spans that do not fit
+ * in an empty buffer are written straight to the file handle
+ */
+static sv_status_t
+sv_writer_append(sv_writer* w, const char* data, size_t len)
+{
+  if(len > w->size - w->len) {
+    if(sv_writer_drain(w))
+      return SV_STATUS_FAILED;
+
+    if(len >= w->size) {
+      if(fwrite(data, 1, len, w->fh) != len)
+        return SV_STATUS_FAILED;
+      return SV_STATUS_OK;
+    }
+  }
+
+  memcpy(w->buffer + w->len, data, len);
+  w->len += len;
+
+  return SV_STATUS_OK;
+}
+
+
+/* Append byte @c to the output */
+static sv_status_t
+sv_writer_append_char(sv_writer* w, char c)
+{
+  if(w->len == w->size && sv_writer_drain(w))
+    return SV_STATUS_FAILED;
+
+  w->buffer[w->len++] = c;
+
+  return SV_STATUS_OK;
+}
+
+
 /**
  * sv_write_field:
- * @t: sv object
- * @fh: file handle to write to
+ * @w: writer
  * @field: field to write
  * @width: width of @field
  *
- * INTERNAL: Write a SV formatted field to a file handle
+ * INTERNAL: Write a SV formatted field.  Quoted fields are appended
+ * in spans between the characters that are escaped.
  */
 static sv_status_t
-sv_write_field(sv* t, FILE* fh, const char* field, size_t width)
+sv_write_field(sv_writer* w, const char* field, size_t width)
 {
+  sv* t = w->t;
   int needs_quote = 0;
   const char *p;
+  const char *span;
   const char *end = field + width;
 
   for(p = field; p < end ; p++) {
-    if(*p == t->field_sep || *p == t->quote_char || *p == t->escape_char ||
+    if(*p == t->field_sep || *p == t->quote_char ||
+       (t->escape_char && *p == t->escape_char) ||
        *p == '\r' || *p == '\n') {
       needs_quote = 1;
       break;
     }
   }
 
-  if(needs_quote) {
-    if(fputc(t->quote_char, fh) == EOF)
+  if(!needs_quote)
+    return sv_writer_append(w, field, width);
+
+  if(sv_writer_append_char(w, t->quote_char))
+    return SV_STATUS_FAILED;
+
+  /* the bytes scanned above need no escaping */
+  span = field;
+  for(; p < end ; p++) {
+    char escape;
+
+    if(*p == t->quote_char) {
+      /* Double the quote char unless there is an escape char for it */
+      if((t->flags & SV_FLAGS_DOUBLE_QUOTE) || !t->escape_char)
+        escape = *p;
+      else
+        escape = t->escape_char;
+    } else if(t->escape_char &&
+              (*p == t->field_sep || *p == t->escape_char)) {
+      /* Escape the field separator or the escape char itself */
+      escape = t->escape_char;
+    } else
+      continue;
+
+    if(sv_writer_append(w, span, (size_t)(p - span)) ||
+       sv_writer_append_char(w, escape))
       return SV_STATUS_FAILED;
+    span = p;
+  }
+
+  if(sv_writer_append(w, span, (size_t)(end - span)) ||
+     sv_writer_append_char(w, t->quote_char))
+    return SV_STATUS_FAILED;
 
-    for(p = field; p < end ; p++) {
-      if(*p == t->field_sep || *p == t->quote_char) {
-        /* Escape the field separator or quote char */
-        if(*p == t->quote_char && (t->flags & SV_FLAGS_DOUBLE_QUOTE)) {
-          if(fputc(*p, fh) == EOF)
-            return SV_STATUS_FAILED;
-        } else {
-          if(fputc(t->escape_char, fh) == EOF)
-            return SV_STATUS_FAILED;
-        }
-      } else if(*p == t->escape_char) {
-        /* Escape the escape char if defined */
-        if(fputc(t->escape_char, fh) == EOF)
-          return SV_STATUS_FAILED;
-      }
-      if(fputc(*p, fh) == EOF)
+  return SV_STATUS_OK;
+}
+
+
+/* Write a row of fields ending in a newline */
+static sv_status_t
+sv_write_row(sv_writer* w, char** fields, size_t *widths, size_t count)
+{
+  sv_status_t status;
+  size_t i;
+
+  for(i = 0; i < count; i++) {
+    char* field = fields[i];
+    size_t width;
+    if(!field)
+      break;
+
+    if(i > 0) {
+      if(sv_writer_append_char(w, w->t->field_sep))
         return SV_STATUS_FAILED;
     }
-    if(fputc(t->quote_char, fh) == EOF)
-      return SV_STATUS_FAILED;
-  } else {
-    if(fwrite(field, 1, width, fh) != width)
-      return SV_STATUS_FAILED;
+
+    width = widths ? widths[i] : strlen(field);
+    status = sv_write_field(w, field, width);
+    if(status != SV_STATUS_OK)
+      return status;
   }
 
-  return SV_STATUS_OK;
+  return sv_writer_append_char(w, '\n');
 }
 
 
@@ -98,40 +206,148 @@ sv_write_field(sv* t, FILE* fh, const char* field, size_t width)
  * @count: number of fields
  *
  * Write a row of fields to a file handle with escaping
+ *
+ * The file handle is flushed after every row; use #sv_writer to
+ * write many rows.
  */
 sv_status_t
 sv_write_fields(sv *t, FILE* fh, char** fields, size_t *widths, size_t count)
 {
-  sv_status_t status = SV_STATUS_OK;
-  size_t i;
+  char buffer[SV_WRITE_ROW_BUFFER_SIZE];
+  sv_writer w;
+  sv_status_t status;
 
-  for(i = 0; i < count; i++) {
-    char* field = fields[i];
-    size_t width;
-    if(!field)
-      break;
+  w.t = t;
+  w.fh = fh;
+  w.buffer = buffer;
+  w.len = 0;
+  w.size = sizeof(buffer);
 
-    if(i > 0) {
-      if(fputc(t->field_sep, fh) == EOF) {
-        status = SV_STATUS_FAILED;
-        break;
-      }
-    }
+  status = sv_write_row(&w, fields, widths, count);
 
-    width = widths ? widths[i] : strlen(field);
-    status = sv_write_field(t, fh, field, width);
-    if(status != SV_STATUS_OK)
-      break;
-  }
-  /* Only try to write newline if all previous operations were successful */
-  if(status == SV_STATUS_OK) {
-    if(fputc('\n', fh) == EOF) {
-      status = SV_STATUS_FAILED;
-    }
-  }
+  /* any part of a row that failed is still written */
+  if(sv_writer_drain(&w))
+    status = SV_STATUS_FAILED;
 
   if(fflush(fh) == EOF)
     status = SV_STATUS_FAILED;
 
   return status;
 }
+
+
+/**
+ * sv_writer_new:
+ * @t: sv object with the field separator, quote and escape characters
+ * @fh: FILE handle to write to
+ * @buffer_size: size of the output buffer or 0 for the default of 64K
+ *
+ * Constructor: create a writer of rows to a file handle
+ *
+ * Rows written with sv_writer_write_fields() are collected in the
+ * output buffer and written to @fh only when it is full, by
+ * sv_writer_flush() or by sv_writer_close().  @t and @fh must be
+ * valid until the writer is closed.
+ *
+ * Return value: new writer or NULL on failure
+ */
+sv_writer*
+sv_writer_new(sv *t, FILE* fh, size_t buffer_size)
+{
+  sv_writer* w;
+
+  if(!t || !fh)
+    return NULL;
+
+  if(!buffer_size)
+    buffer_size = SV_WRITER_BUFFER_SIZE;
+
+  w = (sv_writer*)calloc(1, sizeof(*w));
+  if(!w)
+    return NULL;
+
+  w->buffer = (char*)malloc(buffer_size);
+  if(!w->buffer) {
+    free(w);
+    return NULL;
+  }
+
+  w->t = t;
+  w->fh = fh;
+  w->size = buffer_size;
+
+  return w;
+}
+
+
+/**
+ * sv_writer_write_fields:
+ * @w: writer
+ * @fields: array of fields of length @count
+ * @widths: array of widths of length @count (or NULL)
+ * @count: number of fields
+ *
+ * Write a row of fields with escaping, as sv_write_fields() does,
+ * without flushing the file handle
+ *
+ * Return value: non-0 on failure
+ */
+sv_status_t
+sv_writer_write_fields(sv_writer* w, char** fields, size_t *widths, size_t count)
+{
+  if(!w || (!fields && count))
+    return SV_STATUS_FAILED;
+
+  return sv_write_row(w, fields, widths, count);
+}
+
+
+/**
+ * sv_writer_flush:
+ * @w: writer
+ *
+ * Write the buffered output and flush the file handle
+ *
+ * Return value: non-0 on failure
+ */
+sv_status_t
+sv_writer_flush(sv_writer* w)
+{
+  sv_status_t status;
+
+  if(!w)
+    return SV_STATUS_FAILED;
+
+  status = sv_writer_drain(w);
+
+  if(fflush(w->fh) == EOF)
+    status = SV_STATUS_FAILED;
+
+  return status;
+}
+
+
+/**
+ * sv_writer_close:
+ * @w: writer
+ *
+ * Destructor: flush and destroy a writer.  The file handle is not
+ * closed.
+ *
+ * Return value: non-0 if the buffered output could not be written
+ */
+sv_status_t
+sv_writer_close(sv_writer* w)
+{
+  sv_status_t status;
+
+  if(!w)
+    return SV_STATUS_OK;
+
+  status = sv_writer_flush(w);
+
+  free(w->buffer);
+  free(w);
+
+  return status;
+}